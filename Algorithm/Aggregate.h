@@ -0,0 +1,222 @@
+// Null-aware aggregation kernels over raw arrays of long doubles. NaN marks a missing value and is skipped by every kernel.
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <cmath>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <algorithm>
+
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Count, mean and sum of squared deviations of a range. Two ranges merge exactly, so blocks can be summarised independently
+struct Moments {
+    std::size_t count = 0;
+    long double mean = 0;
+    long double m2 = 0;
+
+    void add(long double x);          // Folds one value in (Welford)
+    void remove(long double x);       // Takes back a value that was added, for sliding windows
+    void merge(const Moments &other); // Folds 'other' in (Chan et al.)
+    long double variance(unsigned int ddof = 1) const { return count > ddof ? m2 / (count - ddof) : NAN; }
+};
+
+inline std::size_t agg_count(const long double *v, std::size_t n);                  // Number of non-NaN values
+inline long double agg_sum(const long double *v, std::size_t n, bool compensated);    // 'compensated' uses Neumaier summation
+inline long double agg_min(const long double *v, std::size_t n);                     // NaN when there are no values
+inline long double agg_max(const long double *v, std::size_t n);                     // NaN when there are no values
+inline long long agg_argmin(const long double *v, std::size_t n);                    // Position of the first smallest value, -1 when there are no values
+inline long long agg_argmax(const long double *v, std::size_t n);                    // Position of the first largest value, -1 when there are no values
+inline Moments agg_moments(const long double *v, std::size_t n);
+
+/* Definitions */
+
+namespace aggregate_detail {
+    // Splits [0, n) across threads in AGGREGATE_GRAIN sized pieces and folds 'kernel(lo, hi)' results together, in order, with 'merge'
+    template <typename T, typename Kernel, typename Merge>
+    inline T reduce(std::size_t n, T identity, Kernel kernel, Merge merge) {
+        std::size_t pieces = (n + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN;
+        if (pieces <= 1) return kernel(0, n);
+
+        std::vector<T> partial(pieces, identity);
+        parallel_for(0, pieces, 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t p = lo; p < hi; p++) partial[p] = kernel(p * AGGREGATE_GRAIN, std::min(n, (p + 1) * AGGREGATE_GRAIN));
+        });
+
+        T out = partial[0];
+        for (std::size_t p = 1; p < pieces; p++) out = merge(out, partial[p]);
+        return out;
+    }
+
+    // Runs every (column, block) pair of 'columns' columns of 'rows' rows as a separate task, so wide and long tables both spread
+    // across all threads. A task range calls 'fold(local, c, b, lo, hi)' for its blocks of a column on a 'make()' accumulator,
+    // then hands it to 'merge(c, local)' once per column, under that column's lock
+    template <typename Make, typename Fold, typename Merge>
+    inline void fold_columns(std::size_t columns, std::size_t rows, Make make, Fold fold, Merge merge) {
+        const std::size_t blocks = rows == 0 ? 1 : (rows + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN;
+        std::vector<std::mutex> locks(columns);
+
+        parallel_for(0, columns * blocks, 1, [&](std::size_t lo, std::size_t hi) {
+            auto local = make();
+            std::size_t current = lo / blocks;
+
+            for (std::size_t t = lo; t < hi; t++) {
+                std::size_t c = t / blocks, b = t % blocks;
+
+                if (c != current) {
+                    std::lock_guard<std::mutex> lock(locks[current]);
+                    merge(current, local);
+                    local = make();
+                    current = c;
+                }
+
+                fold(local, c, b, b * AGGREGATE_GRAIN, std::min(rows, (b + 1) * AGGREGATE_GRAIN));
+            }
+
+            std::lock_guard<std::mutex> lock(locks[current]);
+            merge(current, local);
+        });
+    }
+
+    // Running sum with a Neumaier correction term
+    struct Compensated {
+        long double sum = 0;
+        long double c = 0;
+
+        void add(long double x) {
+            long double t = sum + x;
+            c += std::fabs(sum) >= std::fabs(x) ? (sum - t) + x : (x - t) + sum;
+            sum = t;
+        }
+    };
+
+    struct Extreme {
+        long double value = NAN;
+        long long index = -1;
+    };
+
+    // Four independent accumulators keep the adds from waiting on one another
+    inline long double plain_sum(const long double *v, std::size_t lo, std::size_t hi) {
+        long double a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+        std::size_t i = lo;
+
+        for (; i + 4 <= hi; i += 4) {
+            a0 += v[i] == v[i] ? v[i] : 0;
+            a1 += v[i + 1] == v[i + 1] ? v[i + 1] : 0;
+            a2 += v[i + 2] == v[i + 2] ? v[i + 2] : 0;
+            a3 += v[i + 3] == v[i + 3] ? v[i + 3] : 0;
+        }
+        for (; i < hi; i++) a0 += v[i] == v[i] ? v[i] : 0;
+
+        return (a0 + a1) + (a2 + a3);
+    }
+
+    template <bool Greater>
+    inline Extreme extreme(const long double *v, std::size_t n) {
+        return reduce<Extreme>(n, Extreme(), [v](std::size_t lo, std::size_t hi) {
+            Extreme e;
+            for (std::size_t i = lo; i < hi; i++) {
+                if (v[i] != v[i]) continue;
+                if (e.index < 0 || (Greater ? v[i] > e.value : v[i] < e.value)) { e.value = v[i]; e.index = i; }
+            }
+            return e;
+        }, [](const Extreme &a, const Extreme &b) {
+            if (a.index < 0) return b;
+            if (b.index < 0) return a;
+            return (Greater ? b.value > a.value : b.value < a.value) ? b : a;
+        });
+    }
+}
+
+inline void Moments::add(long double x) {
+    count++;
+    long double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+inline void Moments::remove(long double x) {
+    if (--count == 0) { mean = m2 = 0; return; }
+
+    long double delta = x - mean;
+    mean -= delta / count;
+    m2 -= delta * (x - mean);
+    if (m2 < 0) m2 = 0; // Rounding can leave a hair below zero
+}
+
+inline void Moments::merge(const Moments &other) {
+    if (other.count == 0) return;
+    if (count == 0) { *this = other; return; }
+
+    long double total = count + other.count;
+    long double delta = other.mean - mean;
+
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * count * other.count / total;
+    count += other.count;
+}
+
+inline std::size_t agg_count(const long double *v, std::size_t n) {
+    return aggregate_detail::reduce<std::size_t>(n, 0, [v](std::size_t lo, std::size_t hi) {
+        std::size_t c = 0;
+        for (std::size_t i = lo; i < hi; i++) c += v[i] == v[i];
+        return c;
+    }, [](std::size_t a, std::size_t b) { return a + b; });
+}
+
+inline long double agg_sum(const long double *v, std::size_t n, bool compensated) {
+    using namespace aggregate_detail;
+
+    if (!compensated) {
+        return reduce<long double>(n, 0, [v](std::size_t lo, std::size_t hi) { return plain_sum(v, lo, hi); },
+                                   [](long double a, long double b) { return a + b; });
+    }
+
+    Compensated total = reduce<Compensated>(n, Compensated(), [v](std::size_t lo, std::size_t hi) {
+        Compensated s;
+        for (std::size_t i = lo; i < hi; i++) {
+            if (v[i] == v[i]) s.add(v[i]);
+        }
+        return s;
+    }, [](Compensated a, const Compensated &b) {
+        a.add(b.sum);
+        a.add(b.c);
+        return a;
+    });
+
+    return total.sum + total.c;
+}
+
+inline long double agg_min(const long double *v, std::size_t n) { return aggregate_detail::extreme<false>(v, n).value; }
+inline long double agg_max(const long double *v, std::size_t n) { return aggregate_detail::extreme<true>(v, n).value; }
+inline long long agg_argmin(const long double *v, std::size_t n) { return aggregate_detail::extreme<false>(v, n).index; }
+inline long long agg_argmax(const long double *v, std::size_t n) { return aggregate_detail::extreme<true>(v, n).index; }
+
+inline Moments agg_moments(const long double *v, std::size_t n) {
+    return aggregate_detail::reduce<Moments>(n, Moments(), [v](std::size_t lo, std::size_t hi) {
+        // Two passes over a block that is still in cache: the mean first, then the squared deviations from it
+        Moments m;
+        m.count = 0;
+        long double sum = 0;
+
+        for (std::size_t i = lo; i < hi; i++) {
+            if (v[i] == v[i]) { sum += v[i]; m.count++; }
+        }
+        if (m.count == 0) return m;
+
+        m.mean = sum / m.count;
+        for (std::size_t i = lo; i < hi; i++) {
+            if (v[i] == v[i]) m.m2 += (v[i] - m.mean) * (v[i] - m.mean);
+        }
+        return m;
+    }, [](Moments a, const Moments &b) {
+        a.merge(b);
+        return a;
+    });
+}
+
+#endif
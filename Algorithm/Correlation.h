@@ -0,0 +1,133 @@
+// Covariance and correlation matrices of raw columns. The columns are centred and packed into doubles, and every inner product
+// comes out of one cache-blocked, multithreaded X^T Y (see Algorithm/Gemm.h), so each tile of the result reads its columns
+// once per block of rows instead of once per pair.
+#ifndef CORRELATION_H
+#define CORRELATION_H
+
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "Gemm.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// PAIRWISE: each pair uses the rows where both values are present. COMPLETE: only rows where every column has a value are used
+enum class Nulls { PAIRWISE, COMPLETE };
+
+// Sample covariances (or Pearson correlations if 'normalize') of every pair of the k columns, as a row-major k x k matrix.
+// NaN where a pair shares fewer than two rows, or for correlations where a column does not vary
+inline std::vector<long double> covariance_matrix(const std::vector<const long double*> &cols, std::size_t n, Nulls nulls, bool normalize);
+
+/* Definitions */
+
+namespace correlation_detail {
+    // Mean of the values of every column over 'rows' (all rows when null), skipping NaN
+    inline std::vector<long double> means(const std::vector<const long double*> &cols, std::size_t n, const std::vector<unsigned int> *rows) {
+        std::vector<long double> out(cols.size());
+
+        parallel_for_each(0, cols.size(), [&](std::size_t c) {
+            long double sum = 0;
+            std::size_t count = 0;
+            std::size_t m = rows ? rows->size() : n;
+
+            for (std::size_t t = 0; t < m; t++) {
+                long double x = cols[c][rows ? (*rows)[t] : t];
+                if (x == x) { sum += x; count++; }
+            }
+            out[c] = count ? sum / count : NAN;
+        });
+
+        return out;
+    }
+}
+
+inline std::vector<long double> covariance_matrix(const std::vector<const long double*> &cols, std::size_t n, Nulls nulls, bool normalize) {
+    const std::size_t k = cols.size();
+    std::vector<long double> out(k * k, NAN);
+    if (k == 0) return out;
+
+    std::vector<char> has_null(k, 0);
+    parallel_for_each(0, k, [&](std::size_t c) {
+        for (std::size_t r = 0; r < n && !has_null[c]; r++) has_null[c] = cols[c][r] != cols[c][r];
+    });
+    bool any_null = std::find(has_null.begin(), has_null.end(), 1) != has_null.end();
+
+    if (nulls == Nulls::COMPLETE || !any_null) {
+        // Without missing values every pair shares the same rows, and one product gives the whole matrix
+        std::vector<char> keep(n, 1);
+        if (any_null) {
+            parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t c = 0; c < k; c++) {
+                    for (std::size_t r = lo; r < hi; r++) keep[r] &= cols[c][r] == cols[c][r];
+                }
+            });
+        }
+
+        std::vector<unsigned int> rows;
+        for (std::size_t r = 0; r < n; r++) {
+            if (keep[r]) rows.push_back(r);
+        }
+
+        const std::size_t m = rows.size();
+        std::vector<long double> mean = correlation_detail::means(cols, n, &rows);
+        std::vector<double> x(m * k);
+
+        parallel_for_each(0, k, [&](std::size_t c) {
+            for (std::size_t t = 0; t < m; t++) x[c * m + t] = cols[c][rows[t]] - mean[c];
+        });
+
+        std::vector<double> g(k * k);
+        gram(x.data(), m, k, g.data());
+
+        for (std::size_t i = 0; i < k; i++) {
+            for (std::size_t j = 0; j < k; j++) {
+                if (m < 2) continue;
+                out[i * k + j] = normalize ? g[i * k + j] / std::sqrt(g[i * k + i] * g[j * k + j]) : g[i * k + j] / (m - 1);
+            }
+        }
+        return out;
+    }
+
+    // Pairwise: with x the centred values (0 where missing) and p the presence flags, every pair's count, sums and sums of
+    // squares over their shared rows are entries of p^T p, x^T p and (x*x)^T p, and its cross term is an entry of x^T x
+    std::vector<long double> mean = correlation_detail::means(cols, n, nullptr);
+    std::vector<double> x(n * k), x2(n * k), p(n * k);
+
+    parallel_for_each(0, k, [&](std::size_t c) {
+        for (std::size_t r = 0; r < n; r++) {
+            bool present = cols[c][r] == cols[c][r];
+            x[c * n + r] = present ? (double)(cols[c][r] - mean[c]) : 0;
+            x2[c * n + r] = x[c * n + r] * x[c * n + r];
+            p[c * n + r] = present;
+        }
+    });
+
+    std::vector<double> xx(k * k), pp(k * k), xp(k * k), x2p(k * k);
+    gram(x.data(), n, k, xx.data());
+    gram(p.data(), n, k, pp.data());
+    gemm(x.data(), true, p.data(), false, xp.data(), k, k, n);  // xp[i + j * k] sums column i over the rows column j has
+    gemm(x2.data(), true, p.data(), false, x2p.data(), k, k, n);
+
+    for (std::size_t i = 0; i < k; i++) {
+        for (std::size_t j = 0; j < k; j++) {
+            long double count = pp[i * k + j];
+            if (count < 2) continue;
+
+            long double si = xp[i + j * k], sj = xp[j + i * k]; // Sums of i over the rows j has, and the other way around
+            long double cross = xx[i * k + j] - si * sj / count;
+
+            if (!normalize) { out[i * k + j] = cross / (count - 1); continue; }
+
+            long double vi = x2p[i + j * k] - si * si / count, vj = x2p[j + i * k] - sj * sj / count;
+            out[i * k + j] = cross / std::sqrt(vi * vj);
+        }
+    }
+
+    return out;
+}
+
+#endif
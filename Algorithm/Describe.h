@@ -0,0 +1,125 @@
+// Summary statistics for many columns at once
+#ifndef DESCRIBE_H
+#define DESCRIBE_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Aggregate.h"
+#include "../Container/HyperLogLog.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+struct ColumnSummary {
+    std::string label;
+    std::size_t count = 0;    // Values that are not NaN
+    std::size_t nulls = 0;
+    long double mean = NAN;
+    long double std = NAN;    // Sample standard deviation
+    long double min = NAN;
+    long double q25 = NAN;    // Quartiles, linearly interpolated between the closest ranks
+    long double median = NAN;
+    long double q75 = NAN;
+    long double max = NAN;
+    std::size_t distinct = 0; // Estimated number of distinct values (see HyperLogLog)
+};
+
+// Summarises 'rows' values behind each pointer. Every (column, row block) pair is a separate task on the pool, so both wide
+// and long tables spread across all threads; the blocks of each column are then merged and its quartiles selected in linear time.
+inline std::vector<ColumnSummary> summarize_columns(const std::vector<const long double*> &cols, std::size_t rows);
+
+/* Definitions */
+
+namespace describe_detail {
+    struct Partial {
+        Moments moments;
+        std::size_t nulls = 0;
+        long double min = NAN;
+        long double max = NAN;
+    };
+
+    inline Partial summarize_block(const long double *v, std::size_t lo, std::size_t hi) {
+        Partial p;
+        p.moments = agg_moments(v + lo, hi - lo);
+        p.nulls = (hi - lo) - p.moments.count;
+        p.min = agg_min(v + lo, hi - lo);
+        p.max = agg_max(v + lo, hi - lo);
+        return p;
+    }
+
+    // Value at quantile 'q' of the sorted order of 'values', which is partially reordered. Selection starts at 'from'
+    inline long double quantile(std::vector<long double> &values, std::size_t from, long double q) {
+        long double pos = q * (values.size() - 1);
+        std::size_t below = (std::size_t)pos;
+
+        std::nth_element(values.begin() + from, values.begin() + below, values.end());
+        long double lo = values[below];
+        if (below + 1 >= values.size() || pos == below) return lo;
+
+        long double hi = *std::min_element(values.begin() + below + 1, values.end());
+        return lo + (hi - lo) * (pos - below);
+    }
+}
+
+inline std::vector<ColumnSummary> summarize_columns(const std::vector<const long double*> &cols, std::size_t rows) {
+    using namespace describe_detail;
+
+    const std::size_t blocks = rows == 0 ? 1 : (rows + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN;
+    std::vector<Partial> partial(cols.size() * blocks);
+
+    // One distinct-count sketch per column. Each task range sketches its blocks of a column locally and folds them in once
+    std::vector<HyperLogLog> distinct(cols.size());
+
+    aggregate_detail::fold_columns(cols.size(), rows, [] { return HyperLogLog(); },
+        [&](HyperLogLog &local, std::size_t c, std::size_t b, std::size_t lo, std::size_t hi) {
+            partial[c * blocks + b] = summarize_block(cols[c], lo, hi);
+            local.add(cols[c] + lo, hi - lo);
+        },
+        [&](std::size_t c, const HyperLogLog &local) { distinct[c].merge(local); });
+
+    std::vector<ColumnSummary> out(cols.size());
+
+    parallel_for(0, cols.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t c = lo; c < hi; c++) {
+            Partial total = partial[c * blocks];
+
+            for (std::size_t b = 1; b < blocks; b++) {
+                const Partial &p = partial[c * blocks + b];
+                total.moments.merge(p.moments);
+                total.nulls += p.nulls;
+                if (p.min < total.min || total.min != total.min) total.min = p.min;
+                if (p.max > total.max || total.max != total.max) total.max = p.max;
+            }
+
+            ColumnSummary &s = out[c];
+            s.count = total.moments.count;
+            s.nulls = total.nulls;
+            s.mean = s.count ? total.moments.mean : NAN;
+            s.std = std::sqrt(total.moments.variance());
+            s.min = total.min;
+            s.max = total.max;
+            s.distinct = distinct[c].estimate();
+
+            if (s.count == 0) continue;
+
+            std::vector<long double> values;
+            values.reserve(s.count);
+            for (std::size_t r = 0; r < rows; r++) {
+                if (cols[c][r] == cols[c][r]) values.push_back(cols[c][r]);
+            }
+
+            // Each selection leaves everything above its rank to the right, so the next one only searches from there
+            s.q25 = quantile(values, 0, 0.25);
+            s.median = quantile(values, (std::size_t)(0.25 * (values.size() - 1)), 0.5);
+            s.q75 = quantile(values, (std::size_t)(0.5 * (values.size() - 1)), 0.75);
+        }
+    });
+
+    return out;
+}
+
+#endif
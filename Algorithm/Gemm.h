@@ -0,0 +1,153 @@
+// Dense matrix kernels over raw column-major arrays: element (i, j) of an 'm' x 'n' matrix sits at [i + j * m].
+// The product is cache blocked: every task owns a TILE x TILE block of the result and walks the shared dimension in slabs of
+// DEPTH, packing both operands of a slab into small panels that stay in cache. A register-sized micro-kernel then reads the
+// panels strictly in order and keeps its MR x NR block of sums in independent accumulators, so the compiler can vectorise it.
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// c = op(a) * op(b), where op(a) is m x k and op(b) is k x n. 'trans_a' reads 'a' as stored k x m, and 'trans_b' reads 'b' as
+// stored n x k. 'c' is written in full. Blocks of the result run in parallel
+template <typename T>
+void gemm(const T *a, bool trans_a, const T *b, bool trans_b, T *c, std::size_t m, std::size_t n, std::size_t k);
+
+// c = a^T * a for an n x k matrix 'a', as a k x k matrix. Only the blocks on and above the diagonal are computed, then mirrored
+template <typename T>
+void gram(const T *a, std::size_t n, std::size_t k, T *c);
+
+// out = a^T for a 'rows' x 'cols' matrix 'a'. Copies square blocks, so both sides are read and written a cache line at a time
+template <typename T>
+void transpose(const T *a, std::size_t rows, std::size_t cols, T *out);
+
+/* Definitions */
+
+namespace gemm_detail {
+    const std::size_t TILE = 64;   // Rows and columns of the result owned by one task
+    const std::size_t DEPTH = 256; // Slab of the shared dimension packed at a time: two 64 x 256 panels of doubles fill 256 KB
+    const std::size_t MR = 4;      // Rows of the micro-kernel's block
+    const std::size_t NR = 8;      // Columns of the micro-kernel's block
+
+    // An operand read through strides, so transposed and plain layouts pack the same way: element (i, p) is at [i * row + p * col]
+    template <typename T>
+    struct Operand {
+        const T *data;
+        std::size_t row, col;
+
+        T operator()(std::size_t i, std::size_t p) const { return data[i * row + p * col]; }
+    };
+
+    // Packs rows [i0, i1) and depths [p0, p1) into panels of 'R' rows, each stored depth by depth. Short panels are zero padded
+    template <std::size_t R, typename T>
+    inline void pack(const Operand<T> &op, std::size_t i0, std::size_t i1, std::size_t p0, std::size_t p1, T *out) {
+        for (std::size_t i = i0; i < i1; i += R) {
+            for (std::size_t p = p0; p < p1; p++) {
+                for (std::size_t r = 0; r < R; r++) *out++ = i + r < i1 ? op(i + r, p) : T(0);
+            }
+        }
+    }
+
+    // Adds the product of an MR-row panel and an NR-column panel, 'depth' long, to the block of 'c' at (i, j)
+    template <typename T>
+    inline void micro(const T *ap, const T *bp, std::size_t depth, T *c, std::size_t ldc, std::size_t rows, std::size_t cols) {
+        T acc[MR][NR] = {};
+
+        for (std::size_t p = 0; p < depth; p++) {
+            for (std::size_t i = 0; i < MR; i++) {
+                for (std::size_t j = 0; j < NR; j++) acc[i][j] += ap[p * MR + i] * bp[p * NR + j];
+            }
+        }
+
+        for (std::size_t j = 0; j < cols; j++) {
+            for (std::size_t i = 0; i < rows; i++) c[i + j * ldc] += acc[i][j];
+        }
+    }
+
+    // The block of 'c' at rows [i0, i1) and columns [j0, j1), over the whole shared dimension
+    template <typename T>
+    inline void tile(const Operand<T> &a, const Operand<T> &b, T *c, std::size_t m, std::size_t k,
+                     std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1) {
+        std::vector<T> ap(((i1 - i0 + MR - 1) / MR) * MR * DEPTH), bp(((j1 - j0 + NR - 1) / NR) * NR * DEPTH);
+
+        for (std::size_t j = j0; j < j1; j++) std::fill(c + i0 + j * m, c + i1 + j * m, T(0));
+
+        for (std::size_t p0 = 0; p0 < k; p0 += DEPTH) {
+            const std::size_t p1 = std::min(k, p0 + DEPTH), depth = p1 - p0;
+            pack<MR>(a, i0, i1, p0, p1, ap.data());
+            pack<NR>(b, j0, j1, p0, p1, bp.data());
+
+            for (std::size_t j = j0; j < j1; j += NR) {
+                for (std::size_t i = i0; i < i1; i += MR) {
+                    micro(ap.data() + (i - i0) * depth, bp.data() + (j - j0) * depth, depth, c + i + j * m, m,
+                          std::min(MR, i1 - i), std::min(NR, j1 - j));
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    inline void product(const Operand<T> &a, const Operand<T> &b, T *c, std::size_t m, std::size_t n, std::size_t k, bool symmetric) {
+        const std::size_t tm = (m + TILE - 1) / TILE, tn = (n + TILE - 1) / TILE;
+        std::vector<std::pair<std::size_t, std::size_t>> tiles;
+
+        for (std::size_t i = 0; i < tm; i++) {
+            for (std::size_t j = symmetric ? i : 0; j < tn; j++) tiles.push_back({i, j});
+        }
+
+        // Tiles are disjoint, and a mirrored tile is one that no task computes
+        parallel_for_each(0, tiles.size(), [&](std::size_t t) {
+            const std::size_t i0 = tiles[t].first * TILE, i1 = std::min(m, i0 + TILE);
+            const std::size_t j0 = tiles[t].second * TILE, j1 = std::min(n, j0 + TILE);
+            tile(a, b, c, m, k, i0, i1, j0, j1);
+
+            if (!symmetric || i0 == j0) return;
+            for (std::size_t j = j0; j < j1; j++) {
+                for (std::size_t i = i0; i < i1; i++) c[j + i * m] = c[i + j * m];
+            }
+        });
+    }
+}
+
+template <typename T>
+void gemm(const T *a, bool trans_a, const T *b, bool trans_b, T *c, std::size_t m, std::size_t n, std::size_t k) {
+    using gemm_detail::Operand;
+
+    // Row i of op(a) and column j of op(b), each as a function of the shared index p
+    Operand<T> oa = trans_a ? Operand<T>{a, k, 1} : Operand<T>{a, 1, m};
+    Operand<T> ob = trans_b ? Operand<T>{b, 1, n} : Operand<T>{b, k, 1};
+    gemm_detail::product(oa, ob, c, m, n, k, false);
+}
+
+template <typename T>
+void gram(const T *a, std::size_t n, std::size_t k, T *c) {
+    gemm_detail::Operand<T> at{a, n, 1};
+    gemm_detail::product(at, at, c, k, k, n, true);
+}
+
+template <typename T>
+void transpose(const T *a, std::size_t rows, std::size_t cols, T *out) {
+    const std::size_t tiles = (cols + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+    parallel_for(0, tiles, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t t = lo; t < hi; t++) {
+            const std::size_t j0 = t * TRANSPOSE_BLOCK, j1 = std::min(cols, j0 + TRANSPOSE_BLOCK);
+
+            for (std::size_t i0 = 0; i0 < rows; i0 += TRANSPOSE_BLOCK) {
+                const std::size_t i1 = std::min(rows, i0 + TRANSPOSE_BLOCK);
+
+                for (std::size_t i = i0; i < i1; i++) {
+                    for (std::size_t j = j0; j < j1; j++) out[j + i * cols] = a[i + j * rows];
+                }
+            }
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,318 @@
+// Hash group-by over one or more key columns of a DataSet, followed by per-group aggregation
+#ifndef GROUPBY_H
+#define GROUPBY_H
+
+#include <cmath>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "../Container/DataSet.h"
+#include "../Container/GroupTable.h"
+#include "../util/Hash.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+#include "Aggregate.h"
+#include "Partition.h"
+
+/* Declarations */
+
+enum class Agg { SIZE, COUNT, SUM, MEAN, MIN, MAX, VAR, STD, FIRST, LAST };
+
+// One output column of GroupBy::agg(). NaN values are skipped by every function except SIZE, which counts rows
+struct Aggregation {
+    std::string label;     // Column to aggregate. Ignored by SIZE
+    Agg fn;
+    std::string out_label; // Label of the output column. Defaults to "<label>_<fn>", or "size"
+};
+
+inline Aggregation agg(const std::string &label, Agg fn, const std::string &out_label = "");
+
+// The rows of a DataSet split into groups of equal keys. Groups are numbered in order of first appearance.
+// Rows are radix-partitioned on their key so that each partition, and every group in it, belongs to one thread.
+// Threads take partitions one at a time, so one large partition does not hold up the others.
+// Categorical keys whose maps are small skip the hash table and index the groups directly by code.
+// The DataSet must outlive the GroupBy and keep its shape while it is in use.
+class GroupBy {
+    private:
+        const DataSet *ds;
+        std::vector<unsigned int> key_cols;
+        bool dense;
+
+        std::vector<std::uint32_t> group_of;  // Group of every row
+        std::vector<unsigned int> first_row;  // First row of every group
+        std::vector<unsigned int> order;      // Rows arranged partition by partition, in row order within each
+        std::vector<std::size_t> offsets;     // Partition p holds order[offsets[p], offsets[p + 1])
+
+        bool dense_slots(std::vector<std::uint64_t> &slots, std::size_t &count) const; // Numbers every key as a mixed-radix number of map positions, if the maps allow
+        void build(const std::vector<std::uint64_t> &slots, std::size_t dense_count);  // Partitions the rows and numbers the groups
+
+    public:
+        GroupBy(const DataSet &ds, const std::vector<std::string> &keys);
+
+        std::size_t num_groups() const { return first_row.size(); }
+        bool is_dense() const { return dense; }                                     // True if the direct-indexing path was taken
+        const std::vector<std::uint32_t>& get_group_ids() const { return group_of; } // Group of every row
+        const std::vector<unsigned int>& get_first_rows() const { return first_row; } // First row of every group
+
+        DataSet agg(const std::vector<Aggregation> &aggs) const; // One row per group: the key columns, then one column per aggregation
+};
+
+/* Definitions */
+
+inline Aggregation agg(const std::string &label, Agg fn, const std::string &out_label) {
+    static const char *names[] = { "size", "count", "sum", "mean", "min", "max", "var", "std", "first", "last" };
+
+    if (!out_label.empty()) return Aggregation{label, fn, out_label};
+    if (fn == Agg::SIZE) return Aggregation{label, fn, "size"};
+    return Aggregation{label, fn, label + "_" + names[(int)fn]};
+}
+
+inline GroupBy DataSet::group_by(const std::vector<std::string> &keys) const {
+    return GroupBy(*this, keys);
+}
+
+inline GroupBy::GroupBy(const DataSet &ds, const std::vector<std::string> &keys) : ds(&ds), dense(false) {
+    if (keys.empty()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> GroupBy() -> No key columns given!" << std::endl;
+        throw -1;
+    }
+
+    for (const std::string &key : keys) {
+        int index = ds.get_col_index(key);
+
+        if (index < 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> GroupBy() -> No column labelled '" << key << "'!" << std::endl;
+            throw -1;
+        }
+        key_cols.push_back(index);
+    }
+
+    std::size_t n = ds.num_rows();
+    std::vector<std::uint64_t> slots(n);
+    std::size_t dense_count = 0;
+
+    dense = dense_slots(slots, dense_count);
+
+    if (!dense) {
+        std::vector<const long double*> cols;
+        for (unsigned int c : key_cols) cols.push_back(ds.get_col_ref(c).get_data().data());
+
+        parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            std::vector<long double> key(cols.size());
+
+            for (std::size_t r = lo; r < hi; r++) {
+                for (std::size_t k = 0; k < cols.size(); k++) key[k] = cols[k][r];
+                slots[r] = hash_key(key.data(), key.size());
+            }
+        });
+    }
+
+    build(slots, dense_count);
+}
+
+inline bool GroupBy::dense_slots(std::vector<std::uint64_t> &slots, std::size_t &count) const {
+    std::vector<GroupTable> positions;
+    std::vector<const long double*> cols;
+    count = 1;
+
+    for (unsigned int c : key_cols) {
+        const Column &col = ds->get_col_ref(c);
+        if (!col.is_categorical()) return false;
+
+        auto map = col.get_map_ptr();
+        std::size_t width = map->left().size() + 1; // One more position for NaN
+        if (count * width > DENSE_GROUP_LIMIT) return false;
+        count *= width;
+
+        GroupTable t(1, width);
+        long double missing = NAN;
+        t.insert(&missing, hash_value(missing));
+        for (const auto &entry : map->left()) t.insert(&entry.first, hash_value(entry.first));
+
+        positions.push_back(std::move(t));
+        cols.push_back(col.get_data().data());
+    }
+
+    // A value the map cannot translate has no position, so the keys fall back to hashing
+    std::atomic<bool> ok(true);
+
+    parallel_for(0, ds->num_rows(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t r = lo; r < hi && ok.load(std::memory_order_relaxed); r++) {
+            std::uint64_t slot = 0;
+
+            for (std::size_t k = 0; k < cols.size(); k++) {
+                std::uint32_t p = positions[k].find(cols[k] + r, hash_value(cols[k][r]));
+                if (p == GroupTable::NONE) { ok = false; return; }
+                slot = slot * positions[k].size() + p;
+            }
+            slots[r] = slot;
+        }
+    });
+
+    return ok;
+}
+
+inline void GroupBy::build(const std::vector<std::uint64_t> &slots, std::size_t dense_count) {
+    const std::size_t n = ds->num_rows();
+    const unsigned int bits = partition_bits(n);
+    const std::size_t parts = (std::size_t)1 << bits;
+
+    // Hashes are already mixed, dense slots are not. The top bits pick the partition and the hash table probes with the low ones
+    if (dense) radix_partition(n, bits, [&](std::size_t r) { return bits ? mix64(slots[r]) >> (64 - bits) : 0; }, order, offsets);
+    else radix_partition(n, bits, [&](std::size_t r) { return bits ? slots[r] >> (64 - bits) : 0; }, order, offsets);
+
+    // Number the groups of each partition on their own
+    std::vector<std::vector<unsigned int>> firsts(parts);
+    std::vector<std::uint32_t> dense_group(dense ? dense_count : 0, GroupTable::NONE);
+    group_of.resize(n);
+
+    std::vector<const long double*> cols;
+    for (unsigned int c : key_cols) cols.push_back(ds->get_col_ref(c).get_data().data());
+
+    parallel_for_each(0, parts, [&](std::size_t p) {
+        std::vector<unsigned int> &first = firsts[p];
+
+        if (dense) {
+            for (std::size_t i = offsets[p]; i < offsets[p + 1]; i++) {
+                unsigned int r = order[i];
+                std::uint32_t &g = dense_group[slots[r]]; // Each slot belongs to exactly one partition
+                if (g == GroupTable::NONE) { g = first.size(); first.push_back(r); }
+                group_of[r] = g;
+            }
+            return;
+        }
+
+        GroupTable table(cols.size());
+        std::vector<long double> key(cols.size());
+
+        for (std::size_t i = offsets[p]; i < offsets[p + 1]; i++) {
+            unsigned int r = order[i];
+            for (std::size_t k = 0; k < cols.size(); k++) key[k] = cols[k][r];
+
+            std::uint32_t g = table.insert(key.data(), slots[r]);
+            if (g == first.size()) first.push_back(r);
+            group_of[r] = g;
+        }
+    });
+
+    // Renumber all groups in order of first appearance, so the result does not depend on the partitioning
+    std::vector<std::size_t> base(parts + 1, 0);
+    for (std::size_t p = 0; p < parts; p++) base[p + 1] = base[p] + firsts[p].size();
+
+    std::vector<std::uint32_t> starts(n, GroupTable::NONE), renumber(base[parts]);
+    for (std::size_t p = 0; p < parts; p++) {
+        for (std::size_t l = 0; l < firsts[p].size(); l++) starts[firsts[p][l]] = base[p] + l;
+    }
+
+    first_row.reserve(base[parts]);
+    for (std::size_t r = 0; r < n; r++) {
+        if (starts[r] == GroupTable::NONE) continue;
+        renumber[starts[r]] = first_row.size();
+        first_row.push_back(r);
+    }
+
+    parallel_for_each(0, parts, [&](std::size_t p) {
+        for (std::size_t i = offsets[p]; i < offsets[p + 1]; i++) group_of[order[i]] = renumber[base[p] + group_of[order[i]]];
+    });
+}
+
+inline DataSet GroupBy::agg(const std::vector<Aggregation> &aggs) const {
+    struct State {
+        Moments m;
+        long double sum = 0, min = NAN, max = NAN, first = NAN, last = NAN;
+    };
+
+    // Every column is folded once, however many aggregations read it
+    std::vector<int> inputs;
+    std::vector<int> input_of(aggs.size(), -1);
+
+    for (std::size_t a = 0; a < aggs.size(); a++) {
+        if (aggs[a].fn == Agg::SIZE) continue;
+
+        int index = ds->get_col_index(aggs[a].label);
+        if (index < 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> agg() -> No column labelled '" << aggs[a].label << "'!" << std::endl;
+            throw -1;
+        }
+
+        for (std::size_t i = 0; i < inputs.size() && input_of[a] < 0; i++) {
+            if (inputs[i] == index) input_of[a] = i;
+        }
+        if (input_of[a] < 0) {
+            input_of[a] = inputs.size();
+            inputs.push_back(index);
+        }
+    }
+
+    const std::size_t groups = num_groups();
+    std::vector<std::vector<State>> states(inputs.size(), std::vector<State>(groups));
+    std::vector<std::size_t> sizes(groups, 0);
+
+    // No group spans two partitions, so each partition updates its own states without locks
+    parallel_for_each(0, offsets.size() - 1, [&](std::size_t p) {
+        for (std::size_t i = offsets[p]; i < offsets[p + 1]; i++) sizes[group_of[order[i]]]++;
+
+        for (std::size_t c = 0; c < inputs.size(); c++) {
+            const long double *v = ds->get_col_ref(inputs[c]).get_data().data();
+            std::vector<State> &s = states[c];
+
+            for (std::size_t i = offsets[p]; i < offsets[p + 1]; i++) {
+                unsigned int r = order[i];
+                if (v[r] != v[r]) continue;
+
+                State &st = s[group_of[r]];
+                st.m.add(v[r]);
+                st.sum += v[r];
+                if (st.m.count == 1) { st.min = st.max = st.first = v[r]; }
+                else if (v[r] < st.min) st.min = v[r];
+                else if (v[r] > st.max) st.max = v[r];
+                st.last = v[r];
+            }
+        }
+    });
+
+    DataSet out;
+    out.set_map_ptr(ds->get_map_ptr());
+
+    for (unsigned int c : key_cols) {
+        const Column &src = ds->get_col_ref(c);
+        std::vector<long double> keys(groups);
+        for (std::size_t g = 0; g < groups; g++) keys[g] = src.get_data()[first_row[g]];
+
+        Column col(keys, src.get_label());
+        col.set_masked(src.is_masked());
+        if (src.is_categorical()) col.set_map(src.get_map_ptr());
+        out.add_col(col);
+    }
+
+    for (std::size_t a = 0; a < aggs.size(); a++) {
+        std::vector<long double> values(groups);
+
+        for (std::size_t g = 0; g < groups; g++) {
+            if (aggs[a].fn == Agg::SIZE) { values[g] = sizes[g]; continue; }
+
+            const State &st = states[input_of[a]][g];
+            switch (aggs[a].fn) {
+                case Agg::COUNT: values[g] = st.m.count; break;
+                case Agg::SUM: values[g] = st.sum; break;
+                case Agg::MEAN: values[g] = st.m.count ? st.m.mean : NAN; break;
+                case Agg::MIN: values[g] = st.min; break;
+                case Agg::MAX: values[g] = st.max; break;
+                case Agg::VAR: values[g] = st.m.variance(); break;
+                case Agg::STD: values[g] = std::sqrt(st.m.variance()); break;
+                case Agg::FIRST: values[g] = st.first; break;
+                case Agg::LAST: values[g] = st.last; break;
+                default: break;
+            }
+        }
+
+        out.add_col(Column(values, ::agg(aggs[a].label, aggs[a].fn, aggs[a].out_label).out_label));
+    }
+
+    return out;
+}
+
+#endif
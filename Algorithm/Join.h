@@ -0,0 +1,354 @@
+// Hash joins between two DataSets on one or more key columns
+#ifndef JOIN_H
+#define JOIN_H
+
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+#include "../Container/DataSet.h"
+#include "../Container/GroupTable.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+#include "Partition.h"
+
+/* Declarations */
+
+// INNER keeps matching pairs, LEFT also keeps unmatched left rows with NaN on the right,
+// SEMI keeps the left rows that have a match and ANTI the ones that do not. SEMI and ANTI only return the left columns.
+enum class JoinType { INNER, LEFT, SEMI, ANTI };
+
+// Joins 'left' and 'right' on the columns labelled 'keys', which both sides must have. Rows whose key has a NaN never match.
+// The result lists left rows in order, each followed by its matches in right row order. The right key columns are dropped, and
+// right columns whose label is already taken get a "_right" suffix.
+// Both sides are radix-partitioned on the key hash and each partition is built and probed by one thread. Categorical keys that
+// share a translation map are compared on their codes; otherwise the right codes are first translated into the left map's codes.
+inline DataSet hash_join(const DataSet &left, const DataSet &right, const std::vector<std::string> &keys, JoinType how = JoinType::INNER);
+
+// Joins on one key column that is sorted on both sides (see Column::is_sorted) in a single merging pass, with no hash table.
+// Gives the same rows in the same order as hash_join. Throws if a key column is not sorted, or if the two sides code a
+// categorical key with different maps, since translating the codes would break their order.
+inline DataSet merge_join(const DataSet &left, const DataSet &right, const std::string &key, JoinType how = JoinType::INNER);
+
+// Matches every left row with the last right row whose 'on' value is at most the left one and no more than 'tolerance' below it.
+// Both 'on' columns must be sorted. Every left row is kept, and rows without a match get NaN on the right.
+inline DataSet asof_join(const DataSet &left, const DataSet &right, const std::string &on, long double tolerance = INFINITY);
+
+/* Definitions */
+
+namespace join_detail {
+    const unsigned int NO_ROW = 0xffffffff;
+
+    // Orders NaN after every value, matching is_sorted_values
+    inline bool before(long double a, long double b) { return a < b || (a == a && b != b); }
+
+    // Looks up a merge key on both sides. With 'check' set, throws unless both columns are sorted and share their codes
+    inline bool merge_key(const DataSet &left, const DataSet &right, const std::string &key, bool check, int &lk, int &rk) {
+        lk = left.get_col_index(key);
+        rk = right.get_col_index(key);
+
+        if (lk < 0 || rk < 0) {
+            if (!check) return false;
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> join() -> No column labelled '" << key << "'!" << std::endl;
+            throw -1;
+        }
+
+        const Column &lc = left.get_col_ref(lk), &rc = right.get_col_ref(rk);
+        bool ok = lc.is_sorted() && rc.is_sorted() && lc.get_map_ptr() == rc.get_map_ptr();
+
+        if (!ok && check) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> join() -> Key column '" << key << "' is not sorted on both sides!" << std::endl;
+            throw -1;
+        }
+        return ok;
+    }
+
+    inline std::vector<int> key_indices(const DataSet &ds, const std::vector<std::string> &keys) {
+        std::vector<int> out;
+
+        for (const std::string &key : keys) {
+            int index = ds.get_col_index(key);
+
+            if (index < 0) {
+                if (VERBOSE_ERRORS) std::cout << "[Error] -> join() -> No column labelled '" << key << "'!" << std::endl;
+                throw -1;
+            }
+            out.push_back(index);
+        }
+
+        return out;
+    }
+
+    // Hash of every row's key. 'valid' is cleared for rows whose key holds a NaN
+    inline void hash_rows(const std::vector<const long double*> &cols, std::size_t n, std::vector<std::uint64_t> &hashes, std::vector<char> &valid) {
+        hashes.resize(n);
+        valid.assign(n, 1);
+
+        parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            std::vector<long double> key(cols.size());
+
+            for (std::size_t r = lo; r < hi; r++) {
+                for (std::size_t k = 0; k < cols.size(); k++) {
+                    key[k] = cols[k][r];
+                    if (key[k] != key[k]) valid[r] = 0;
+                }
+                hashes[r] = hash_key(key.data(), key.size());
+            }
+        });
+    }
+
+    // Codes of a categorical column re-expressed in another map. Terms the other map lacks become NaN so they match nothing
+    inline std::vector<long double> translate(const Column &col, const Bimap<long double, std::string> &target) {
+        std::unordered_map<long double, long double> codes;
+        for (const auto &entry : col.get_map_ptr()->left()) codes[entry.first] = target.has_value(entry.second) ? target.get_key(entry.second) : NAN;
+
+        const std::vector<long double> &src = col.get_data();
+        std::vector<long double> out(src.size());
+
+        parallel_for(0, src.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t r = lo; r < hi; r++) {
+                auto it = codes.find(src[r]);
+                out[r] = it == codes.end() ? src[r] : it->second;
+            }
+        });
+
+        return out;
+    }
+
+    // Builds the joined DataSet once the matches of every left row are known: 'match_count[l]' right rows, listed from
+    // matches[match_start[l]], or running on from right row match_start[l] when 'matches' is null. Right columns in 'drop' are left out
+    inline DataSet assemble(const DataSet &left, const DataSet &right, const std::vector<int> &drop, JoinType how,
+                            const std::vector<std::size_t> &match_start, const std::vector<std::uint32_t> &match_count, const unsigned int *matches) {
+        const std::size_t nl = left.num_rows();
+
+        if (how == JoinType::SEMI || how == JoinType::ANTI) {
+            std::vector<unsigned int> rows;
+            for (std::size_t l = 0; l < nl; l++) {
+                if ((match_count[l] > 0) == (how == JoinType::SEMI)) rows.push_back(l);
+            }
+            return left.take(rows);
+        }
+
+        // Output positions follow the left rows, so the pairs can be written in parallel
+        std::vector<std::size_t> out_start(nl + 1, 0);
+        for (std::size_t l = 0; l < nl; l++) {
+            std::size_t c = match_count[l];
+            if (c == 0 && how == JoinType::LEFT) c = 1;
+            out_start[l + 1] = out_start[l] + c;
+        }
+
+        std::vector<unsigned int> lrows(out_start[nl]), rrows(out_start[nl]);
+
+        parallel_for(0, nl, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t l = lo; l < hi; l++) {
+                std::size_t o = out_start[l];
+
+                if (match_count[l] == 0 && how == JoinType::LEFT) {
+                    lrows[o] = l;
+                    rrows[o] = NO_ROW;
+                }
+                for (std::size_t m = 0; m < match_count[l]; m++) {
+                    lrows[o + m] = l;
+                    rrows[o + m] = matches ? matches[match_start[l] + m] : match_start[l] + m;
+                }
+            }
+        });
+
+        DataSet out = left.take(lrows);
+
+        // take() shares the left map, and re-coding a right column adds its terms to the map it lands in. A join must not
+        // change 'left', and other threads may be reading it, so the result gets its own copy of the map first
+        for (unsigned int c = 0; c < right.num_cols() && !ALLOW_UNIQUE_COLUMN_MAPS; c++) {
+            const Column &src = right.get_col_ref(c);
+            if (std::find(drop.begin(), drop.end(), (int)c) != drop.end() || !src.is_categorical() || src.get_map_ptr() == left.get_map_ptr()) continue;
+
+            out.set_map_ptr(std::make_shared<Bimap<long double, std::string>>(*left.get_map_ptr()));
+            break;
+        }
+
+        for (unsigned int c = 0; c < right.num_cols(); c++) {
+            if (std::find(drop.begin(), drop.end(), (int)c) != drop.end()) continue;
+
+            const Column &src = right.get_col_ref(c);
+            const long double *v = src.get_data().data();
+            std::vector<long double> values(rrows.size());
+
+            parallel_for(0, rrows.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t i = lo; i < hi; i++) values[i] = rrows[i] == NO_ROW ? NAN : v[rrows[i]];
+            });
+
+            std::string label = src.get_label();
+            if (out.get_col_index(label) >= 0) label += "_right";
+
+            Column col(std::move(values), label);
+            col.set_masked(src.is_masked());
+            if (src.is_categorical()) col.set_map(src.get_map_ptr());
+            out.add_col(std::move(col)); // Re-codes the column if its map is not the result's
+        }
+
+        return out;
+    }
+}
+
+// A single key that is already sorted on both sides is merged instead of hashed
+inline DataSet DataSet::join(const DataSet &right, const std::vector<std::string> &keys, JoinType how) const {
+    int lk, rk;
+    if (keys.size() == 1 && join_detail::merge_key(*this, right, keys[0], false, lk, rk)) return merge_join(*this, right, keys[0], how);
+
+    return hash_join(*this, right, keys, how);
+}
+
+inline DataSet DataSet::join(const DataSet &right, const std::vector<std::string> &keys) const {
+    return join(right, keys, JoinType::INNER);
+}
+
+inline DataSet DataSet::asof_join(const DataSet &right, const std::string &on, long double tolerance) const {
+    return ::asof_join(*this, right, on, tolerance);
+}
+
+inline DataSet hash_join(const DataSet &left, const DataSet &right, const std::vector<std::string> &keys, JoinType how) {
+    if (keys.empty()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> hash_join() -> No key columns given!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<int> lk = join_detail::key_indices(left, keys), rk = join_detail::key_indices(right, keys);
+    const std::size_t nl = left.num_rows(), nr = right.num_rows();
+    const unsigned int width = keys.size();
+
+    std::vector<const long double*> lcols, rcols;
+    std::vector<std::vector<long double>> translated;
+    translated.reserve(width);
+
+    for (unsigned int k = 0; k < width; k++) {
+        const Column &lc = left.get_col_ref(lk[k]), &rc = right.get_col_ref(rk[k]);
+        lcols.push_back(lc.get_data().data());
+
+        if (lc.is_categorical() && rc.is_categorical() && lc.get_map_ptr() != rc.get_map_ptr()) {
+            translated.push_back(join_detail::translate(rc, *lc.get_map_ptr()));
+            rcols.push_back(translated.back().data());
+        }
+        else rcols.push_back(rc.get_data().data());
+    }
+
+    std::vector<std::uint64_t> lh, rh;
+    std::vector<char> lvalid, rvalid;
+    join_detail::hash_rows(lcols, nl, lh, lvalid);
+    join_detail::hash_rows(rcols, nr, rh, rvalid);
+
+    const unsigned int bits = partition_bits(std::max(nl, nr));
+    std::vector<unsigned int> lorder, rorder;
+    std::vector<std::size_t> loff, roff;
+    radix_partition(nl, bits, [&](std::size_t r) { return bits ? lh[r] >> (64 - bits) : 0; }, lorder, loff);
+    radix_partition(nr, bits, [&](std::size_t r) { return bits ? rh[r] >> (64 - bits) : 0; }, rorder, roff);
+
+    // Each partition builds a table over its right rows and lists them group by group in its own slice of 'matches'.
+    // Every left row then records where its matching right rows start and how many there are
+    std::vector<unsigned int> matches(nr);
+    std::vector<std::size_t> match_start(nl, 0);
+    std::vector<std::uint32_t> match_count(nl, 0);
+
+    parallel_for_each(0, loff.size() - 1, [&](std::size_t p) {
+        std::vector<long double> key(width);
+
+        GroupTable table(width, roff[p + 1] - roff[p]);
+        std::vector<std::uint32_t> group(roff[p + 1] - roff[p], GroupTable::NONE);
+        std::vector<std::size_t> start;
+
+        for (std::size_t i = roff[p]; i < roff[p + 1]; i++) {
+            unsigned int r = rorder[i];
+            if (!rvalid[r]) continue;
+
+            for (unsigned int k = 0; k < width; k++) key[k] = rcols[k][r];
+            group[i - roff[p]] = table.insert(key.data(), rh[r]);
+            if (group[i - roff[p]] == start.size()) start.push_back(0);
+            start[group[i - roff[p]]]++;
+        }
+
+        std::vector<std::uint32_t> count(start.begin(), start.end());
+        std::size_t pos = roff[p];
+        for (std::size_t g = 0; g < start.size(); g++) { std::size_t c = start[g]; start[g] = pos; pos += c; }
+
+        std::vector<std::size_t> fill(start);
+        for (std::size_t i = roff[p]; i < roff[p + 1]; i++) {
+            if (group[i - roff[p]] != GroupTable::NONE) matches[fill[group[i - roff[p]]]++] = rorder[i];
+        }
+
+        for (std::size_t i = loff[p]; i < loff[p + 1]; i++) {
+            unsigned int l = lorder[i];
+            if (!lvalid[l]) continue;
+
+            for (unsigned int k = 0; k < width; k++) key[k] = lcols[k][l];
+            std::uint32_t g = table.find(key.data(), lh[l]);
+            if (g == GroupTable::NONE) continue;
+
+            match_start[l] = start[g];
+            match_count[l] = count[g];
+        }
+    });
+
+    return join_detail::assemble(left, right, rk, how, match_start, match_count, matches.data());
+}
+
+inline DataSet merge_join(const DataSet &left, const DataSet &right, const std::string &key, JoinType how) {
+    int lk, rk;
+    join_detail::merge_key(left, right, key, true, lk, rk);
+
+    const long double *a = left.get_col_ref(lk).get_data().data(), *b = right.get_col_ref(rk).get_data().data();
+    const std::size_t nl = left.num_rows(), nr = right.num_rows();
+
+    std::vector<std::size_t> match_start(nl, 0);
+    std::vector<std::uint32_t> match_count(nl, 0);
+
+    // Each block of left rows finds where it starts on the right by binary search, then both sides advance together
+    parallel_for(0, nl, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        std::size_t j = std::lower_bound(b, b + nr, a[lo], join_detail::before) - b, k = j;
+
+        for (std::size_t l = lo; l < hi; l++) {
+            if (a[l] != a[l]) break; // Only NaNs remain, and they never match
+
+            if (l == lo || a[l] != a[l - 1]) {
+                while (j < nr && b[j] < a[l]) j++;
+                for (k = j; k < nr && b[k] == a[l]; k++) { }
+            }
+
+            match_start[l] = j;
+            match_count[l] = k - j;
+        }
+    });
+
+    return join_detail::assemble(left, right, {rk}, how, match_start, match_count, nullptr);
+}
+
+inline DataSet asof_join(const DataSet &left, const DataSet &right, const std::string &on, long double tolerance) {
+    int lk, rk;
+    join_detail::merge_key(left, right, on, true, lk, rk);
+
+    const long double *a = left.get_col_ref(lk).get_data().data(), *b = right.get_col_ref(rk).get_data().data();
+    const std::size_t nl = left.num_rows(), nr = right.num_rows();
+
+    std::vector<std::size_t> match_start(nl, 0);
+    std::vector<std::uint32_t> match_count(nl, 0);
+
+    parallel_for(0, nl, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        std::size_t j = std::upper_bound(b, b + nr, a[lo], join_detail::before) - b; // First right row past the left key
+
+        for (std::size_t l = lo; l < hi; l++) {
+            if (a[l] != a[l]) break;
+
+            while (j < nr && b[j] <= a[l]) j++;
+            if (j > 0 && a[l] - b[j - 1] <= tolerance) {
+                match_start[l] = j - 1;
+                match_count[l] = 1;
+            }
+        }
+    });
+
+    return join_detail::assemble(left, right, {rk}, JoinType::LEFT, match_start, match_count, nullptr);
+}
+
+#endif
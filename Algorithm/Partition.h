@@ -0,0 +1,74 @@
+// Radix partitioning of row positions, so that kernels which group or join rows can give each thread a disjoint set of keys
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+inline unsigned int partition_bits(std::size_t rows); // 0 when 'rows' is too few to be worth splitting, otherwise enough bits to keep every thread busy
+
+// Arranges the rows [0, n) in 'order' so that partition p occupies order[offsets[p], offsets[p + 1]), keeping row order within
+// each partition. 'part_of(row)' gives the partition of a row and must be below 1 << bits. Histograms and scatter run in parallel blocks.
+template <typename PartOf>
+inline void radix_partition(std::size_t n, unsigned int bits, PartOf part_of, std::vector<unsigned int> &order, std::vector<std::size_t> &offsets);
+
+/* Definitions */
+
+inline unsigned int partition_bits(std::size_t rows) {
+    if (rows < 2 * (std::size_t)AGGREGATE_GRAIN) return 0;
+
+    unsigned int bits = 0;
+    while ((1u << bits) < 4 * thread_count() && bits < 10) bits++;
+    return bits;
+}
+
+template <typename PartOf>
+inline void radix_partition(std::size_t n, unsigned int bits, PartOf part_of, std::vector<unsigned int> &order, std::vector<std::size_t> &offsets) {
+    const std::size_t parts = (std::size_t)1 << bits;
+    const std::size_t blocks = std::max<std::size_t>(1, (n + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN);
+
+    order.resize(n);
+    offsets.assign(parts + 1, 0);
+
+    if (parts == 1) {
+        for (std::size_t r = 0; r < n; r++) order[r] = r;
+        offsets[1] = n;
+        return;
+    }
+
+    // counts[b * parts + p] is the number of rows of block b in partition p, turned into that block's write position
+    std::vector<std::size_t> counts(blocks * parts, 0);
+
+    parallel_for(0, blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b++) {
+            std::size_t *c = counts.data() + b * parts;
+            for (std::size_t r = b * AGGREGATE_GRAIN; r < std::min(n, (b + 1) * AGGREGATE_GRAIN); r++) c[part_of(r)]++;
+        }
+    });
+
+    std::size_t pos = 0;
+    for (std::size_t p = 0; p < parts; p++) {
+        offsets[p] = pos;
+        for (std::size_t b = 0; b < blocks; b++) {
+            std::size_t c = counts[b * parts + p];
+            counts[b * parts + p] = pos;
+            pos += c;
+        }
+    }
+    offsets[parts] = pos;
+
+    parallel_for(0, blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b++) {
+            std::size_t *c = counts.data() + b * parts;
+            for (std::size_t r = b * AGGREGATE_GRAIN; r < std::min(n, (b + 1) * AGGREGATE_GRAIN); r++) order[c[part_of(r)]++] = r;
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,275 @@
+// Row predicates over the columns of a DataSet. Predicates are small expression trees built with field() and combined with &&, || and !
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <iostream>
+
+#include "Select.h"
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+class Predicate {
+    private:
+        enum class Kind { COMPARE, TERM, BETWEEN, NULLS, AND, OR, NOT };
+
+        struct Node {
+            Kind kind;
+            std::string label;                     // Column the leaf reads
+            Compare op = Compare::EQ;
+            long double lo = 0, hi = 0;            // 'lo' is the comparison value for COMPARE
+            std::string term;                      // String compared against for TERM
+            std::shared_ptr<const Node> left, right;
+        };
+
+        std::shared_ptr<const Node> node;
+
+        explicit Predicate(std::shared_ptr<const Node> node) : node(node) { }
+
+        static Bitmask evaluate(const Node &n, const DataSet &ds, std::size_t begin, std::size_t end, Bitmask *unknown = nullptr); // Also sets 'unknown' to the rows a null leaves undecided
+        static void get_labels(const Node &n, std::vector<std::string> &out);
+        static void conjuncts(const std::shared_ptr<const Node> &n, std::vector<Predicate> &out);
+        static void to_string(const Node &n, std::ostream &os);
+
+    public:
+        static Predicate compare(const std::string &label, Compare op, long double value);       // label op value
+        static Predicate compare(const std::string &label, Compare op, const std::string &term); // Categorical columns only. Only EQ and NE are allowed
+        static Predicate between(const std::string &label, long double lo, long double hi);      // lo <= label <= hi
+        static Predicate is_null(const std::string &label);                                      // The value is NaN
+
+        Bitmask evaluate(const DataSet &ds) const;     // One bit per row of 'ds'. Throws if a column is missing
+        Bitmask evaluate(const DataSet &ds, std::size_t begin, std::size_t end) const; // Rows [begin, end) only. Bit i stands for row 'begin + i'
+        std::vector<std::string> get_labels() const;  // Labels of every column the predicate reads, without repeats
+        std::string to_string() const;                // Readable form, e.g. "((x > 1) && !(y is null))"
+        std::vector<Predicate> conjuncts() const;     // The operands of the top-level &&s, left to right. Just this predicate if it is not an &&
+
+        friend Predicate operator&&(const Predicate &a, const Predicate &b);
+        friend Predicate operator||(const Predicate &a, const Predicate &b);
+        friend Predicate operator!(const Predicate &a); // Rows where 'a' is undecided because of a null stay out, so !(x == 5) matches x != 5
+};
+
+// Names a column so predicates can be written as 'field("x") > 1 && field("city") == "Paris"'
+struct Field {
+    std::string label;
+
+    Predicate operator<(long double v) const { return Predicate::compare(label, Compare::LT, v); }
+    Predicate operator<=(long double v) const { return Predicate::compare(label, Compare::LE, v); }
+    Predicate operator>(long double v) const { return Predicate::compare(label, Compare::GT, v); }
+    Predicate operator>=(long double v) const { return Predicate::compare(label, Compare::GE, v); }
+    Predicate operator==(long double v) const { return Predicate::compare(label, Compare::EQ, v); }
+    Predicate operator!=(long double v) const { return Predicate::compare(label, Compare::NE, v); }
+    Predicate operator==(const std::string &term) const { return Predicate::compare(label, Compare::EQ, term); }
+    Predicate operator!=(const std::string &term) const { return Predicate::compare(label, Compare::NE, term); }
+
+    Predicate between(long double lo, long double hi) const { return Predicate::between(label, lo, hi); }
+    Predicate is_null() const { return Predicate::is_null(label); }
+    Predicate not_null() const { return !Predicate::is_null(label); }
+};
+
+inline Field field(const std::string &label) { return Field{label}; }
+
+/* Definitions */
+
+inline Predicate Predicate::compare(const std::string &label, Compare op, long double value) {
+    Node n;
+    n.kind = Kind::COMPARE;
+    n.label = label;
+    n.op = op;
+    n.lo = value;
+    return Predicate(std::make_shared<const Node>(n));
+}
+
+inline Predicate Predicate::compare(const std::string &label, Compare op, const std::string &term) {
+    if (op != Compare::EQ && op != Compare::NE) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Predicate::compare() -> Strings can only be tested for equality!" << std::endl;
+        throw -1;
+    }
+
+    Node n;
+    n.kind = Kind::TERM;
+    n.label = label;
+    n.op = op;
+    n.term = term;
+    return Predicate(std::make_shared<const Node>(n));
+}
+
+inline Predicate Predicate::between(const std::string &label, long double lo, long double hi) {
+    Node n;
+    n.kind = Kind::BETWEEN;
+    n.label = label;
+    n.lo = lo;
+    n.hi = hi;
+    return Predicate(std::make_shared<const Node>(n));
+}
+
+inline Predicate Predicate::is_null(const std::string &label) {
+    Node n;
+    n.kind = Kind::NULLS;
+    n.label = label;
+    return Predicate(std::make_shared<const Node>(n));
+}
+
+inline Predicate operator&&(const Predicate &a, const Predicate &b) {
+    Predicate::Node n;
+    n.kind = Predicate::Kind::AND;
+    n.left = a.node;
+    n.right = b.node;
+    return Predicate(std::make_shared<const Predicate::Node>(n));
+}
+
+inline Predicate operator||(const Predicate &a, const Predicate &b) {
+    Predicate::Node n;
+    n.kind = Predicate::Kind::OR;
+    n.left = a.node;
+    n.right = b.node;
+    return Predicate(std::make_shared<const Predicate::Node>(n));
+}
+
+inline Predicate operator!(const Predicate &a) {
+    Predicate::Node n;
+    n.kind = Predicate::Kind::NOT;
+    n.left = a.node;
+    return Predicate(std::make_shared<const Predicate::Node>(n));
+}
+
+inline Bitmask Predicate::evaluate(const DataSet &ds) const {
+    return evaluate(*node, ds, 0, ds.num_rows());
+}
+
+inline Bitmask Predicate::evaluate(const DataSet &ds, std::size_t begin, std::size_t end) const {
+    if (begin > end || end > ds.num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Predicate::evaluate() -> Row range out of bounds!" << std::endl;
+        throw -1;
+    }
+
+    return evaluate(*node, ds, begin, end);
+}
+
+// Nulls follow SQL's three-valued logic: a comparison on a null is undecided rather than false, && and || keep a row undecided
+// only while the other side cannot settle it, and ! leaves undecided rows out. Only a ! needs the undecided rows, so they are
+// worked out below one and nowhere else
+inline Bitmask Predicate::evaluate(const Node &n, const DataSet &ds, std::size_t begin, std::size_t end, Bitmask *unknown) {
+    Bitmask left_unknown, right_unknown;
+
+    switch (n.kind) {
+        case Kind::AND: {
+            Bitmask left = evaluate(*n.left, ds, begin, end, unknown ? &left_unknown : nullptr);
+            if (left.count() == 0 && (!unknown || left_unknown.count() == 0)) { // Nothing left to narrow down
+                if (unknown) *unknown = left_unknown;
+                return left;
+            }
+
+            Bitmask right = evaluate(*n.right, ds, begin, end, unknown ? &right_unknown : nullptr);
+            if (unknown) *unknown = (left_unknown & (right | right_unknown)) | (left & right_unknown);
+            return left & right;
+        }
+        case Kind::OR: {
+            Bitmask left = evaluate(*n.left, ds, begin, end, unknown ? &left_unknown : nullptr);
+            if (left.count() == left.size()) {
+                if (unknown) *unknown = Bitmask(end - begin);
+                return left;
+            }
+
+            Bitmask out = left | evaluate(*n.right, ds, begin, end, unknown ? &right_unknown : nullptr);
+            if (unknown) *unknown = (left_unknown | right_unknown) & ~out;
+            return out;
+        }
+        case Kind::NOT: {
+            Bitmask inner = evaluate(*n.left, ds, begin, end, &left_unknown);
+            if (unknown) *unknown = left_unknown;
+            return ~(inner | left_unknown);
+        }
+        default: break;
+    }
+
+    int index = ds.get_col_index(n.label);
+
+    if (index < 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Predicate::evaluate() -> No column labelled '" << n.label << "'!" << std::endl;
+        throw -1;
+    }
+
+    const long double *col = ds.get_col_ref(index).get_data().data() + begin;
+    const std::size_t rows = end - begin;
+
+    if (unknown) *unknown = n.kind == Kind::NULLS ? Bitmask(rows) : null_values(col, rows);
+
+    switch (n.kind) {
+        case Kind::COMPARE: return compare_values(col, rows, n.op, n.lo);
+        case Kind::BETWEEN: return between_values(col, rows, n.lo, n.hi);
+        case Kind::NULLS: return null_values(col, rows);
+        case Kind::TERM: {
+            // A term the map has never seen matches nothing, so EQ is empty and NE keeps every value that is present
+            auto map = ds.get_map_ptr();
+            if (map && map->has_value(n.term)) return compare_values(col, rows, n.op, map->get_key(n.term));
+            return n.op == Compare::EQ ? Bitmask(rows) : ~null_values(col, rows);
+        }
+        default: return Bitmask(rows);
+    }
+}
+
+inline std::vector<std::string> Predicate::get_labels() const {
+    std::vector<std::string> out;
+    get_labels(*node, out);
+    return out;
+}
+
+inline void Predicate::get_labels(const Node &n, std::vector<std::string> &out) {
+    if (n.left) get_labels(*n.left, out);
+    if (n.right) get_labels(*n.right, out);
+    if (n.left || n.right) return;
+
+    for (const std::string &label : out) {
+        if (label == n.label) return;
+    }
+    out.push_back(n.label);
+}
+
+inline std::vector<Predicate> Predicate::conjuncts() const {
+    std::vector<Predicate> out;
+    conjuncts(node, out);
+    return out;
+}
+
+inline void Predicate::conjuncts(const std::shared_ptr<const Node> &n, std::vector<Predicate> &out) {
+    if (n->kind != Kind::AND) {
+        out.push_back(Predicate(n));
+        return;
+    }
+
+    conjuncts(n->left, out);
+    conjuncts(n->right, out);
+}
+
+inline std::string Predicate::to_string() const {
+    std::ostringstream os;
+    to_string(*node, os);
+    return os.str();
+}
+
+inline void Predicate::to_string(const Node &n, std::ostream &os) {
+    static const char *ops[] = { "<", "<=", ">", ">=", "==", "!=" };
+
+    switch (n.kind) {
+        case Kind::COMPARE: os << "(" << n.label << " " << ops[(int)n.op] << " " << n.lo << ")"; break;
+        case Kind::TERM: os << "(" << n.label << " " << ops[(int)n.op] << " \"" << n.term << "\")"; break;
+        case Kind::BETWEEN: os << "(" << n.label << " between " << n.lo << " and " << n.hi << ")"; break;
+        case Kind::NULLS: os << "(" << n.label << " is null)"; break;
+        case Kind::NOT: os << "!"; to_string(*n.left, os); break;
+        case Kind::AND:
+        case Kind::OR:
+            os << "(";
+            to_string(*n.left, os);
+            os << (n.kind == Kind::AND ? " && " : " || ");
+            to_string(*n.right, os);
+            os << ")";
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,252 @@
+// Feature scaling: learns a centre and a scale for each column of a DataSet, then rewrites the columns in place as
+// (x - centre) / scale. Missing values stay missing.
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "Aggregate.h"
+#include "../Container/DataSet.h"
+#include "../Container/TDigest.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// STANDARD: mean and population standard deviation. MIN_MAX: minimum and range, onto [0, 1]. ROBUST: median and interquartile
+// range, estimated with a t-digest so that outliers barely move them
+enum class Scaling { STANDARD, MIN_MAX, ROBUST };
+
+// Fitting reads every (column, row block) pair as a separate task on the pool, in one pass over the data. Each task range folds
+// its blocks of a column together and merges them into that column's statistics once, so memory does not grow with the rows.
+// Transforming walks the rows in blocks and rewrites all the fitted columns of a block in place.
+//   Scaler s(Scaling::ROBUST);
+//   s.fit_transform(train);
+//   s.transform(test);
+class Scaler {
+    private:
+        Scaling kind;
+        std::vector<std::string> labels;
+        std::vector<long double> centre;
+        std::vector<long double> scale; // Never 0: a column without spread keeps a scale of 1, like scikit-learn
+
+        std::vector<long double*> targets(DataSet &ds, const char *caller) const; // The fitted columns of 'ds'. Throws if one is missing
+        template <typename Function>
+        void apply(DataSet &ds, const char *caller, Function fn) const;           // x = fn(x, column) for every value of the fitted columns
+
+    public:
+        Scaler(Scaling kind = Scaling::STANDARD) : kind(kind) { }
+
+        void fit(const DataSet &ds, const std::vector<std::string> &labels = {}); // With no labels, every numeric column that is not masked. Throws on categorical columns
+        void transform(DataSet &ds) const;                                          // Scales the fitted columns of 'ds', matched by label
+        void inverse_transform(DataSet &ds) const;                                  // Undoes transform()
+        void fit_transform(DataSet &ds, const std::vector<std::string> &labels = {}) { fit(ds, labels); transform(ds); }
+
+        Scaling get_kind() const { return kind; }
+        const std::vector<std::string>& get_labels() const { return labels; }
+        const std::vector<long double>& get_centre() const { return centre; }
+        const std::vector<long double>& get_scale() const { return scale; }
+
+        void serialize(std::ostream &os) const; // Binary form, readable by deserialize() on a machine with the same long double
+        static Scaler deserialize(std::istream &is);
+};
+
+/* Definitions */
+
+namespace scaler_detail {
+    // Statistics of a column over some of its blocks. Only ROBUST needs a digest, so it is only allocated then
+    struct Partial {
+        Moments moments;
+        long double min = NAN;
+        long double max = NAN;
+        std::unique_ptr<TDigest> digest;
+
+        explicit Partial(Scaling kind) : digest(kind == Scaling::ROBUST ? new TDigest() : nullptr) { }
+    };
+
+    inline void fit_block(Scaling kind, const long double *v, std::size_t lo, std::size_t hi, Partial &p) {
+        switch (kind) {
+            case Scaling::STANDARD: p.moments.merge(agg_moments(v + lo, hi - lo)); break;
+            case Scaling::MIN_MAX: {
+                long double min = agg_min(v + lo, hi - lo), max = agg_max(v + lo, hi - lo);
+                if (min < p.min || p.min != p.min) p.min = min;
+                if (max > p.max || p.max != p.max) p.max = max;
+                break;
+            }
+            case Scaling::ROBUST: for (std::size_t i = lo; i < hi; i++) p.digest->add(v[i]); break;
+        }
+    }
+
+    inline void merge(Partial &total, const Partial &p) {
+        total.moments.merge(p.moments);
+        if (p.min < total.min || total.min != total.min) total.min = p.min;
+        if (p.max > total.max || total.max != total.max) total.max = p.max;
+        if (p.digest) total.digest->merge(*p.digest);
+    }
+}
+
+inline void Scaler::fit(const DataSet &ds, const std::vector<std::string> &labels) {
+    using namespace scaler_detail;
+
+    std::vector<std::string> used = labels;
+    if (used.empty()) {
+        for (unsigned int c = 0; c < ds.num_cols(); c++) {
+            const Column &col = ds.get_col_ref(c);
+            if (!col.is_masked() && !col.is_categorical()) used.push_back(col.get_label());
+        }
+    }
+
+    std::vector<const long double*> cols;
+    for (const std::string &label : used) {
+        const Column &col = ds[label];
+
+        if (col.is_categorical()) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> Scaler::fit() -> Column '" << label << "' holds category codes!" << std::endl;
+            throw -1;
+        }
+        cols.push_back(col.get_data().data());
+    }
+
+    // One accumulator per column, as describe() keeps its distinct-count sketches
+    std::vector<Partial> totals;
+    for (std::size_t c = 0; c < cols.size(); c++) totals.emplace_back(kind);
+
+    aggregate_detail::fold_columns(cols.size(), ds.num_rows(), [&] { return Partial(kind); },
+        [&](Partial &local, std::size_t c, std::size_t, std::size_t lo, std::size_t hi) { fit_block(kind, cols[c], lo, hi, local); },
+        [&](std::size_t c, const Partial &local) { merge(totals[c], local); });
+
+    std::vector<long double> fitted_centre(cols.size()), fitted_scale(cols.size());
+
+    parallel_for_each(0, cols.size(), [&](std::size_t c) {
+        const Partial &total = totals[c];
+
+        long double spread = NAN;
+        switch (kind) {
+            case Scaling::STANDARD:
+                fitted_centre[c] = total.moments.count ? total.moments.mean : NAN;
+                spread = std::sqrt(total.moments.variance(0));
+                break;
+            case Scaling::MIN_MAX:
+                fitted_centre[c] = total.min;
+                spread = total.max - total.min;
+                break;
+            case Scaling::ROBUST:
+                fitted_centre[c] = total.digest->quantile(0.5);
+                spread = total.digest->quantile(0.75) - total.digest->quantile(0.25);
+                break;
+        }
+        fitted_scale[c] = spread > 0 ? spread : 1;
+    });
+
+    this->labels = used;
+    centre = std::move(fitted_centre);
+    scale = std::move(fitted_scale);
+}
+
+inline std::vector<long double*> Scaler::targets(DataSet &ds, const char *caller) const {
+    std::vector<long double*> out;
+
+    for (const std::string &label : labels) {
+        int index = ds.get_col_index(label);
+
+        if (index < 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> Scaler::" << caller << "() -> No column labelled '" << label << "'!" << std::endl;
+            throw -1;
+        }
+        out.push_back(ds.at(index).data());
+    }
+
+    return out;
+}
+
+template <typename Function>
+void Scaler::apply(DataSet &ds, const char *caller, Function fn) const {
+    std::vector<long double*> cols = targets(ds, caller);
+
+    parallel_for(0, ds.num_rows(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t c = 0; c < cols.size(); c++) {
+            long double *v = cols[c];
+            for (std::size_t r = lo; r < hi; r++) v[r] = fn(v[r], c);
+        }
+    });
+}
+
+inline void Scaler::transform(DataSet &ds) const {
+    // Multiplying by the reciprocal keeps the loop free of divisions
+    std::vector<long double> inverse(scale.size());
+    for (std::size_t c = 0; c < scale.size(); c++) inverse[c] = 1 / scale[c];
+
+    apply(ds, "transform", [&](long double x, std::size_t c) { return (x - centre[c]) * inverse[c]; });
+}
+
+inline void Scaler::inverse_transform(DataSet &ds) const {
+    apply(ds, "inverse_transform", [&](long double x, std::size_t c) { return x * scale[c] + centre[c]; });
+}
+
+inline void Scaler::serialize(std::ostream &os) const {
+    const std::uint8_t width = sizeof(long double), code = (std::uint8_t)kind;
+    const std::uint64_t n = labels.size();
+
+    os.write("SCL1", 4);
+    os.write(reinterpret_cast<const char*>(&width), 1);
+    os.write(reinterpret_cast<const char*>(&code), 1);
+    os.write(reinterpret_cast<const char*>(&n), 8);
+
+    for (std::size_t c = 0; c < labels.size(); c++) {
+        const std::uint64_t length = labels[c].size();
+        os.write(reinterpret_cast<const char*>(&length), 8);
+        os.write(labels[c].data(), length);
+        os.write(reinterpret_cast<const char*>(&centre[c]), sizeof(long double));
+        os.write(reinterpret_cast<const char*>(&scale[c]), sizeof(long double));
+    }
+}
+
+inline Scaler Scaler::deserialize(std::istream &is) {
+    char magic[4] = { 0 };
+    std::uint8_t width = 0, code = 0;
+    std::uint64_t n = 0;
+    is.read(magic, 4);
+    is.read(reinterpret_cast<char*>(&width), 1);
+    is.read(reinterpret_cast<char*>(&code), 1);
+    is.read(reinterpret_cast<char*>(&n), 8);
+
+    if (!is || std::memcmp(magic, "SCL1", 4) != 0 || width != sizeof(long double) || code > (std::uint8_t)Scaling::ROBUST) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Scaler::deserialize() -> Not a scaler written on this platform!" << std::endl;
+        throw -1;
+    }
+
+    Scaler out((Scaling)code);
+    for (std::uint64_t c = 0; c < n && is; c++) {
+        std::uint64_t length = 0;
+        is.read(reinterpret_cast<char*>(&length), 8);
+        if (!is || length > (1 << 20)) break; // Labels are short; a huge length means the stream is corrupt
+
+        std::string label(length, '\0');
+        long double mid = 0, spread = 0;
+        is.read(&label[0], length);
+        is.read(reinterpret_cast<char*>(&mid), sizeof(long double));
+        is.read(reinterpret_cast<char*>(&spread), sizeof(long double));
+
+        out.labels.push_back(label);
+        out.centre.push_back(mid);
+        out.scale.push_back(spread);
+    }
+
+    if (!is || out.labels.size() != n) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Scaler::deserialize() -> Scaler is truncated!" << std::endl;
+        throw -1;
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,100 @@
+// Prefix-scan and lagged-difference kernels over raw arrays of long doubles. NaN marks a missing value: it is skipped by the
+// scans and left as NaN in their output.
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+enum class Scan { SUM, PROD, MIN, MAX };
+
+// out[i] = v[0] op v[1] op ... op v[i]. Runs as a two-pass block scan: every block folds its own values in parallel, the block
+// totals are scanned in order, and every block then scans itself again starting from the total of the blocks before it.
+// Sums and products are grouped by block, so they can round differently from a strictly left-to-right loop
+inline void scan_values(const long double *v, std::size_t n, Scan op, long double *out);
+
+inline void diff_values(const long double *v, std::size_t n, std::size_t periods, long double *out);       // out[i] = v[i] - v[i - periods], NaN for the first rows
+inline void pct_change_values(const long double *v, std::size_t n, std::size_t periods, long double *out); // out[i] = v[i] / v[i - periods] - 1, NaN for the first rows
+
+/* Definitions */
+
+namespace scan_detail {
+    inline long double identity(Scan op) {
+        switch (op) {
+            case Scan::SUM: return 0;
+            case Scan::PROD: return 1;
+            case Scan::MIN: return INFINITY;
+            default: return -INFINITY;
+        }
+    }
+
+    inline long double apply(Scan op, long double a, long double b) {
+        switch (op) {
+            case Scan::SUM: return a + b;
+            case Scan::PROD: return a * b;
+            case Scan::MIN: return b < a ? b : a;
+            default: return b > a ? b : a;
+        }
+    }
+
+    // Folds v[lo, hi) onto 'carry'. If 'out' is given, writes the running value at every row, or NaN where v is missing
+    template <Scan Op>
+    inline long double fold(const long double *v, std::size_t lo, std::size_t hi, long double carry, long double *out) {
+        for (std::size_t i = lo; i < hi; i++) {
+            if (v[i] == v[i]) carry = apply(Op, carry, v[i]);
+            if (out) out[i] = v[i] == v[i] ? carry : NAN;
+        }
+        return carry;
+    }
+
+    template <Scan Op>
+    inline void scan(const long double *v, std::size_t n, long double *out) {
+        const std::size_t blocks = (n + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN;
+        if (blocks <= 1) { fold<Op>(v, 0, n, identity(Op), out); return; }
+
+        std::vector<long double> carry(blocks + 1, identity(Op));
+
+        parallel_for_each(0, blocks, [&](std::size_t b) {
+            carry[b + 1] = fold<Op>(v, b * AGGREGATE_GRAIN, std::min(n, (b + 1) * AGGREGATE_GRAIN), identity(Op), nullptr);
+        });
+        for (std::size_t b = 0; b < blocks; b++) carry[b + 1] = apply(Op, carry[b], carry[b + 1]);
+
+        parallel_for_each(0, blocks, [&](std::size_t b) {
+            fold<Op>(v, b * AGGREGATE_GRAIN, std::min(n, (b + 1) * AGGREGATE_GRAIN), carry[b], out);
+        });
+    }
+
+    // out[i] = fn(v[i], v[i - periods]) in parallel. The first 'periods' rows have no earlier value
+    template <typename Function>
+    inline void lagged(const long double *v, std::size_t n, std::size_t periods, long double *out, Function fn) {
+        parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) out[i] = i < periods ? NAN : fn(v[i], v[i - periods]);
+        });
+    }
+}
+
+inline void scan_values(const long double *v, std::size_t n, Scan op, long double *out) {
+    switch (op) {
+        case Scan::SUM: scan_detail::scan<Scan::SUM>(v, n, out); break;
+        case Scan::PROD: scan_detail::scan<Scan::PROD>(v, n, out); break;
+        case Scan::MIN: scan_detail::scan<Scan::MIN>(v, n, out); break;
+        case Scan::MAX: scan_detail::scan<Scan::MAX>(v, n, out); break;
+    }
+}
+
+inline void diff_values(const long double *v, std::size_t n, std::size_t periods, long double *out) {
+    scan_detail::lagged(v, n, periods, out, [](long double x, long double prev) { return x - prev; });
+}
+
+inline void pct_change_values(const long double *v, std::size_t n, std::size_t periods, long double *out) {
+    scan_detail::lagged(v, n, periods, out, [](long double x, long double prev) { return x / prev - 1; });
+}
+
+#endif
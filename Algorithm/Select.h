@@ -0,0 +1,188 @@
+// Bitmasks and selection vectors over rows, the comparison kernels that build them, and the gather kernel that applies them
+#ifndef SELECT_H
+#define SELECT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "../util/Bits.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+enum class Compare { LT, LE, GT, GE, EQ, NE };
+
+// One bit per row, 64 rows per word. Bits past the last row are always clear
+class Bitmask {
+    private:
+        std::vector<std::uint64_t> words;
+        std::size_t rows;
+
+        void clear_tail(); // Clears the bits past the last row
+
+    public:
+        Bitmask() : rows(0) { }
+        Bitmask(std::size_t rows, bool value = false); // A mask of 'rows' bits, all set to 'value'
+
+        std::size_t size() const { return rows; }
+        bool test(std::size_t row) const { return (words[row >> 6] >> (row & 63)) & 1; }
+        void set(std::size_t row, bool value);
+        std::size_t count() const;                     // Number of set bits
+
+        std::vector<std::uint64_t>& get_words() { return words; }
+        const std::vector<std::uint64_t>& get_words() const { return words; }
+
+        Bitmask operator&(const Bitmask &other) const;
+        Bitmask operator|(const Bitmask &other) const;
+        Bitmask operator~() const;
+
+        std::vector<unsigned int> to_selection() const; // Positions of the set bits, in ascending order
+};
+
+// Bit i is set when 'v[i] op value' holds. NaN is missing, so it never matches, not even for NE
+inline Bitmask compare_values(const long double *v, std::size_t n, Compare op, long double value);
+inline Bitmask between_values(const long double *v, std::size_t n, long double lo, long double hi); // lo <= v[i] <= hi
+inline Bitmask null_values(const long double *v, std::size_t n);                                   // Bit i is set when v[i] is NaN
+
+// dst[c][i] = src[c][rows[i]] for every column c. Rows are handed out in blocks, and each block is gathered for every column
+// before moving on, so its row positions stay in cache while they are reused
+inline void gather(const std::vector<const long double*> &src, const unsigned int *rows, std::size_t n, const std::vector<long double*> &dst);
+
+/* Definitions */
+
+namespace select_detail {
+    // Builds the mask a word at a time. Each word is assembled from 64 comparisons without branches
+    template <typename Test>
+    inline Bitmask build(std::size_t n, Test test) {
+        Bitmask mask(n);
+        std::vector<std::uint64_t> &words = mask.get_words();
+
+        parallel_for(0, words.size(), AGGREGATE_GRAIN / 64, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t w = lo; w < hi; w++) {
+                std::size_t base = w * 64, end = std::min(n, base + 64);
+                std::uint64_t word = 0;
+
+                for (std::size_t i = base; i < end; i++) word |= (std::uint64_t)test(i) << (i - base);
+                words[w] = word;
+            }
+        });
+
+        return mask;
+    }
+
+    template <typename Op>
+    inline Bitmask combine(const Bitmask &a, const Bitmask &b, Op op) {
+        Bitmask out(a.size());
+        const std::vector<std::uint64_t> &x = a.get_words(), &y = b.get_words();
+        std::vector<std::uint64_t> &z = out.get_words();
+
+        for (std::size_t w = 0; w < z.size(); w++) z[w] = op(x[w], y[w]);
+        return out;
+    }
+}
+
+inline Bitmask::Bitmask(std::size_t rows, bool value) : words((rows + 63) / 64, value ? ~0ULL : 0), rows(rows) {
+    clear_tail();
+}
+
+inline void Bitmask::clear_tail() {
+    if (rows % 64 != 0) words.back() &= (1ULL << (rows % 64)) - 1;
+}
+
+inline void Bitmask::set(std::size_t row, bool value) {
+    if (value) words[row >> 6] |= 1ULL << (row & 63);
+    else words[row >> 6] &= ~(1ULL << (row & 63));
+}
+
+inline std::size_t Bitmask::count() const {
+    std::size_t c = 0;
+    for (std::uint64_t w : words) c += popcount64(w);
+    return c;
+}
+
+inline Bitmask Bitmask::operator&(const Bitmask &other) const {
+    return select_detail::combine(*this, other, [](std::uint64_t a, std::uint64_t b) { return a & b; });
+}
+
+inline Bitmask Bitmask::operator|(const Bitmask &other) const {
+    return select_detail::combine(*this, other, [](std::uint64_t a, std::uint64_t b) { return a | b; });
+}
+
+inline Bitmask Bitmask::operator~() const {
+    Bitmask out(*this);
+    for (std::uint64_t &w : out.words) w = ~w;
+    out.clear_tail();
+    return out;
+}
+
+inline std::vector<unsigned int> Bitmask::to_selection() const {
+    // Count the set bits of each range of words, then let every range write its own slice of the output
+    const std::size_t grain = AGGREGATE_GRAIN / 64;
+    const std::size_t ranges = std::max<std::size_t>(1, (words.size() + grain - 1) / grain);
+    std::vector<std::size_t> offsets(ranges + 1, 0);
+
+    parallel_for(0, ranges, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t r = lo; r < hi; r++) {
+            for (std::size_t w = r * grain; w < std::min(words.size(), (r + 1) * grain); w++) offsets[r + 1] += popcount64(words[w]);
+        }
+    });
+    for (std::size_t r = 0; r < ranges; r++) offsets[r + 1] += offsets[r];
+
+    std::vector<unsigned int> out(offsets.back());
+
+    parallel_for(0, ranges, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t r = lo; r < hi; r++) {
+            std::size_t pos = offsets[r];
+
+            for (std::size_t w = r * grain; w < std::min(words.size(), (r + 1) * grain); w++) {
+                for (std::uint64_t bits = words[w]; bits; bits &= bits - 1) out[pos++] = w * 64 + ctz64(bits);
+            }
+        }
+    });
+
+    return out;
+}
+
+inline Bitmask compare_values(const long double *v, std::size_t n, Compare op, long double value) {
+    using select_detail::build;
+
+    switch (op) {
+        case Compare::LT: return build(n, [=](std::size_t i) { return v[i] < value; });
+        case Compare::LE: return build(n, [=](std::size_t i) { return v[i] <= value; });
+        case Compare::GT: return build(n, [=](std::size_t i) { return v[i] > value; });
+        case Compare::GE: return build(n, [=](std::size_t i) { return v[i] >= value; });
+        case Compare::EQ: return build(n, [=](std::size_t i) { return v[i] == value; });
+        case Compare::NE: return build(n, [=](std::size_t i) { return (v[i] != value) & (v[i] == v[i]); });
+    }
+
+    return Bitmask(n);
+}
+
+inline Bitmask between_values(const long double *v, std::size_t n, long double lo, long double hi) {
+    return select_detail::build(n, [=](std::size_t i) { return (v[i] >= lo) & (v[i] <= hi); });
+}
+
+inline Bitmask null_values(const long double *v, std::size_t n) {
+    return select_detail::build(n, [=](std::size_t i) { return v[i] != v[i]; });
+}
+
+inline void gather(const std::vector<const long double*> &src, const unsigned int *rows, std::size_t n, const std::vector<long double*> &dst) {
+    const std::size_t block = 4096;
+
+    parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b += block) {
+            std::size_t e = std::min(hi, b + block);
+
+            for (std::size_t c = 0; c < src.size(); c++) {
+                const long double *s = src[c];
+                long double *d = dst[c];
+                for (std::size_t i = b; i < e; i++) d[i] = s[rows[i]];
+            }
+        }
+    });
+}
+
+#endif
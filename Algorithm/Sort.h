@@ -0,0 +1,213 @@
+// Ordering kernels over raw arrays of long doubles. NaN marks a missing value and orders after every other value
+#ifndef SORT_H
+#define SORT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include "Aggregate.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+inline bool is_sorted_values(const long double *v, std::size_t n); // True if the values never decrease and any NaNs all come at the end
+
+// The permutation that stably sorts rows [0, n) on 'cols', the first column deciding and each later one breaking ties.
+// 'ascending' holds one flag per column, or is empty for all ascending. NaNs come last in either direction.
+// Columns whose values are all exact doubles are radix sorted on their bit patterns, least significant column first, with the
+// histograms and scatter of every pass split across threads. Any other column falls back to a comparison sort.
+inline std::vector<unsigned int> argsort_columns(const std::vector<const long double*> &cols, std::size_t n, const std::vector<bool> &ascending);
+
+// Rows of the 'k' largest values, or the smallest if 'largest' is false, best first. Ties go to the earlier row and NaNs are never picked.
+// Every block keeps a bounded heap and only touches it for values that beat the heap's worst, so most values cost one comparison.
+// The heaps are merged at the end. Runs in O(n log k) rather than the O(n log n) of a full sort.
+inline std::vector<unsigned int> top_k_values(const long double *v, std::size_t n, std::size_t k, bool largest = true);
+
+/* Definitions */
+
+inline bool is_sorted_values(const long double *v, std::size_t n) {
+    if (n < 2) return true;
+
+    // Each adjacent pair is checked on its own, so blocks only need to overlap by one value.
+    // The partial results are chars: a vector<bool> would pack them into shared words
+    return aggregate_detail::reduce<char>(n - 1, 1, [&](std::size_t lo, std::size_t hi) -> char {
+        for (std::size_t i = lo; i < hi; i++) {
+            if (!(v[i + 1] != v[i + 1] || v[i] <= v[i + 1])) return 0;
+        }
+        return 1;
+    }, [](char a, char b) -> char { return a && b; });
+}
+
+namespace sort_detail {
+    inline bool exact_doubles(const long double *v, std::size_t n) {
+        return aggregate_detail::reduce<char>(n, 1, [&](std::size_t lo, std::size_t hi) -> char {
+            for (std::size_t i = lo; i < hi; i++) {
+                if (v[i] == v[i] && (long double)(double)v[i] != v[i]) return 0;
+            }
+            return 1;
+        }, [](char a, char b) -> char { return a && b; });
+    }
+
+    // Flips a double's bits so that unsigned order is numeric order. 0 and -0 share a key and NaN sorts after everything
+    inline std::uint64_t key_bits(long double v, bool ascending) {
+        if (v != v) return ~0ULL;
+
+        double d = v;
+        if (d == 0) d = 0;
+
+        std::uint64_t b;
+        std::memcpy(&b, &d, sizeof(b));
+        b = (b >> 63) ? ~b : b | (1ULL << 63);
+
+        return ascending ? b : ~b;
+    }
+
+    // One stable LSD pass per byte of the keys, skipping bytes on which every key agrees. 'keys' follows 'perm' around
+    inline void radix_sort(std::vector<std::uint64_t> &keys, std::vector<unsigned int> &perm) {
+        const std::size_t n = keys.size();
+        const std::size_t blocks = std::max<std::size_t>(1, (n + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN);
+
+        // Which bytes vary does not depend on the order, so one read up front finds the passes that can be skipped
+        std::vector<std::uint64_t> seen = { 0, ~0ULL }; // OR and AND of every key
+        seen = aggregate_detail::reduce<std::vector<std::uint64_t>>(n, seen, [&](std::size_t lo, std::size_t hi) {
+            std::vector<std::uint64_t> s = { 0, ~0ULL };
+            for (std::size_t i = lo; i < hi; i++) { s[0] |= keys[i]; s[1] &= keys[i]; }
+            return s;
+        }, [](std::vector<std::uint64_t> x, const std::vector<std::uint64_t> &y) { x[0] |= y[0]; x[1] &= y[1]; return x; });
+
+        std::vector<std::uint64_t> keys_out(n);
+        std::vector<unsigned int> perm_out(n);
+        std::vector<std::size_t> counts(blocks * 256);
+
+        for (unsigned int d = 0; d < 8; d++) {
+            if ((((seen[0] ^ seen[1]) >> (8 * d)) & 255) == 0) continue;
+
+            std::fill(counts.begin(), counts.end(), 0);
+            parallel_for(0, blocks, 1, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t b = lo; b < hi; b++) {
+                    std::size_t *c = counts.data() + b * 256;
+                    for (std::size_t i = b * AGGREGATE_GRAIN; i < std::min(n, (b + 1) * AGGREGATE_GRAIN); i++) c[(keys[i] >> (8 * d)) & 255]++;
+                }
+            });
+
+            // Write positions for every (byte value, block), in byte-major order so that the pass is stable
+            std::size_t pos = 0;
+            for (std::size_t v = 0; v < 256; v++) {
+                for (std::size_t b = 0; b < blocks; b++) {
+                    std::size_t c = counts[b * 256 + v];
+                    counts[b * 256 + v] = pos;
+                    pos += c;
+                }
+            }
+
+            parallel_for(0, blocks, 1, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t b = lo; b < hi; b++) {
+                    std::size_t *c = counts.data() + b * 256;
+                    for (std::size_t i = b * AGGREGATE_GRAIN; i < std::min(n, (b + 1) * AGGREGATE_GRAIN); i++) {
+                        std::size_t p = c[(keys[i] >> (8 * d)) & 255]++;
+                        keys_out[p] = keys[i];
+                        perm_out[p] = perm[i];
+                    }
+                }
+            });
+
+            keys.swap(keys_out);
+            perm.swap(perm_out);
+        }
+    }
+
+    // Orders NaN last in either direction
+    inline bool less(long double a, long double b, bool ascending) {
+        if (a != a || b != b) return a == a && b != b;
+        return ascending ? a < b : b < a;
+    }
+}
+
+inline std::vector<unsigned int> top_k_values(const long double *v, std::size_t n, std::size_t k, bool largest) {
+    typedef std::pair<long double, unsigned int> Entry;
+    typedef std::vector<Entry> Heap;
+
+    // 'better' is a strict order, so as a heap comparison it keeps the worst kept entry on top
+    auto better = [largest](const Entry &a, const Entry &b) {
+        if (a.first != b.first) return largest ? a.first > b.first : a.first < b.first;
+        return a.second < b.second;
+    };
+
+    if (k == 0) return {};
+
+    Heap best = aggregate_detail::reduce<Heap>(n, Heap(), [&](std::size_t lo, std::size_t hi) {
+        Heap heap;
+        heap.reserve(k);
+
+        for (std::size_t i = lo; i < hi; i++) {
+            if (v[i] != v[i]) continue;
+
+            if (heap.size() < k) {
+                heap.push_back(Entry(v[i], i));
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+            else if (largest ? v[i] > heap.front().first : v[i] < heap.front().first) { // Later rows lose ties, so equal values can be skipped
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = Entry(v[i], i);
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+
+        return heap;
+    }, [&](Heap a, const Heap &b) {
+        a.insert(a.end(), b.begin(), b.end());
+        if (a.size() > k) {
+            std::nth_element(a.begin(), a.begin() + k, a.end(), better);
+            a.resize(k);
+        }
+        return a;
+    });
+
+    std::sort(best.begin(), best.end(), better);
+
+    std::vector<unsigned int> rows;
+    for (const Entry &e : best) rows.push_back(e.second);
+    return rows;
+}
+
+inline std::vector<unsigned int> argsort_columns(const std::vector<const long double*> &cols, std::size_t n, const std::vector<bool> &ascending) {
+    std::vector<unsigned int> perm(n);
+    for (std::size_t i = 0; i < n; i++) perm[i] = i;
+
+    bool radix = true;
+    for (std::size_t c = 0; c < cols.size(); c++) radix = radix && sort_detail::exact_doubles(cols[c], n);
+
+    if (!radix) {
+        std::stable_sort(perm.begin(), perm.end(), [&](unsigned int a, unsigned int b) {
+            for (std::size_t c = 0; c < cols.size(); c++) {
+                bool asc = ascending.empty() || ascending[c];
+                if (sort_detail::less(cols[c][a], cols[c][b], asc)) return true;
+                if (sort_detail::less(cols[c][b], cols[c][a], asc)) return false;
+            }
+            return false;
+        });
+        return perm;
+    }
+
+    // Least significant column first. Each pass is stable, so earlier columns keep the order of the later ones within ties
+    std::vector<std::uint64_t> keys(n);
+
+    for (std::size_t c = cols.size(); c-- > 0;) {
+        const long double *v = cols[c];
+        bool asc = ascending.empty() || ascending[c];
+
+        parallel_for(0, n, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) keys[i] = sort_detail::key_bits(v[perm[i]], asc);
+        });
+
+        sort_detail::radix_sort(keys, perm);
+    }
+
+    return perm;
+}
+
+#endif
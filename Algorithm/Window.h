@@ -0,0 +1,145 @@
+// Moving-window and exponentially weighted kernels over raw arrays of long doubles. NaN marks a missing value: it is skipped,
+// and a row whose window holds too few values gets NaN.
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstddef>
+#include <algorithm>
+
+#include "Aggregate.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+enum class Roll { COUNT, SUM, MEAN, VAR, STD, MIN, MAX };
+enum class Ewm { MEAN, VAR, STD };
+
+// out[i] = 'fn' of v[i - window + 1 .. i], once the window holds at least 'min_periods' values (0 asks for a full window).
+// COUNT is always written. Each row costs O(1): sums and moments slide, and MIN and MAX keep a monotonic deque of candidates.
+// Long columns are cut into blocks that each warm up on the 'window - 1' rows before them, so blocks run in parallel.
+inline void rolling_values(const long double *v, std::size_t n, std::size_t window, Roll fn, std::size_t min_periods, long double *out);
+
+// Exponentially weighted mean, or unbiased variance, with smoothing factor 'alpha' in (0, 1]. Weights are adjusted for the
+// start of the series and keep decaying across missing values, whose rows repeat the last result. Sequential, O(n)
+inline void ewm_values(const long double *v, std::size_t n, long double alpha, Ewm fn, long double *out);
+
+inline std::string rolling_label(const std::string &label, Roll fn, std::size_t window); // e.g. "x_rolling_mean_30"
+inline std::string ewm_label(const std::string &label, Ewm fn, long double alpha);       // e.g. "x_ewm_std_0.1"
+
+/* Definitions */
+
+namespace window_detail {
+    // Rows [lo, hi) of the output. Reads from 'lo - window + 1' so the first rows see their whole window
+    inline void moments(const long double *v, std::size_t lo, std::size_t hi, std::size_t window, Roll fn, std::size_t min_periods, long double *out) {
+        std::size_t start = lo >= window ? lo - window + 1 : 0;
+        Moments m;
+        long double sum = 0;
+
+        for (std::size_t i = start; i < hi; i++) {
+            if (v[i] == v[i]) { m.add(v[i]); sum += v[i]; }
+            if (i >= start + window && v[i - window] == v[i - window]) { m.remove(v[i - window]); sum -= v[i - window]; }
+            if (m.count == 0) sum = 0; // Drops the rounding left over from values that slid out
+            if (i < lo) continue;
+
+            if (fn == Roll::COUNT) { out[i] = m.count; continue; }
+            if (m.count < min_periods) { out[i] = NAN; continue; }
+
+            switch (fn) {
+                case Roll::SUM: out[i] = sum; break;
+                case Roll::MEAN: out[i] = m.mean; break;
+                case Roll::VAR: out[i] = m.variance(); break;
+                default: out[i] = std::sqrt(m.variance()); break;
+            }
+        }
+    }
+
+    // The deque holds the rows that can still become the extreme, with their values decreasing (MAX) or increasing (MIN)
+    // from the front. Every row enters and leaves it at most once
+    template <bool Max>
+    inline void extreme(const long double *v, std::size_t lo, std::size_t hi, std::size_t window, std::size_t min_periods, long double *out) {
+        std::size_t start = lo >= window ? lo - window + 1 : 0;
+        std::vector<std::size_t> deque(hi - start);
+        std::size_t head = 0, tail = 0, count = 0;
+
+        for (std::size_t i = start; i < hi; i++) {
+            if (v[i] == v[i]) {
+                while (tail > head && (Max ? v[deque[tail - 1]] <= v[i] : v[deque[tail - 1]] >= v[i])) tail--;
+                deque[tail++] = i;
+                count++;
+            }
+            if (i >= start + window && v[i - window] == v[i - window]) count--;
+            while (head < tail && deque[head] + window <= i) head++;
+            if (i < lo) continue;
+
+            out[i] = count >= min_periods && head < tail ? v[deque[head]] : NAN;
+        }
+    }
+}
+
+inline void rolling_values(const long double *v, std::size_t n, std::size_t window, Roll fn, std::size_t min_periods, long double *out) {
+    if (min_periods == 0 || min_periods > window) min_periods = window;
+
+    // Blocks stay long next to the window, so warming up costs at most a quarter more work
+    std::size_t grain = std::max<std::size_t>(AGGREGATE_GRAIN, 4 * window);
+
+    parallel_for(0, n, grain, [&](std::size_t lo, std::size_t hi) {
+        if (fn == Roll::MIN) window_detail::extreme<false>(v, lo, hi, window, min_periods, out);
+        else if (fn == Roll::MAX) window_detail::extreme<true>(v, lo, hi, window, min_periods, out);
+        else window_detail::moments(v, lo, hi, window, fn, min_periods, out);
+    });
+}
+
+inline void ewm_values(const long double *v, std::size_t n, long double alpha, Ewm fn, long double *out) {
+    const long double decay = 1 - alpha;
+    long double mean = NAN, var = 0;
+    long double weight = 1, sum_w = 1, sum_w2 = 1; // Weight of the old mean, and the sums of all weights and their squares
+
+    for (std::size_t i = 0; i < n; i++) {
+        long double x = v[i];
+
+        if (mean != mean) {
+            if (x == x) mean = x; // The series starts at its first value
+        }
+        else {
+            weight *= decay;
+            sum_w *= decay;
+            sum_w2 *= decay * decay;
+
+            if (x == x) {
+                long double old = mean;
+                mean = (weight * old + x) / (weight + 1);
+                var = (weight * (var + (old - mean) * (old - mean)) + (x - mean) * (x - mean)) / (weight + 1);
+
+                weight += 1;
+                sum_w += 1;
+                sum_w2 += 1;
+            }
+        }
+
+        if (fn == Ewm::MEAN) { out[i] = mean; continue; }
+
+        // Reliability weights turn the biased estimate into an unbiased one
+        long double denom = sum_w * sum_w - sum_w2;
+        long double unbiased = mean == mean && denom > 0 ? var * sum_w * sum_w / denom : NAN;
+        out[i] = fn == Ewm::VAR ? unbiased : std::sqrt(unbiased);
+    }
+}
+
+inline std::string rolling_label(const std::string &label, Roll fn, std::size_t window) {
+    static const char *names[] = { "count", "sum", "mean", "var", "std", "min", "max" };
+    return label + "_rolling_" + names[(int)fn] + "_" + std::to_string(window);
+}
+
+inline std::string ewm_label(const std::string &label, Ewm fn, long double alpha) {
+    static const char *names[] = { "mean", "var", "std" };
+    std::ostringstream os;
+    os << label << "_ewm_" << names[(int)fn] << "_" << alpha;
+    return os.str();
+}
+
+#endif
@@ -1,23 +1,49 @@
 #ifndef DATA_SET_H
 #define DATA_SET_H
 
+#include <cmath>
 #include <string>
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
 
 #include "Bimap.h"
+#include "TDigest.h"
+#include "GroupTable.h"
+#include "HyperLogLog.h"
+#include "Matrix.h"
+#include "SparseMatrix.h"
+#include "../Algorithm/Aggregate.h"
+#include "../Algorithm/Describe.h"
+#include "../Algorithm/Select.h"
+#include "../Algorithm/Sort.h"
+#include "../Algorithm/Window.h"
+#include "../Algorithm/Scan.h"
+#include "../Algorithm/Correlation.h"
 #include "../util/config.h"
 
 /* Declarations */
 
+class DataSet;
+
 // The structure that holds a column of data as well as the other relevant configuration information for the column
 class Column {
+    friend class DataSet;
+
     private: 
         std::string label;
         bool masked;
         std::shared_ptr<Bimap<long double, std::string>> translation_map_ptr;
         std::vector<long double> data;
+        DataSet *owner = nullptr; // Set once a DataSet has handed this column out by reference, so that assignments keep its invariants
+
+        Column scan(Scan op, const std::string &name) const; // Runs scan_values() into a new column labelled 'label_name'
+        GroupTable distinct_codes() const;                   // The values that are not NaN, without repeats. Blocks are gathered in parallel and merged
 
     public:
         // Constructors
@@ -25,6 +51,16 @@ class Column {
         Column(const Column &c);                                  // Copy constructor
         Column(std::vector<long double> data);                    // Data constructor
         Column(std::vector<long double> data, std::string label); // Data and label constructor
+        Column(Column &&c);                                       // Move constructor
+        template <typename E, typename = typename E::is_column_expression>
+        Column(const E &expr, std::string label = DEFAULT_LABEL); // Evaluates a column expression (see Query/Expression.h) in one parallel pass
+
+        // Assigning to a column reached through a DataSet, e.g. ds["a"] = ds["b"], only replaces its values and map: it keeps its
+        // label and masking, and throws if the length would change while the DataSet has other columns
+        Column& operator=(const Column &c);
+        Column& operator=(Column &&c);
+        template <typename E, typename = typename E::is_column_expression>
+        Column& operator=(const E &expr); // Evaluates a column expression into this column, in place when the length is unchanged. The result is numeric
 
         // Access functions
         long double& at(unsigned int index) { return data.at(index); }       // Returns a the raw element at position 'index' as a reference.
@@ -32,7 +68,36 @@ class Column {
         std::string as_string(unsigned int index) const;                     // Returns, if possible, the string translation of the value at 'index'. This is determined by the Bimap pointer.
         std::vector<std::string> as_string() const;                          // Returns, a vector of strings containing all translatable values. Any value that doesn't have a translation is simply turned into a string and returned in place.
 
+        // Statistics. NaN values are treated as missing and skipped. Large columns are split across threads
+        std::size_t count() const { return agg_count(data.data(), data.size()); }                                           // Number of values that are not NaN
+        long double sum(bool compensated = false) const { return agg_sum(data.data(), data.size(), compensated); }          // 'compensated' trades speed for Neumaier-corrected rounding
+        long double mean(bool compensated = false) const { std::size_t c = count(); return c ? sum(compensated) / c : NAN; }
+        long double min() const { return agg_min(data.data(), data.size()); }                                               // NaN if the column holds no values
+        long double max() const { return agg_max(data.data(), data.size()); }                                               // NaN if the column holds no values
+        long double variance(unsigned int ddof = 1) const { return agg_moments(data.data(), data.size()).variance(ddof); }   // Sample variance by default. NaN when there are not enough values
+        long long argmin() const { return agg_argmin(data.data(), data.size()); }                                           // Row of the first smallest value, -1 if there is none
+        long long argmax() const { return agg_argmax(data.data(), data.size()); }                                           // Row of the first largest value, -1 if there is none
+        std::size_t distinct_count() const;                                                                                  // Exact over the codes of a categorical column, otherwise a HyperLogLog estimate
+        TDigest quantile_sketch(long double compression = TDIGEST_COMPRESSION) const;                                        // One digest per block of rows, built in parallel and merged
+        long double approx_quantile(long double q) const { return quantile_sketch().quantile(q); }                          // Estimated value at rank 'q' in [0, 1], NaN if the column holds no values
+
+        // Windows. The result is a new numeric column named after this one, e.g. "x_rolling_mean_30" (see Algorithm/Window.h)
+        Column rolling(std::size_t window, Roll fn, std::size_t min_periods = 0) const; // 'fn' of the last 'window' rows at every row. 'min_periods' values are needed, 0 for a full window
+        Column ewm(long double alpha, Ewm fn) const;                                   // Exponentially weighted 'fn' with smoothing factor 'alpha' in (0, 1]
+
+        // Scans, e.g. "x_cumsum". Missing values stay missing and are skipped by the running value (see Algorithm/Scan.h)
+        Column cumsum() const { return scan(Scan::SUM, "cumsum"); }
+        Column cumprod() const { return scan(Scan::PROD, "cumprod"); }
+        Column cummin() const { return scan(Scan::MIN, "cummin"); }
+        Column cummax() const { return scan(Scan::MAX, "cummax"); }
+        Column diff(std::size_t periods = 1) const;       // Change from 'periods' rows earlier, e.g. "x_diff"
+        Column pct_change(std::size_t periods = 1) const; // Relative change from 'periods' rows earlier, e.g. "x_pct_change"
+
         // Getters and Setters
+        unsigned int size() const { return data.size(); }                            // Returns the number of rows in the column
+        bool is_categorical() const { return translation_map_ptr.get() != nullptr; } // True if the values are codes into a translation map
+        bool is_sorted() const { return is_sorted_values(data.data(), data.size()); } // True if the values ascend with any NaNs last. A parallel pass; not cached, since at() hands out writable references
+
         bool is_masked() const { return masked; }
         void set_masked(bool b) { masked = b; }
 
@@ -43,30 +108,51 @@ class Column {
         void set_label(std::string label) { this->label = label; }
 
         Bimap<long double, std::string> get_map() { return *translation_map_ptr.get(); }               // Returns the literal Bimap object
-        std::shared_ptr<Bimap<long double, std::string>> get_map_ptr() { return translation_map_ptr; } // Returns the shared_ptr of the Bimap
+        std::shared_ptr<Bimap<long double, std::string>> get_map_ptr() const { return translation_map_ptr; } // Returns the shared_ptr of the Bimap
 
         void set_map(Bimap<long double, std::string> bm) { translation_map_ptr = std::make_shared<Bimap<long double, std::string>>(bm); } // Makes a new shared_ptr out of the pass-in object
         void set_map(std::shared_ptr<Bimap<long double, std::string>> bm_ptr) { translation_map_ptr = bm_ptr; }                           // Uses an existing shared_ptr object
 };
 
 
+class GroupBy;
+class LazyDataSet;
+enum class JoinType;
+
 class DataSet {
+    friend class Column;
+
 private:
     std::vector<std::unique_ptr<Column>> data;                             // A vector of unique_ptrs of columns. This 
     std::shared_ptr< Bimap<long double, std::string>> translation_map_ptr; // A shared_ptr to the Bimap used to store the translation between a string and its hashed value
 
     bool add_term(std::string term); // Attempts to add a value to the Bimap with its auto-generated hash value. Returns true if no previous value exists, false if one does.
+    void adopt_map(Column &col);     // Re-codes a column that carries a foreign translation map into this DataSet's map
+    void assign(Column &target, Column value); // Writes 'value' into one of this DataSet's columns, keeping its label and masking
+    Column& bind(unsigned int index);          // The column at 'index', marked as owned so that assignments go through assign()
+    DataSet pair_matrix(Nulls nulls, bool normalize) const;          // cov() or corr()
+    std::vector<int> numeric_cols() const;                           // Positions of the columns that are neither masked nor categorical
+    std::vector<long double> string_ranks(const Column &col) const;  // Rank of each value's string among the terms of a categorical column's map. NaN if it has none
+    std::vector<int> col_indices(const std::vector<std::string> &labels, const char *caller) const; // Positions of the labelled columns. Throws if one is missing
+    std::vector<int> categorical_cols(const std::vector<std::string> &labels, const char *caller) const; // Same, but also throws if one is not categorical
+    DataSet take(const std::vector<unsigned int> &rows, const std::vector<int> &cols) const;        // Copies out the given rows of the given columns
 
 public:
     // Constructors
     DataSet();                  // Standard constructor
     DataSet(const DataSet &ds); // Copy constructor
+    DataSet(DataSet &&ds);      // Move constructor
     DataSet(const std::vector<std::vector<long double>> &data);                                  // External data constructor: loads the vector of vectors in and auto-generates labels for the columns
     DataSet(const std::vector<std::vector<long double>> &data, unsigned int axis);                        // External data constructor: loads the vector of vectors in and auto-generates labels for the columns. Axis = 0 means that the vectors are rows, Axis = 1 means that the vectors are columns
     DataSet(const std::vector<std::vector<long double>> &data, std::vector<std::string> labels); // External data constructor: loads the vector of vectors in and uses the labels
     DataSet(const std::vector<std::vector<long double>> &data, std::vector<std::string> labels, unsigned int axis); // External data constructor: loads the vector of vectors in and uses the labels. Axis = 0 means that the vectors are rows, Axis = 1 means that the vectors are columns
 
+    DataSet& operator=(const DataSet &ds);
+    DataSet& operator=(DataSet &&ds);
+
     // Access Functions
+    Column& operator[](const std::string &label);             // The column labelled 'label'. Throws if there is none
+    const Column& operator[](const std::string &label) const;
     std::vector<long double>& at(unsigned int index) const;            // Returns the column at position 'index'
     long double& at(unsigned int index_x, unsigned int index_y) const; // Returns the value at position ('index_x', 'index_y')
 
@@ -83,9 +169,68 @@ public:
     std::vector<std::vector<std::string>> get_data_as_string(); // Returns a vector of strings instead of lond doubles. All possible values as translated, the rest are just cast to strings.
     void set_data(const std::vector<std::vector<long double>> &data);   // Sets the data of the DataSet from a vector of long double vectors
     void set_data(const std::vector<Column> &data);                     // Sets the data of the DataSet from a vector of Columns. Copies over the Columns' configuration as well (masked, label, etc...)
-    
+
+    unsigned int num_cols() const { return data.size(); }                             // Returns the number of columns
+    unsigned int num_rows() const { return data.empty() ? 0 : data.front()->size(); } // Returns the number of rows. All columns share the same length
+
+    Column& get_col_ref(unsigned int index) { return bind(index); }                 // Returns a reference to the Column at position 'index'. No copy is made
+    const Column& get_col_ref(unsigned int index) const { return *data.at(index); } // Returns a const reference to the Column at position 'index'
+    int get_col_index(const std::string &label) const;                              // Returns the position of the first column labelled 'label', or -1 if there is none
+
+    void add_col(const std::vector<long double> &col); // Appends a column with an auto-generated label
+    void add_col(Column col);                          // Appends a column, keeping its configuration
+
+    long double encode(const std::string &term);     // Returns the code for 'term' in the translation map, adding it if needed
+    std::shared_ptr<Bimap<long double, std::string>> get_map_ptr() const { return translation_map_ptr; } // Returns the shared_ptr of the Bimap
+    void set_map_ptr(std::shared_ptr<Bimap<long double, std::string>> bm_ptr);                          // Replaces the Bimap, re-pointing every categorical column at it
+
+    // Statistics
+    std::vector<ColumnSummary> describe() const; // Summary statistics for every column that is not masked, computed in parallel. Categorical columns get counts only
+    DataSet cov(Nulls nulls = Nulls::PAIRWISE) const;  // Sample covariances of the numeric columns that are not masked. Column j, row i holds the pair (i, j)
+    DataSet corr(Nulls nulls = Nulls::PAIRWISE) const; // Pearson correlations of the same columns, laid out the same way (see Algorithm/Correlation.h)
+
+    // Matrices. With no labels, every numeric column that is not masked, in order (see Container/Matrix.h)
+    MatrixView matrix_view(const std::vector<std::string> &labels = {}) const; // The columns in place, nothing copied. Valid until one of them is resized or removed
+    template <typename T = long double>
+    Matrix<T> to_matrix(const std::vector<std::string> &labels = {}) const { return matrix_view(labels).template to_dense<T>(); } // The columns copied into one column-major buffer
+
+    // One-hot encodes the categorical columns labelled 'labels', side by side. Column c takes one output column per term of
+    // vocabulary[c], in that order, labelled e.g. "color_red". Values outside its vocabulary and missing values get no entry, so
+    // encoding new data with the vocabulary of the training data gives both the same layout. Throws if a column is not
+    // categorical, or if a vocabulary repeats a term
+    SparseMatrix one_hot(const std::vector<std::string> &labels, const std::vector<std::vector<std::string>> &vocabulary,
+                         SparseLayout layout = SparseLayout::CSR) const;
+    SparseMatrix one_hot(const std::vector<std::string> &labels, SparseLayout layout = SparseLayout::CSR) const { return one_hot(labels, vocabulary(labels), layout); }
+    std::vector<std::vector<std::string>> vocabulary(const std::vector<std::string> &labels) const; // The distinct terms each categorical column holds, in string order
+
+    // Selection. The result keeps every column's configuration and shares this DataSet's translation map
+    DataSet select(const std::vector<std::string> &labels) const;                                       // Copies out the columns labelled 'labels', in that order
+    DataSet take(const std::vector<unsigned int> &rows) const;                                          // Copies out the rows at the given positions, in the given order
+    DataSet take(const std::vector<unsigned int> &rows, const std::vector<std::string> &labels) const; // Same, reading only the columns labelled 'labels'
+    DataSet filter(const Bitmask &mask) const;                 // Copies out the rows whose bit is set
+    template <typename Predicate>
+    DataSet filter(const Predicate &pred) const { return filter(pred.evaluate(*this)); } // Copies out the rows matching 'pred' (see Algorithm/Predicate.h)
+
+    // Sorting. 'ascending' holds one flag per key, or is empty for all ascending. Categorical keys sort by their strings
+    std::vector<unsigned int> argsort(const std::vector<std::string> &keys, const std::vector<bool> &ascending = {}) const; // The stable permutation that sorts the rows on the columns labelled 'keys'
+    DataSet sort_by(const std::vector<std::string> &keys, const std::vector<bool> &ascending = {}) const;                   // Copies the rows out in sorted order
+    DataSet top_k(const std::string &key, std::size_t k, bool largest = true) const; // The 'k' rows with the largest (or smallest) 'key', best first, without sorting the rest. Nulls are left out
+
+    // Windows. One column per label and window (or alpha), in that order, all computed in parallel
+    DataSet rolling(const std::vector<std::string> &labels, const std::vector<std::size_t> &windows, Roll fn, std::size_t min_periods = 0) const;
+    DataSet ewm(const std::vector<std::string> &labels, const std::vector<long double> &alphas, Ewm fn) const;
+
+    // Grouping
+    GroupBy group_by(const std::vector<std::string> &keys) const; // Groups the rows on the columns labelled 'keys' (see Algorithm/GroupBy.h)
+
+    // Joins
+    DataSet join(const DataSet &right, const std::vector<std::string> &keys) const;              // Inner join on the columns labelled 'keys'
+    DataSet join(const DataSet &right, const std::vector<std::string> &keys, JoinType how) const; // Inner, left, semi or anti join (see Algorithm/Join.h)
+    DataSet asof_join(const DataSet &right, const std::string &on, long double tolerance = INFINITY) const; // Nearest preceding match on a sorted column
+
+    // Deferred queries
+    LazyDataSet lazy() const; // Starts a query plan reading this DataSet. Defined in Query/LazyDataSet.h, which callers include. The DataSet must outlive the plan
 };
-#endif
 
 /* Definitions */
 
@@ -110,21 +255,154 @@ Column::Column(const Column& c) {
     }
 }
 
+Column::Column(Column &&c) : label(std::move(c.label)), masked(c.masked), translation_map_ptr(std::move(c.translation_map_ptr)), data(std::move(c.data)) { }
+
+Column& Column::operator=(const Column &c) {
+    if (this == &c) return *this;
+    return *this = Column(c);
+}
+
+Column& Column::operator=(Column &&c) {
+    if (owner) {
+        owner->assign(*this, std::move(c));
+        return *this;
+    }
+
+    label = std::move(c.label);
+    masked = c.masked;
+    translation_map_ptr = std::move(c.translation_map_ptr);
+    data = std::move(c.data);
+    return *this;
+}
+
 Column::Column(std::vector<long double> data) {
     label = DEFAULT_LABEL;
     masked = false;
 
     translation_map_ptr = std::shared_ptr<Bimap<long double, std::string>>(nullptr);
-    this->data = data; // Set the current data to a copy of the passed-in data
+    this->data = std::move(data); // Take ownership of the passed-in copy
 }      
 
 Column::Column(std::vector<long double> data, std::string label) {
     this->label = label;
-    this->data = data;
+    this->data = std::move(data);
     masked = false;
     translation_map_ptr = std::shared_ptr<Bimap<long double, std::string>>(nullptr);
 }
 
+// Blocks are sketched in parallel and the sketches merged. A categorical column holds few distinct codes, so its blocks
+// collect them exactly instead
+std::size_t Column::distinct_count() const {
+    if (!is_categorical()) {
+        // One sketch per task range rather than per block, folded into the total once
+        HyperLogLog total;
+        std::mutex lock;
+
+        parallel_for(0, data.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            HyperLogLog local;
+            local.add(data.data() + lo, hi - lo);
+
+            std::lock_guard<std::mutex> guard(lock);
+            total.merge(local);
+        });
+
+        return total.estimate();
+    }
+
+    return distinct_codes().size();
+}
+
+GroupTable Column::distinct_codes() const {
+    return aggregate_detail::reduce<GroupTable>(data.size(), GroupTable(1), [&](std::size_t lo, std::size_t hi) {
+        GroupTable seen(1);
+        for (std::size_t i = lo; i < hi; i++) {
+            if (data[i] == data[i]) seen.insert(&data[i], hash_value(data[i]));
+        }
+        return seen;
+    }, [](GroupTable a, const GroupTable &b) {
+        for (std::size_t g = 0; g < b.size(); g++) a.insert(b.get_key(g), hash_value(*b.get_key(g)));
+        return a;
+    });
+}
+
+TDigest Column::quantile_sketch(long double compression) const {
+    return aggregate_detail::reduce<TDigest>(data.size(), TDigest(compression), [&](std::size_t lo, std::size_t hi) {
+        TDigest digest(compression);
+        for (std::size_t i = lo; i < hi; i++) digest.add(data[i]);
+        return digest;
+    }, [](TDigest a, const TDigest &b) { a.merge(b); return a; });
+}
+
+Column Column::rolling(std::size_t window, Roll fn, std::size_t min_periods) const {
+    if (window == 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> rolling() -> The window must hold at least one row!" << std::endl;
+        throw -1;
+    }
+
+    Column out(std::vector<long double>(data.size()), rolling_label(label, fn, window));
+    rolling_values(data.data(), data.size(), window, fn, min_periods, out.data.data());
+    return out;
+}
+
+Column Column::ewm(long double alpha, Ewm fn) const {
+    if (!(alpha > 0 && alpha <= 1)) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> ewm() -> Alpha must be in (0, 1]!" << std::endl;
+        throw -1;
+    }
+
+    Column out(std::vector<long double>(data.size()), ewm_label(label, fn, alpha));
+    ewm_values(data.data(), data.size(), alpha, fn, out.data.data());
+    return out;
+}
+
+Column Column::scan(Scan op, const std::string &name) const {
+    Column out(std::vector<long double>(data.size()), label + "_" + name);
+    scan_values(data.data(), data.size(), op, out.data.data());
+    return out;
+}
+
+Column Column::diff(std::size_t periods) const {
+    Column out(std::vector<long double>(data.size()), label + "_diff");
+    diff_values(data.data(), data.size(), periods, out.data.data());
+    return out;
+}
+
+Column Column::pct_change(std::size_t periods) const {
+    Column out(std::vector<long double>(data.size()), label + "_pct_change");
+    pct_change_values(data.data(), data.size(), periods, out.data.data());
+    return out;
+}
+
+template <typename E, typename>
+Column::Column(const E &expr, std::string label) : Column(std::vector<long double>(expr.size()), label) {
+    *this = expr;
+}
+
+template <typename E, typename>
+Column& Column::operator=(const E &expr) {
+    if (owner && owner->num_cols() > 1 && expr.size() != data.size()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> operator= -> Column length does not match the DataSet!" << std::endl;
+        throw -1;
+    }
+
+    // Every row only reads its own position, so the expression may read this column while it is overwritten
+    if (expr.size() != data.size()) {
+        std::vector<long double> out(expr.size());
+        parallel_for(0, out.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) out[i] = expr.value(i);
+        });
+        data.swap(out);
+    }
+    else {
+        parallel_for(0, data.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) data[i] = expr.value(i);
+        });
+    }
+
+    translation_map_ptr = nullptr;
+    return *this;
+}
+
 // Returns the de-hashed version of the value at 'index', if possible. If it isn't, a string of the value is returned instead.
 std::string Column::as_string(unsigned int index) const {
     if (translation_map_ptr.get() == nullptr) { // Make sure that the translation map exists
@@ -154,4 +432,662 @@ std::vector<std::string> Column::as_string() const {
     return vec;
 }
 
+// Default constructor
+DataSet::DataSet() {
+    translation_map_ptr = std::make_shared<Bimap<long double, std::string>>();
+}
+
+// Copy constructor. The columns are deep-copied, the translation map is shared
+DataSet::DataSet(const DataSet &ds) {
+    translation_map_ptr = ds.translation_map_ptr;
+
+    data.reserve(ds.data.size());
+    for (const auto &col : ds.data) {
+        data.push_back(std::unique_ptr<Column>(new Column(*col)));
+    }
+}
+
+DataSet& DataSet::operator=(const DataSet &ds) {
+    if (this != &ds) *this = DataSet(ds);
+    return *this;
+}
+
+// Columns that were handed out keep pointing at their DataSet, wherever it moves
+DataSet::DataSet(DataSet &&ds) : data(std::move(ds.data)), translation_map_ptr(std::move(ds.translation_map_ptr)) {
+    for (auto &col : data) {
+        if (col->owner) col->owner = this;
+    }
+}
+
+DataSet& DataSet::operator=(DataSet &&ds) {
+    data = std::move(ds.data);
+    translation_map_ptr = std::move(ds.translation_map_ptr);
+
+    for (auto &col : data) {
+        if (col->owner) col->owner = this;
+    }
+    return *this;
+}
+
+DataSet::DataSet(const std::vector<std::vector<long double>> &data) : DataSet(data, 1) { }
+
+DataSet::DataSet(const std::vector<std::vector<long double>> &data, unsigned int axis) : DataSet() {
+    std::vector<std::string> labels;
+    unsigned int count = axis == 0 ? (data.empty() ? 0 : data.front().size()) : data.size();
+
+    for (unsigned int i = 0; i < count; i++) {
+        labels.push_back(DEFAULT_LABEL + std::to_string(i));
+    }
+
+    *this = DataSet(data, labels, axis);
+}
+
+DataSet::DataSet(const std::vector<std::vector<long double>> &data, std::vector<std::string> labels) : DataSet(data, labels, 1) { }
+
+DataSet::DataSet(const std::vector<std::vector<long double>> &data, std::vector<std::string> labels, unsigned int axis) : DataSet() {
+    if (axis > 1) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> DataSet() -> Axis must be 0 (rows) or 1 (columns)!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<std::vector<long double>> cols;
+
+    if (axis == 1) {
+        cols = data;
+    } else {
+        unsigned int width = data.empty() ? 0 : data.front().size();
+        cols.assign(width, std::vector<long double>(data.size()));
+
+        for (unsigned int r = 0; r < data.size(); r++) {
+            if (data[r].size() != width) {
+                if (VERBOSE_ERRORS) std::cout << "[Error] -> DataSet() -> Rows are not all the same length!" << std::endl;
+                throw -1;
+            }
+            for (unsigned int c = 0; c < width; c++) cols[c][r] = data[r][c];
+        }
+    }
+
+    if (labels.size() != cols.size()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> DataSet() -> Number of labels does not match the number of columns!" << std::endl;
+        throw -1;
+    }
+
+    for (unsigned int i = 0; i < cols.size(); i++) {
+        add_col(Column(std::move(cols[i]), labels[i]));
+    }
+}
+
+Column& DataSet::operator[](const std::string &label) {
+    int index = get_col_index(label);
+
+    if (index < 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> operator[] -> No column labelled '" << label << "'!" << std::endl;
+        throw -1;
+    }
+
+    return bind(index);
+}
+
+const Column& DataSet::operator[](const std::string &label) const {
+    int index = get_col_index(label);
+
+    if (index < 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> operator[] -> No column labelled '" << label << "'!" << std::endl;
+        throw -1;
+    }
+
+    return *data[index]; // Not bound: a const reference cannot be assigned through, and binding would write to a shared DataSet
+}
+
+// Returns a reference to the raw data of the column at position 'index'
+std::vector<long double>& DataSet::at(unsigned int index) const {
+    return data.at(index)->data;
+}
+
+// Returns a reference to the value in column 'index_x', row 'index_y'
+long double& DataSet::at(unsigned int index_x, unsigned int index_y) const {
+    return data.at(index_x)->data.at(index_y);
+}
+
+std::vector<long double> DataSet::get_row(unsigned int index) {
+    if (index >= num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> get_row() -> Index is out of bounds!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<long double> row;
+    row.reserve(data.size());
+
+    for (const auto &col : data) row.push_back(col->data[index]);
+
+    return row;
+}
+
+void DataSet::set_row(unsigned int index, const std::vector<long double> &row) {
+    if (index >= num_rows() || row.size() != data.size()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> set_row() -> Row does not fit the DataSet!" << std::endl;
+        throw -1;
+    }
+
+    for (unsigned int i = 0; i < data.size(); i++) data[i]->data[index] = row[i];
+}
+
+std::vector<long double> DataSet::get_col(unsigned int index) {
+    return data.at(index)->data;
+}
+
+Column DataSet::get_raw_col(unsigned int index) {
+    return *data.at(index);
+}
+
+// Replaces the data of the column at 'index', keeping its configuration
+void DataSet::set_col(unsigned int index, const std::vector<long double> &col) {
+    if (data.size() > 1 && col.size() != num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> set_col() -> Column length does not match!" << std::endl;
+        throw -1;
+    }
+
+    data.at(index)->data = col;
+}
+
+// Replaces the column at 'index' along with its configuration
+void DataSet::set_col(unsigned int index, const Column &col) {
+    if (data.size() > 1 && col.size() != num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> set_col() -> Column length does not match!" << std::endl;
+        throw -1;
+    }
+
+    Column copy(col);
+    adopt_map(copy);
+
+    // A full replacement, label included, so it bypasses the checks of an assignment through operator[]
+    data.at(index)->owner = nullptr;
+    *data.at(index) = std::move(copy);
+}
+
+Column& DataSet::bind(unsigned int index) {
+    Column &col = *data.at(index);
+    col.owner = this;
+    return col;
+}
+
+void DataSet::assign(Column &target, Column value) {
+    if (data.size() > 1 && value.size() != target.size()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> operator= -> Column length does not match the DataSet!" << std::endl;
+        throw -1;
+    }
+
+    adopt_map(value);
+    target.data = std::move(value.data);
+    target.translation_map_ptr = std::move(value.translation_map_ptr);
+}
+
+std::vector<std::vector<long double>> DataSet::get_data() {
+    std::vector<std::vector<long double>> out;
+    out.reserve(data.size());
+
+    for (const auto &col : data) out.push_back(col->data);
+
+    return out;
+}
+
+std::vector<std::vector<std::string>> DataSet::get_data_as_string() {
+    std::vector<std::vector<std::string>> out;
+    out.reserve(data.size());
+
+    for (const auto &col : data) {
+        if (col->is_categorical()) {
+            out.push_back(col->as_string());
+        } else {
+            std::vector<std::string> vec;
+            vec.reserve(col->size());
+            for (long double v : col->data) vec.push_back(std::to_string(v));
+            out.push_back(vec);
+        }
+    }
+
+    return out;
+}
+
+void DataSet::set_data(const std::vector<std::vector<long double>> &data) {
+    this->data.clear();
+
+    for (const auto &col : data) add_col(col);
+}
+
+void DataSet::set_data(const std::vector<Column> &data) {
+    this->data.clear();
+
+    for (const auto &col : data) add_col(col);
+}
+
+int DataSet::get_col_index(const std::string &label) const {
+    for (unsigned int i = 0; i < data.size(); i++) {
+        if (data[i]->label == label) return i;
+    }
+
+    return -1;
+}
+
+void DataSet::add_col(const std::vector<long double> &col) {
+    add_col(Column(col, DEFAULT_LABEL + std::to_string(data.size())));
+}
+
+void DataSet::add_col(Column col) {
+    if (!data.empty() && col.size() != num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> add_col() -> Column length does not match!" << std::endl;
+        throw -1;
+    }
+
+    adopt_map(col);
+    data.push_back(std::unique_ptr<Column>(new Column(std::move(col))));
+}
+
+// Codes are the string's hash, truncated to 53 bits so they stay exact on platforms where long double is a double.
+// Collisions are resolved by probing the next code.
+bool DataSet::add_term(std::string term) {
+    if (translation_map_ptr->has_value(term)) return false;
+
+    unsigned long long code = std::hash<std::string>{}(term) & ((1ULL << 53) - 1);
+    while (translation_map_ptr->has_key(code)) code = (code + 1) & ((1ULL << 53) - 1);
+
+    translation_map_ptr->set(code, term);
+    return true;
+}
+
+long double DataSet::encode(const std::string &term) {
+    add_term(term);
+    return translation_map_ptr->get_key(term);
+}
+
+// Columns may only carry their own map when ALLOW_UNIQUE_COLUMN_MAPS is set. Otherwise every value the column can translate
+// is moved into this DataSet's map, and the column is re-coded if the two maps disagree.
+void DataSet::adopt_map(Column &col) {
+    if (!col.is_categorical() || ALLOW_UNIQUE_COLUMN_MAPS || col.translation_map_ptr == translation_map_ptr) return;
+
+    // Each distinct code is translated once, then the rows are recoded through that table in parallel
+    const Bimap<long double, std::string> &foreign = *col.translation_map_ptr;
+    GroupTable codes = col.distinct_codes();
+    std::vector<long double> recoded(codes.size());
+
+    for (std::uint32_t g = 0; g < codes.size(); g++) {
+        long double v = *codes.get_key(g);
+        recoded[g] = foreign.has_key(v) ? encode(foreign.get_value(v)) : v;
+    }
+
+    parallel_for(0, col.data.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            long double &v = col.data[i];
+            if (v == v) v = recoded[codes.find(&v, hash_value(v))];
+        }
+    });
+
+    col.translation_map_ptr = translation_map_ptr;
+}
+
+std::vector<ColumnSummary> DataSet::describe() const {
+    std::vector<const Column*> shown;
+    std::vector<const long double*> cols;
+
+    for (const auto &col : data) {
+        if (col->is_masked()) continue;
+        shown.push_back(col.get());
+        cols.push_back(col->data.data());
+    }
+
+    std::vector<ColumnSummary> out = summarize_columns(cols, num_rows());
+
+    for (std::size_t i = 0; i < out.size(); i++) {
+        out[i].label = shown[i]->label;
+        if (!shown[i]->is_categorical()) continue;
+
+        // Codes are hashes of the terms, so only the counts mean anything
+        ColumnSummary &s = out[i];
+        s.mean = s.std = s.min = s.q25 = s.median = s.q75 = s.max = NAN;
+        s.distinct = shown[i]->distinct_count(); // Exact over the codes
+    }
+
+    return out;
+}
+
+std::vector<int> DataSet::col_indices(const std::vector<std::string> &labels, const char *caller) const {
+    std::vector<int> out;
+
+    for (const std::string &label : labels) {
+        int index = get_col_index(label);
+
+        if (index < 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> " << caller << "() -> No column labelled '" << label << "'!" << std::endl;
+            throw -1;
+        }
+        out.push_back(index);
+    }
+
+    return out;
+}
+
+DataSet DataSet::select(const std::vector<std::string> &labels) const {
+    DataSet out;
+    out.translation_map_ptr = translation_map_ptr;
+
+    for (int index : col_indices(labels, "select")) out.data.push_back(std::unique_ptr<Column>(new Column(*data[index])));
+    return out;
+}
+
+DataSet DataSet::cov(Nulls nulls) const {
+    return pair_matrix(nulls, false);
+}
+
+DataSet DataSet::corr(Nulls nulls) const {
+    return pair_matrix(nulls, true);
+}
+
+std::vector<int> DataSet::numeric_cols() const {
+    std::vector<int> out;
+
+    for (std::size_t c = 0; c < data.size(); c++) {
+        if (!data[c]->is_masked() && !data[c]->is_categorical()) out.push_back(c);
+    }
+    return out;
+}
+
+MatrixView DataSet::matrix_view(const std::vector<std::string> &labels) const {
+    std::vector<const long double*> cols;
+
+    for (int index : labels.empty() ? numeric_cols() : col_indices(labels, "matrix_view")) cols.push_back(data[index]->data.data());
+    return MatrixView(std::move(cols), num_rows());
+}
+
+std::vector<int> DataSet::categorical_cols(const std::vector<std::string> &labels, const char *caller) const {
+    std::vector<int> cols = col_indices(labels, caller);
+
+    for (int index : cols) {
+        if (!data[index]->is_categorical()) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> " << caller << "() -> Column '" << data[index]->label << "' is not categorical!" << std::endl;
+            throw -1;
+        }
+    }
+
+    return cols;
+}
+
+std::vector<std::vector<std::string>> DataSet::vocabulary(const std::vector<std::string> &labels) const {
+    std::vector<int> cols = categorical_cols(labels, "vocabulary");
+    std::vector<std::vector<std::string>> out(cols.size());
+
+    parallel_for_each(0, cols.size(), [&](std::size_t c) {
+        const Column &col = *data[cols[c]];
+        GroupTable codes = col.distinct_codes();
+
+        for (std::uint32_t g = 0; g < codes.size(); g++) {
+            if (col.translation_map_ptr->has_key(*codes.get_key(g))) out[c].push_back(col.translation_map_ptr->get_value(*codes.get_key(g)));
+        }
+        std::sort(out[c].begin(), out[c].end());
+    });
+
+    return out;
+}
+
+// The terms are looked up in the map once, so rows are matched on their codes. Rows are split into blocks: each block finds the
+// output column of its values and counts them, the counts give every block its first slot, and each block then writes its own rows
+SparseMatrix DataSet::one_hot(const std::vector<std::string> &labels, const std::vector<std::vector<std::string>> &vocabulary, SparseLayout layout) const {
+    const std::uint32_t NONE = GroupTable::NONE;
+    std::vector<int> cols = categorical_cols(labels, "one_hot");
+    const std::size_t k = cols.size(), n = num_rows();
+
+    if (vocabulary.size() != k) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> one_hot() -> One vocabulary is needed per column!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<GroupTable> known(k, GroupTable(1)); // Codes of the terms of column c that its map holds
+    std::vector<std::vector<std::uint32_t>> output(k); // Output column of each of those codes
+    std::vector<std::string> out_labels;
+
+    for (std::size_t c = 0; c < k; c++) {
+        const Column &col = *data[cols[c]];
+        std::vector<std::string> terms = vocabulary[c];
+        std::sort(terms.begin(), terms.end());
+
+        if (std::adjacent_find(terms.begin(), terms.end()) != terms.end()) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> one_hot() -> Vocabulary of column '" << col.label << "' repeats a term!" << std::endl;
+            throw -1;
+        }
+
+        for (const std::string &term : vocabulary[c]) {
+            if (col.translation_map_ptr->has_value(term)) { // Otherwise no row can hold it, and its output stays empty
+                long double code = col.translation_map_ptr->get_key(term);
+                known[c].insert(&code, hash_value(code));
+                output[c].push_back(out_labels.size());
+            }
+            out_labels.push_back(col.label + "_" + term);
+        }
+    }
+
+    const std::size_t blocks = std::max<std::size_t>(1, (n + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN);
+    std::vector<std::uint32_t> hit(n * k);
+    std::vector<std::size_t> first(blocks + 1, 0);
+
+    parallel_for_each(0, blocks, [&](std::size_t b) {
+        for (std::size_t r = b * AGGREGATE_GRAIN; r < std::min(n, (b + 1) * AGGREGATE_GRAIN); r++) {
+            for (std::size_t c = 0; c < k; c++) {
+                const long double v = data[cols[c]]->data[r];
+                std::uint32_t g = v == v ? known[c].find(&v, hash_value(v)) : NONE;
+
+                hit[r * k + c] = g == NONE ? NONE : output[c][g];
+                first[b + 1] += g != NONE;
+            }
+        }
+    });
+    for (std::size_t b = 0; b < blocks; b++) first[b + 1] += first[b];
+
+    std::vector<std::size_t> offsets(n + 1, 0);
+    std::vector<unsigned int> indices(first[blocks]);
+
+    // Every column's outputs follow the last column's, so a row's entries come out in ascending order
+    parallel_for_each(0, blocks, [&](std::size_t b) {
+        std::size_t slot = first[b];
+
+        for (std::size_t r = b * AGGREGATE_GRAIN; r < std::min(n, (b + 1) * AGGREGATE_GRAIN); r++) {
+            for (std::size_t c = 0; c < k; c++) {
+                if (hit[r * k + c] != NONE) indices[slot++] = hit[r * k + c];
+            }
+            offsets[r + 1] = slot;
+        }
+    });
+
+    std::vector<long double> values(indices.size(), 1);
+    const std::size_t width = out_labels.size();
+    SparseMatrix out(SparseLayout::CSR, n, width, std::move(offsets), std::move(indices), std::move(values), std::move(out_labels));
+    return layout == SparseLayout::CSR ? out : out.transposed();
+}
+
+DataSet DataSet::pair_matrix(Nulls nulls, bool normalize) const {
+    std::vector<const Column*> used;
+    std::vector<const long double*> cols;
+
+    for (int index : numeric_cols()) {
+        used.push_back(data[index].get());
+        cols.push_back(data[index]->data.data());
+    }
+
+    const std::size_t k = cols.size();
+    std::vector<long double> m = covariance_matrix(cols, num_rows(), nulls, normalize);
+
+    DataSet out;
+    for (std::size_t j = 0; j < k; j++) {
+        std::vector<long double> values(k);
+        for (std::size_t i = 0; i < k; i++) values[i] = m[i * k + j];
+        out.add_col(Column(std::move(values), used[j]->label));
+    }
+
+    return out;
+}
+
+DataSet DataSet::take(const std::vector<unsigned int> &rows) const {
+    std::vector<int> cols(data.size());
+    for (std::size_t c = 0; c < cols.size(); c++) cols[c] = c;
+
+    return take(rows, cols);
+}
+
+DataSet DataSet::take(const std::vector<unsigned int> &rows, const std::vector<std::string> &labels) const {
+    return take(rows, col_indices(labels, "take"));
+}
+
+DataSet DataSet::take(const std::vector<unsigned int> &rows, const std::vector<int> &cols) const {
+    unsigned int n = num_rows();
+
+    for (unsigned int row : rows) {
+        if (row >= n) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> take() -> Row index out of range!" << std::endl;
+            throw -1;
+        }
+    }
+
+    DataSet out;
+    out.translation_map_ptr = translation_map_ptr;
+
+    std::vector<const long double*> src;
+    std::vector<long double*> dst;
+
+    for (int index : cols) {
+        const auto &col = data[index];
+        Column *c = new Column(std::vector<long double>(rows.size()), col->label);
+        c->masked = col->masked;
+        c->translation_map_ptr = col->translation_map_ptr;
+        out.data.push_back(std::unique_ptr<Column>(c));
+
+        src.push_back(col->data.data());
+        dst.push_back(c->data.data());
+    }
+
+    gather(src, rows.data(), rows.size(), dst);
+    return out;
+}
+
+std::vector<unsigned int> DataSet::argsort(const std::vector<std::string> &keys, const std::vector<bool> &ascending) const {
+    if (keys.empty() || (!ascending.empty() && ascending.size() != keys.size())) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> argsort() -> One direction is needed per key!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<const long double*> cols;
+    std::vector<std::vector<long double>> ranks; // Categorical keys are replaced by the rank of their string
+    ranks.reserve(keys.size());
+
+    for (const std::string &key : keys) {
+        int index = get_col_index(key);
+
+        if (index < 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> argsort() -> No column labelled '" << key << "'!" << std::endl;
+            throw -1;
+        }
+
+        const Column &col = *data[index];
+        if (!col.is_categorical()) {
+            cols.push_back(col.data.data());
+            continue;
+        }
+
+        ranks.push_back(string_ranks(col));
+        cols.push_back(ranks.back().data());
+    }
+
+    return argsort_columns(cols, num_rows(), ascending);
+}
+
+// Values the map cannot translate have no rank, so they sort last and top_k() leaves them out, like NaN
+std::vector<long double> DataSet::string_ranks(const Column &col) const {
+    std::vector<std::pair<std::string, long double>> terms;
+    for (const auto &entry : col.translation_map_ptr->left()) terms.push_back({entry.second, entry.first});
+    std::sort(terms.begin(), terms.end());
+
+    std::unordered_map<long double, long double> rank;
+    for (std::size_t r = 0; r < terms.size(); r++) rank[terms[r].second] = r;
+
+    std::vector<long double> out(col.size());
+    parallel_for(0, col.size(), AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            auto it = rank.find(col.data[i]);
+            out[i] = it == rank.end() ? NAN : it->second;
+        }
+    });
+
+    return out;
+}
+
+DataSet DataSet::sort_by(const std::vector<std::string> &keys, const std::vector<bool> &ascending) const {
+    return take(argsort(keys, ascending));
+}
+
+DataSet DataSet::top_k(const std::string &key, std::size_t k, bool largest) const {
+    int index = get_col_index(key);
+
+    if (index < 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> top_k() -> No column labelled '" << key << "'!" << std::endl;
+        throw -1;
+    }
+
+    // Category codes are hashes, so categorical keys are ranked by their strings first, as argsort() does
+    const Column &col = *data[index];
+    if (!col.is_categorical()) return take(top_k_values(col.data.data(), num_rows(), k, largest));
+
+    std::vector<long double> ranks = string_ranks(col);
+    return take(top_k_values(ranks.data(), num_rows(), k, largest));
+}
+
+DataSet DataSet::rolling(const std::vector<std::string> &labels, const std::vector<std::size_t> &windows, Roll fn, std::size_t min_periods) const {
+    std::vector<int> cols = col_indices(labels, "rolling");
+    std::vector<Column> out(cols.size() * windows.size());
+
+    // Each column runs its own row blocks in parallel as well, so a few long columns still fill the pool
+    parallel_for_each(0, out.size(), [&](std::size_t i) {
+        out[i] = data[cols[i / windows.size()]]->rolling(windows[i % windows.size()], fn, min_periods);
+    });
+
+    DataSet ds;
+    ds.translation_map_ptr = translation_map_ptr;
+    for (Column &col : out) ds.data.push_back(std::unique_ptr<Column>(new Column(std::move(col))));
+    return ds;
+}
+
+DataSet DataSet::ewm(const std::vector<std::string> &labels, const std::vector<long double> &alphas, Ewm fn) const {
+    std::vector<int> cols = col_indices(labels, "ewm");
+    std::vector<Column> out(cols.size() * alphas.size());
+
+    parallel_for_each(0, out.size(), [&](std::size_t i) {
+        out[i] = data[cols[i / alphas.size()]]->ewm(alphas[i % alphas.size()], fn);
+    });
+
+    DataSet ds;
+    ds.translation_map_ptr = translation_map_ptr;
+    for (Column &col : out) ds.data.push_back(std::unique_ptr<Column>(new Column(std::move(col))));
+    return ds;
+}
+
+DataSet DataSet::filter(const Bitmask &mask) const {
+    if (mask.size() != num_rows()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> filter() -> Mask length does not match!" << std::endl;
+        throw -1;
+    }
+
+    return take(mask.to_selection());
+}
+
+void DataSet::set_map_ptr(std::shared_ptr<Bimap<long double, std::string>> bm_ptr) {
+    translation_map_ptr = bm_ptr;
+
+    for (auto &col : data) {
+        if (col->is_categorical()) col->translation_map_ptr = bm_ptr;
+    }
+}
+
+// Kernels that return their own types from DataSet members. They need the complete DataSet, so they come last
+#include "../Algorithm/GroupBy.h"
+#include "../Algorithm/Join.h"
+#include "../Query/Expression.h"
+
+#endif
+
 
@@ -0,0 +1,37 @@
+// A read-only view of a subset of a DataSet's rows. Nothing is copied until the view is materialized
+#ifndef DATASETVIEW_H
+#define DATASETVIEW_H
+
+#include <vector>
+#include <utility>
+
+#include "DataSet.h"
+#include "../Algorithm/Select.h"
+
+/* Declarations */
+
+// The viewed DataSet must outlive the view and keep its shape while the view is in use
+class DataSetView {
+    private:
+        const DataSet *ds;
+        std::vector<unsigned int> rows; // Positions of the viewed rows in 'ds'
+
+    public:
+        DataSetView(const DataSet &ds, std::vector<unsigned int> rows) : ds(&ds), rows(std::move(rows)) { }
+        DataSetView(const DataSet &ds, const Bitmask &mask) : ds(&ds), rows(mask.to_selection()) { }
+        template <typename Predicate>
+        DataSetView(const DataSet &ds, const Predicate &pred) : ds(&ds), rows(pred.evaluate(ds).to_selection()) { }
+
+        unsigned int num_rows() const { return rows.size(); }
+        unsigned int num_cols() const { return ds->num_cols(); }
+
+        long double at(unsigned int index_x, unsigned int index_y) const { return ds->get_col_ref(index_x).at(rows.at(index_y)); } // Value of column 'index_x' at the view's row 'index_y'
+        unsigned int source_row(unsigned int index) const { return rows.at(index); }                                         // Position of the view's row 'index' in the viewed DataSet
+
+        const DataSet& get_source() const { return *ds; }
+        const std::vector<unsigned int>& get_selection() const { return rows; }
+
+        DataSet materialize() const { return ds->take(rows); } // Copies the viewed rows out into a new DataSet
+};
+
+#endif
@@ -0,0 +1,107 @@
+// Open-addressing hash table that numbers distinct keys. Used to group and join rows on one or more key columns
+#ifndef GROUPTABLE_H
+#define GROUPTABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "../util/Hash.h"
+
+/* Declarations */
+
+// Keys are 'width' long doubles. Groups are numbered from 0 in the order their keys were first inserted.
+// Slots only hold a hash and a group number so probing stays within a few cache lines, and the keys themselves are packed
+// in group order. NaN keys compare equal to each other, so missing values form a group of their own.
+class GroupTable {
+    private:
+        struct Slot {
+            std::uint64_t hash;
+            std::uint32_t group;
+        };
+
+        unsigned int width;
+        std::vector<Slot> slots;        // Power of two in size, at most half full
+        std::vector<long double> keys;  // 'width' values per group
+
+        bool same(const long double *a, const long double *b) const;
+        void grow();
+
+    public:
+        static constexpr std::uint32_t NONE = 0xffffffff;
+
+        GroupTable(unsigned int width, std::size_t expected = 0);
+
+        std::uint32_t insert(const long double *key, std::uint64_t hash);     // Group of 'key', numbering it if it is new
+        std::uint32_t find(const long double *key, std::uint64_t hash) const; // Group of 'key', or NONE
+
+        std::size_t size() const { return keys.size() / width; }
+        const long double* get_key(std::uint32_t group) const { return keys.data() + (std::size_t)group * width; }
+};
+
+inline std::uint64_t hash_key(const long double *key, unsigned int width); // Hash of a whole key, consistent with hash_value for one column
+
+/* Definitions */
+
+inline std::uint64_t hash_key(const long double *key, unsigned int width) {
+    std::uint64_t h = hash_value(key[0]);
+    for (unsigned int k = 1; k < width; k++) h = mix64(h + 0x9e3779b97f4a7c15ULL * k) ^ hash_value(key[k]);
+    return h;
+}
+
+inline GroupTable::GroupTable(unsigned int width, std::size_t expected) : width(width) {
+    std::size_t capacity = 16;
+    while (capacity < 2 * expected) capacity *= 2;
+
+    slots.assign(capacity, Slot{0, NONE});
+    keys.reserve(expected * width);
+}
+
+inline bool GroupTable::same(const long double *a, const long double *b) const {
+    for (unsigned int k = 0; k < width; k++) {
+        if (a[k] != b[k] && (a[k] == a[k] || b[k] == b[k])) return false;
+    }
+    return true;
+}
+
+inline void GroupTable::grow() {
+    std::vector<Slot> old(slots.size() * 2, Slot{0, NONE});
+    old.swap(slots);
+
+    std::size_t mask = slots.size() - 1;
+    for (const Slot &s : old) {
+        if (s.group == NONE) continue;
+
+        std::size_t i = s.hash & mask;
+        while (slots[i].group != NONE) i = (i + 1) & mask;
+        slots[i] = s;
+    }
+}
+
+inline std::uint32_t GroupTable::insert(const long double *key, std::uint64_t hash) {
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+
+    for (; slots[i].group != NONE; i = (i + 1) & mask) {
+        if (slots[i].hash == hash && same(get_key(slots[i].group), key)) return slots[i].group;
+    }
+
+    std::uint32_t group = size();
+    slots[i] = Slot{hash, group};
+    keys.insert(keys.end(), key, key + width);
+
+    if (2 * size() > slots.size()) grow();
+    return group;
+}
+
+inline std::uint32_t GroupTable::find(const long double *key, std::uint64_t hash) const {
+    std::size_t mask = slots.size() - 1;
+
+    for (std::size_t i = hash & mask; slots[i].group != NONE; i = (i + 1) & mask) {
+        if (slots[i].hash == hash && same(get_key(slots[i].group), key)) return slots[i].group;
+    }
+
+    return NONE;
+}
+
+#endif
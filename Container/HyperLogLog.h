@@ -0,0 +1,99 @@
+// HyperLogLog: a fixed-size, mergeable sketch that estimates the number of distinct values in a stream
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <algorithm>
+
+#include "../util/Bits.h"
+#include "../util/Hash.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// 2^precision one-byte registers, each holding the longest run of leading zeros seen among the hashes routed to it.
+// The standard error of the estimate is 1.04 / sqrt(2^precision), 0.8% at the default precision of 14. Small counts are
+// estimated by linear counting over the empty registers, which is close to exact. Sketches of the same precision merge by
+// taking the larger of each pair of registers, so blocks, threads and partitions can be sketched separately.
+class HyperLogLog {
+    private:
+        unsigned int precision;
+        std::vector<std::uint8_t> registers;
+
+    public:
+        HyperLogLog(unsigned int precision = HLL_PRECISION); // 'precision' must lie in [4, 18]
+
+        void add_hash(std::uint64_t hash);              // 'hash' must be well mixed, like those of hash_value()
+        void add(long double v) { if (v == v) add_hash(hash_value(v)); } // NaN is ignored
+        void add(const long double *v, std::size_t n);  // Hashes a batch first, then updates the registers
+        void merge(const HyperLogLog &other);           // Throws if the precisions differ
+
+        std::size_t estimate() const;
+        unsigned int get_precision() const { return precision; }
+};
+
+/* Definitions */
+
+inline HyperLogLog::HyperLogLog(unsigned int precision) : precision(precision) {
+    if (precision < 4 || precision > 18) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> HyperLogLog() -> Precision must lie between 4 and 18!" << std::endl;
+        throw -1;
+    }
+
+    registers.assign((std::size_t)1 << precision, 0);
+}
+
+inline void HyperLogLog::add_hash(std::uint64_t hash) {
+    std::size_t index = hash >> (64 - precision);
+    std::uint64_t rest = hash << precision;
+    std::uint8_t rank = rest ? clz64(rest) + 1 : 64 - precision + 1;
+
+    if (rank > registers[index]) registers[index] = rank;
+}
+
+// Hashing is the expensive part and has no dependencies between values, so a batch of hashes is computed in a tight loop
+// before any register is touched
+inline void HyperLogLog::add(const long double *v, std::size_t n) {
+    std::uint64_t hashes[256];
+
+    for (std::size_t lo = 0; lo < n; lo += 256) {
+        std::size_t hi = std::min(n, lo + 256), count = 0;
+
+        for (std::size_t i = lo; i < hi; i++) {
+            hashes[count] = hash_value(v[i]);
+            count += v[i] == v[i];
+        }
+        for (std::size_t i = 0; i < count; i++) add_hash(hashes[i]);
+    }
+}
+
+inline void HyperLogLog::merge(const HyperLogLog &other) {
+    if (other.precision != precision) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> HyperLogLog::merge() -> Precisions do not match!" << std::endl;
+        throw -1;
+    }
+
+    for (std::size_t i = 0; i < registers.size(); i++) registers[i] = std::max(registers[i], other.registers[i]);
+}
+
+inline std::size_t HyperLogLog::estimate() const {
+    const long double m = registers.size();
+    long double sum = 0;
+    std::size_t zeros = 0;
+
+    for (std::uint8_t r : registers) {
+        sum += std::ldexp(1.0L, -(int)r);
+        zeros += r == 0;
+    }
+
+    long double estimate = 0.7213L / (1 + 1.079L / m) * m * m / sum;
+    if (estimate <= 2.5L * m && zeros > 0) estimate = m * std::log(m / zeros);
+
+    return (std::size_t)std::llround(estimate);
+}
+
+#endif
@@ -0,0 +1,138 @@
+// Dense numeric matrices for handing a DataSet to model code: a column-major Matrix that owns its values, and a MatrixView
+// that reads a DataSet's columns where they are
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+
+#include "../Algorithm/Gemm.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// A rows x cols matrix stored column by column in one buffer, so data() can go straight to code that expects a Fortran-order
+// array. 'T' is usually long double, like the DataSet, or double for the faster kernels
+template <typename T>
+class Matrix {
+    private:
+        std::size_t n_rows, n_cols;
+        std::vector<T> values;
+
+    public:
+        Matrix() : n_rows(0), n_cols(0) { }
+        Matrix(std::size_t rows, std::size_t cols, T fill = 0) : n_rows(rows), n_cols(cols), values(rows * cols, fill) { }
+
+        T& operator()(std::size_t row, std::size_t col) { return values[row + col * n_rows]; }
+        T operator()(std::size_t row, std::size_t col) const { return values[row + col * n_rows]; }
+        T& at(std::size_t row, std::size_t col);      // Same as operator(), but throws if out of range
+        T at(std::size_t row, std::size_t col) const;
+
+        T* data() { return values.data(); }
+        const T* data() const { return values.data(); }
+        T* col(std::size_t index) { return values.data() + index * n_rows; } // Start of column 'index'
+        const T* col(std::size_t index) const { return values.data() + index * n_rows; }
+
+        std::size_t rows() const { return n_rows; }
+        std::size_t cols() const { return n_cols; }
+
+        Matrix transpose() const; // Blocked and split across threads (see Algorithm/Gemm.h)
+        Matrix gram() const;      // This matrix's transpose times itself, e.g. X^T X for a design matrix X
+};
+
+// op(a) * op(b), where op() transposes when asked. Throws if the inner sizes differ
+template <typename T>
+Matrix<T> matmul(const Matrix<T> &a, const Matrix<T> &b, bool trans_a = false, bool trans_b = false);
+
+// A rows x cols matrix over columns that live elsewhere, usually a DataSet's. Nothing is copied, so the view is only valid while
+// those columns are neither resized nor destroyed. Each column is contiguous, but the columns need not be next to each other
+class MatrixView {
+    private:
+        std::vector<const long double*> columns;
+        std::size_t n_rows;
+
+    public:
+        MatrixView(std::vector<const long double*> columns, std::size_t rows) : columns(std::move(columns)), n_rows(rows) { }
+
+        long double operator()(std::size_t row, std::size_t col) const { return columns[col][row]; }
+        const long double* col(std::size_t index) const { return columns[index]; }
+
+        std::size_t rows() const { return n_rows; }
+        std::size_t cols() const { return columns.size(); }
+
+        const long double* data() const; // The whole matrix as one column-major buffer when the columns lie back to back, otherwise nullptr
+
+        template <typename T = long double>
+        Matrix<T> to_dense() const;      // Copies the columns into one buffer. Blocks of rows are copied in parallel
+};
+
+/* Definitions */
+
+template <typename T>
+T& Matrix<T>::at(std::size_t row, std::size_t col) {
+    if (row >= n_rows || col >= n_cols) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Matrix::at() -> Index out of range!" << std::endl;
+        throw -1;
+    }
+    return (*this)(row, col);
+}
+
+template <typename T>
+T Matrix<T>::at(std::size_t row, std::size_t col) const {
+    return const_cast<Matrix<T>&>(*this).at(row, col);
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::transpose() const {
+    Matrix<T> out(n_cols, n_rows);
+    ::transpose(values.data(), n_rows, n_cols, out.data());
+    return out;
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::gram() const {
+    Matrix<T> out(n_cols, n_cols);
+    ::gram(values.data(), n_rows, n_cols, out.data());
+    return out;
+}
+
+template <typename T>
+Matrix<T> matmul(const Matrix<T> &a, const Matrix<T> &b, bool trans_a, bool trans_b) {
+    std::size_t m = trans_a ? a.cols() : a.rows(), k = trans_a ? a.rows() : a.cols();
+    std::size_t kb = trans_b ? b.cols() : b.rows(), n = trans_b ? b.rows() : b.cols();
+
+    if (k != kb) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> matmul() -> Inner dimensions do not match!" << std::endl;
+        throw -1;
+    }
+
+    Matrix<T> out(m, n);
+    gemm(a.data(), trans_a, b.data(), trans_b, out.data(), m, n, k);
+    return out;
+}
+
+inline const long double* MatrixView::data() const {
+    for (std::size_t c = 1; c < columns.size(); c++) {
+        if (columns[c] != columns[c - 1] + n_rows) return nullptr;
+    }
+    return columns.empty() ? nullptr : columns[0];
+}
+
+template <typename T>
+Matrix<T> MatrixView::to_dense() const {
+    Matrix<T> out(n_rows, columns.size());
+
+    parallel_for(0, n_rows, AGGREGATE_GRAIN, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t c = 0; c < columns.size(); c++) {
+            T *dst = out.col(c);
+            for (std::size_t r = lo; r < hi; r++) dst[r] = (T)columns[c][r];
+        }
+    });
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,140 @@
+// Compressed sparse matrices, e.g. the one-hot encoding of a categorical column (see DataSet::one_hot())
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+
+#include "Matrix.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+enum class SparseLayout { CSR, CSC };
+
+// CSR: the entries of row r are at [offsets[r], offsets[r + 1]) of 'indices', which holds their columns in ascending order,
+// and of 'values'. CSC is the same with rows and columns swapped. The arrays follow scipy.sparse, so they can be handed over as they are
+class SparseMatrix {
+    private:
+        SparseLayout layout;
+        std::size_t n_rows, n_cols;
+        std::vector<std::size_t> offsets;
+        std::vector<unsigned int> indices;
+        std::vector<long double> values;
+        std::vector<std::string> labels; // One per column, or none
+
+    public:
+        SparseMatrix() : layout(SparseLayout::CSR), n_rows(0), n_cols(0), offsets(1, 0) { }
+        SparseMatrix(SparseLayout layout, std::size_t rows, std::size_t cols, std::vector<std::size_t> offsets, std::vector<unsigned int> indices,
+                     std::vector<long double> values, std::vector<std::string> labels = {}); // Throws if the array lengths do not fit the shape
+
+        long double at(std::size_t row, std::size_t col) const; // 0 where there is no entry. Throws if out of range
+
+        std::size_t rows() const { return n_rows; }
+        std::size_t cols() const { return n_cols; }
+        std::size_t nnz() const { return indices.size(); } // Number of stored entries
+        SparseLayout get_layout() const { return layout; }
+
+        const std::vector<std::size_t>& get_offsets() const { return offsets; }
+        const std::vector<unsigned int>& get_indices() const { return indices; }
+        const std::vector<long double>& get_values() const { return values; }
+        const std::vector<std::string>& get_labels() const { return labels; }
+
+        SparseMatrix to_csr() const { return layout == SparseLayout::CSR ? *this : transposed(); } // The same matrix stored by rows
+        SparseMatrix to_csc() const { return layout == SparseLayout::CSC ? *this : transposed(); } // The same matrix stored by columns
+        SparseMatrix transposed() const;                                                          // The same matrix in the other layout
+        Matrix<long double> to_dense() const;
+};
+
+/* Definitions */
+
+inline SparseMatrix::SparseMatrix(SparseLayout layout, std::size_t rows, std::size_t cols, std::vector<std::size_t> offsets,
+                                  std::vector<unsigned int> indices, std::vector<long double> values, std::vector<std::string> labels)
+    : layout(layout), n_rows(rows), n_cols(cols), offsets(std::move(offsets)), indices(std::move(indices)), values(std::move(values)), labels(std::move(labels)) {
+    std::size_t major = layout == SparseLayout::CSR ? rows : cols;
+
+    if (this->offsets.size() != major + 1 || this->offsets.back() != this->indices.size() || this->values.size() != this->indices.size() ||
+        (!this->labels.empty() && this->labels.size() != cols)) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> SparseMatrix() -> Arrays do not match the shape!" << std::endl;
+        throw -1;
+    }
+}
+
+inline long double SparseMatrix::at(std::size_t row, std::size_t col) const {
+    if (row >= n_rows || col >= n_cols) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> SparseMatrix::at() -> Index out of range!" << std::endl;
+        throw -1;
+    }
+
+    std::size_t major = layout == SparseLayout::CSR ? row : col, minor = layout == SparseLayout::CSR ? col : row;
+    auto begin = indices.begin() + offsets[major], end = indices.begin() + offsets[major + 1];
+    auto it = std::lower_bound(begin, end, (unsigned int)minor);
+
+    return it != end && *it == minor ? values[it - indices.begin()] : 0;
+}
+
+// A counting sort on the minor index. Blocks of major lines count their entries per minor index in parallel; the counts are
+// then laid out minor index first, block second, so each block scatters its own entries into place and every new line comes
+// out in ascending order
+inline SparseMatrix SparseMatrix::transposed() const {
+    const std::size_t major = layout == SparseLayout::CSR ? n_rows : n_cols, minor = layout == SparseLayout::CSR ? n_cols : n_rows;
+    const std::size_t blocks = std::max<std::size_t>(1, std::min<std::size_t>((major + AGGREGATE_GRAIN - 1) / AGGREGATE_GRAIN, 4 * thread_count()));
+    const std::size_t step = (major + blocks - 1) / blocks;
+
+    std::vector<std::size_t> start(blocks * minor, 0); // start[b * minor + j]: first slot of block b in new line j
+
+    parallel_for_each(0, blocks, [&](std::size_t b) {
+        std::size_t *count = start.data() + b * minor;
+        for (std::size_t p = offsets[std::min(major, b * step)]; p < offsets[std::min(major, (b + 1) * step)]; p++) count[indices[p]]++;
+    });
+
+    std::vector<std::size_t> out_offsets(minor + 1, 0);
+    std::size_t running = 0;
+    for (std::size_t j = 0; j < minor; j++) {
+        out_offsets[j] = running;
+        for (std::size_t b = 0; b < blocks; b++) {
+            std::size_t count = start[b * minor + j];
+            start[b * minor + j] = running;
+            running += count;
+        }
+    }
+    out_offsets[minor] = running;
+
+    std::vector<unsigned int> out_indices(nnz());
+    std::vector<long double> out_values(nnz());
+
+    parallel_for_each(0, blocks, [&](std::size_t b) {
+        std::size_t *next = start.data() + b * minor;
+
+        for (std::size_t i = b * step; i < std::min(major, (b + 1) * step); i++) {
+            for (std::size_t p = offsets[i]; p < offsets[i + 1]; p++) {
+                std::size_t slot = next[indices[p]]++;
+                out_indices[slot] = i;
+                out_values[slot] = values[p];
+            }
+        }
+    });
+
+    SparseLayout other = layout == SparseLayout::CSR ? SparseLayout::CSC : SparseLayout::CSR;
+    return SparseMatrix(other, n_rows, n_cols, std::move(out_offsets), std::move(out_indices), std::move(out_values), labels);
+}
+
+inline Matrix<long double> SparseMatrix::to_dense() const {
+    Matrix<long double> out(n_rows, n_cols);
+
+    for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+        for (std::size_t p = offsets[i]; p < offsets[i + 1]; p++) {
+            if (layout == SparseLayout::CSR) out(i, indices[p]) = values[p];
+            else out(indices[p], i) = values[p];
+        }
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,355 @@
+// Export and import of Columns and DataSets through the Arrow C Data Interface. Only the ABI structs are needed, no Arrow library.
+#ifndef ARROW_H
+#define ARROW_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+// The ABI structs, exactly as published in the Arrow C Data Interface specification
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+
+/* Declarations */
+
+// Numeric columns export as float64, since Arrow has no extended precision type. NaN values are exported as nulls.
+// Categorical columns export as int32 indices into a utf8 dictionary of the strings they contain.
+// The produced structs own their buffers until the consumer calls their release callbacks.
+inline void export_column(const Column &col, ArrowSchema *schema, ArrowArray *array);
+inline void export_dataset(const DataSet &ds, ArrowSchema *schema, ArrowArray *array); // Exports a struct array with one child per column
+
+// Takes ownership of the structs and releases them once the data has been read. Nulls become NaN.
+// Dictionary-encoded arrays become categorical columns.
+inline Column import_column(ArrowSchema *schema, ArrowArray *array);
+inline DataSet import_dataset(ArrowSchema *schema, ArrowArray *array); // Expects a struct array, as produced by export_dataset
+
+/* Definitions */
+
+namespace arrow_detail {
+    // Everything an exported ArrowSchema points into
+    struct SchemaData {
+        std::string format;
+        std::string name;
+        std::vector<ArrowSchema*> children;
+        ArrowSchema *dictionary = nullptr;
+    };
+
+    // Everything an exported ArrowArray points into
+    struct ArrayData {
+        std::vector<double> values;
+        std::vector<std::int32_t> indices;
+        std::vector<std::int32_t> offsets;
+        std::string chars;
+        std::vector<std::uint8_t> validity;
+        std::vector<const void*> buffers;
+        std::vector<ArrowArray*> children;
+        ArrowArray *dictionary = nullptr;
+    };
+
+    inline void release_schema(ArrowSchema *schema) {
+        SchemaData *pd = static_cast<SchemaData*>(schema->private_data);
+
+        for (ArrowSchema *child : pd->children) {
+            if (child->release) child->release(child);
+            delete child;
+        }
+        if (pd->dictionary) {
+            if (pd->dictionary->release) pd->dictionary->release(pd->dictionary);
+            delete pd->dictionary;
+        }
+
+        delete pd;
+        schema->release = nullptr;
+    }
+
+    inline void release_array(ArrowArray *array) {
+        ArrayData *pd = static_cast<ArrayData*>(array->private_data);
+
+        for (ArrowArray *child : pd->children) {
+            if (child->release) child->release(child);
+            delete child;
+        }
+        if (pd->dictionary) {
+            if (pd->dictionary->release) pd->dictionary->release(pd->dictionary);
+            delete pd->dictionary;
+        }
+
+        delete pd;
+        array->release = nullptr;
+    }
+
+    inline void fill_schema(ArrowSchema *schema, SchemaData *pd, std::int64_t flags) {
+        schema->format = pd->format.c_str();
+        schema->name = pd->name.c_str();
+        schema->metadata = nullptr;
+        schema->flags = flags;
+        schema->n_children = pd->children.size();
+        schema->children = pd->children.empty() ? nullptr : pd->children.data();
+        schema->dictionary = pd->dictionary;
+        schema->release = &release_schema;
+        schema->private_data = pd;
+    }
+
+    inline void fill_array(ArrowArray *array, ArrayData *pd, std::int64_t length, std::int64_t null_count) {
+        array->length = length;
+        array->null_count = null_count;
+        array->offset = 0;
+        array->n_buffers = pd->buffers.size();
+        array->buffers = pd->buffers.data();
+        array->n_children = pd->children.size();
+        array->children = pd->children.empty() ? nullptr : pd->children.data();
+        array->dictionary = pd->dictionary;
+        array->release = &release_array;
+        array->private_data = pd;
+    }
+
+    inline bool valid(const ArrowArray *array, std::int64_t i) {
+        if (array->null_count == 0 || array->buffers[0] == nullptr) return true;
+
+        std::int64_t bit = array->offset + i;
+        return (static_cast<const std::uint8_t*>(array->buffers[0])[bit >> 3] >> (bit & 7)) & 1;
+    }
+
+    template <typename T>
+    inline void read_values(const ArrowArray *array, std::vector<long double> &out) {
+        const T *values = static_cast<const T*>(array->buffers[1]) + array->offset;
+
+        for (std::int64_t i = 0; i < array->length; i++) {
+            out[i] = valid(array, i) ? static_cast<long double>(values[i]) : NAN;
+        }
+    }
+
+    // Reads an integer buffer of the given format character into 'out'. Returns false for anything else
+    inline bool read_numeric(char format, const ArrowArray *array, std::vector<long double> &out) {
+        switch (format) {
+            case 'c': read_values<std::int8_t>(array, out);   return true;
+            case 'C': read_values<std::uint8_t>(array, out);  return true;
+            case 's': read_values<std::int16_t>(array, out);  return true;
+            case 'S': read_values<std::uint16_t>(array, out); return true;
+            case 'i': read_values<std::int32_t>(array, out);  return true;
+            case 'I': read_values<std::uint32_t>(array, out); return true;
+            case 'l': read_values<std::int64_t>(array, out);  return true;
+            case 'L': read_values<std::uint64_t>(array, out); return true;
+            case 'f': read_values<float>(array, out);         return true;
+            case 'g': read_values<double>(array, out);        return true;
+            case 'b': {
+                const std::uint8_t *bits = static_cast<const std::uint8_t*>(array->buffers[1]);
+                for (std::int64_t i = 0; i < array->length; i++) {
+                    std::int64_t bit = array->offset + i;
+                    out[i] = valid(array, i) ? (long double)((bits[bit >> 3] >> (bit & 7)) & 1) : NAN;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns the strings of a utf8 ('u') or large utf8 ('U') array
+    inline std::vector<std::string> read_strings(const ArrowSchema *schema, const ArrowArray *array) {
+        std::vector<std::string> out(array->length);
+        const char *chars = static_cast<const char*>(array->buffers[2]);
+        bool large = schema->format[0] == 'U';
+
+        for (std::int64_t i = 0; i < array->length; i++) {
+            std::int64_t k = array->offset + i, begin, end;
+
+            if (large) {
+                begin = static_cast<const std::int64_t*>(array->buffers[1])[k];
+                end = static_cast<const std::int64_t*>(array->buffers[1])[k + 1];
+            } else {
+                begin = static_cast<const std::int32_t*>(array->buffers[1])[k];
+                end = static_cast<const std::int32_t*>(array->buffers[1])[k + 1];
+            }
+
+            out[i] = std::string(chars + begin, end - begin);
+        }
+
+        return out;
+    }
+
+    // Releases imported structs when it goes out of scope, so a throw while reading them does not leak the producer's buffers
+    struct Releaser {
+        ArrowSchema *schema;
+        ArrowArray *array;
+
+        ~Releaser() {
+            if (array->release) array->release(array);
+            if (schema->release) schema->release(schema);
+        }
+    };
+
+    inline void fail(const std::string &func, const std::string &msg) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> " << func << "() -> " << msg << std::endl;
+        throw -1;
+    }
+
+    // Reads the column out of the structs without releasing them
+    inline Column read_column(const ArrowSchema *schema, const ArrowArray *array) {
+        std::vector<long double> data(array->length);
+        std::shared_ptr<Bimap<long double, std::string>> bm;
+
+        if (schema->dictionary != nullptr) {
+            std::string fmt = schema->dictionary->format;
+            if (fmt != "u" && fmt != "U") fail("import_column", "Only string dictionaries are supported!");
+
+            // The dictionary indices become the codes, so the DataSet re-codes them when the column is added to one
+            std::vector<std::string> words = read_strings(schema->dictionary, array->dictionary);
+            bm = std::make_shared<Bimap<long double, std::string>>();
+            for (std::size_t i = 0; i < words.size(); i++) bm->set(i, words[i]);
+
+            if (!read_numeric(schema->format[0], array, data)) fail("import_column", "Unsupported index type!");
+        } else if (std::strlen(schema->format) != 1 || !read_numeric(schema->format[0], array, data)) {
+            fail("import_column", "Unsupported format '" + std::string(schema->format) + "'!");
+        }
+
+        Column col(std::move(data), schema->name ? schema->name : DEFAULT_LABEL);
+        if (bm) col.set_map(bm);
+
+        return col;
+    }
+}
+
+inline void export_column(const Column &col, ArrowSchema *schema, ArrowArray *array) {
+    using namespace arrow_detail;
+
+    const std::vector<long double> &data = col.get_data();
+    const std::size_t n = data.size();
+
+    SchemaData *sd = new SchemaData();
+    ArrayData *ad = new ArrayData();
+    sd->name = col.get_label();
+
+    std::int64_t nulls = 0;
+    ad->validity.assign((n + 7) / 8, 0);
+
+    for (std::size_t i = 0; i < n; i++) {
+        if (std::isnan(data[i])) nulls++;
+        else ad->validity[i >> 3] |= 1 << (i & 7);
+    }
+
+    if (nulls == 0) ad->validity.clear();
+    ad->buffers.push_back(nulls == 0 ? nullptr : ad->validity.data());
+
+    if (col.is_categorical()) {
+        // Dictionary indices are handed out in order of first appearance
+        std::unordered_map<long double, std::int32_t> index;
+        SchemaData *dsd = new SchemaData();
+        ArrayData *dad = new ArrayData();
+
+        dsd->format = "u";
+        dad->offsets.push_back(0);
+        ad->indices.resize(n);
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (std::isnan(data[i])) continue;
+
+            auto it = index.find(data[i]);
+            if (it == index.end()) {
+                it = index.emplace(data[i], (std::int32_t)index.size()).first;
+                dad->chars += col.as_string(i);
+                dad->offsets.push_back(dad->chars.size());
+            }
+            ad->indices[i] = it->second;
+        }
+
+        dad->buffers = { nullptr, dad->offsets.data(), dad->chars.data() };
+
+        sd->format = "i";
+        sd->dictionary = new ArrowSchema();
+        ad->dictionary = new ArrowArray();
+        fill_schema(sd->dictionary, dsd, 0);
+        fill_array(ad->dictionary, dad, index.size(), 0);
+
+        ad->buffers.push_back(ad->indices.data());
+    } else {
+        sd->format = "g";
+        ad->values.assign(data.begin(), data.end());
+        ad->buffers.push_back(ad->values.data());
+    }
+
+    fill_schema(schema, sd, ARROW_FLAG_NULLABLE);
+    fill_array(array, ad, n, nulls);
+}
+
+inline void export_dataset(const DataSet &ds, ArrowSchema *schema, ArrowArray *array) {
+    using namespace arrow_detail;
+
+    SchemaData *sd = new SchemaData();
+    ArrayData *ad = new ArrayData();
+    sd->format = "+s";
+
+    for (unsigned int c = 0; c < ds.num_cols(); c++) {
+        sd->children.push_back(new ArrowSchema());
+        ad->children.push_back(new ArrowArray());
+        export_column(ds.get_col_ref(c), sd->children.back(), ad->children.back());
+    }
+
+    ad->buffers.push_back(nullptr);
+
+    fill_schema(schema, sd, 0);
+    fill_array(array, ad, ds.num_rows(), 0);
+}
+
+inline Column import_column(ArrowSchema *schema, ArrowArray *array) {
+    arrow_detail::Releaser done{schema, array};
+    return arrow_detail::read_column(schema, array);
+}
+
+inline DataSet import_dataset(ArrowSchema *schema, ArrowArray *array) {
+    arrow_detail::Releaser done{schema, array};
+    if (std::string(schema->format) != "+s") arrow_detail::fail("import_dataset", "Expected a struct array!");
+
+    DataSet ds;
+    for (std::int64_t c = 0; c < schema->n_children; c++) {
+        // Children of a sliced struct array inherit its offset
+        ArrowArray child = *array->children[c];
+        child.offset += array->offset;
+        child.length = array->length;
+
+        ds.add_col(arrow_detail::read_column(schema->children[c], &child));
+    }
+
+    return ds;
+}
+
+#endif
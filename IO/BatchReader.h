@@ -0,0 +1,110 @@
+// Interface for readers that hand out a file as a sequence of row batches, plus a wrapper that reads ahead on a background thread
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Every batch is a self-contained DataSet with the same columns. Categorical columns carry a dictionary of the terms in their own batch;
+// codes are derived from the terms, so they agree from one batch to the next.
+class BatchReader {
+    public:
+        virtual ~BatchReader() { }
+        virtual bool next(DataSet &batch) = 0; // Replaces 'batch' with the next rows. Returns false, leaving 'batch' untouched, once the input is exhausted
+};
+
+// Runs another reader on a background thread. At most 'depth' batches wait in the queue, so memory stays bounded by depth + 2 batches.
+class PrefetchReader : public BatchReader {
+    private:
+        std::unique_ptr<BatchReader> source;
+        std::deque<DataSet> queue;
+        std::size_t depth;
+        bool done;
+        bool stopping;
+        std::exception_ptr error;
+
+        std::mutex lock;
+        std::condition_variable changed;
+        std::thread worker;
+
+        void run(); // Body of the background thread
+
+    public:
+        PrefetchReader(std::unique_ptr<BatchReader> source, std::size_t depth = PREFETCH_DEPTH);
+        ~PrefetchReader();
+
+        PrefetchReader(const PrefetchReader &pr) = delete;
+        PrefetchReader& operator=(const PrefetchReader &pr) = delete;
+
+        bool next(DataSet &batch) override; // Re-throws anything the source threw, once the batches before it have been handed out
+};
+
+/* Definitions */
+
+inline PrefetchReader::PrefetchReader(std::unique_ptr<BatchReader> source, std::size_t depth)
+    : source(std::move(source)), depth(depth == 0 ? 1 : depth), done(false), stopping(false) {
+    worker = std::thread(&PrefetchReader::run, this);
+}
+
+inline PrefetchReader::~PrefetchReader() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+inline void PrefetchReader::run() {
+    try {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [this]() { return stopping || queue.size() < depth; });
+                if (stopping) return;
+            }
+
+            DataSet batch;
+            bool more = source->next(batch);
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (!more) break;
+            queue.push_back(std::move(batch));
+            changed.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(lock);
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+    changed.notify_all();
+}
+
+inline bool PrefetchReader::next(DataSet &batch) {
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this]() { return !queue.empty() || done; });
+
+    if (queue.empty()) {
+        if (error) std::rethrow_exception(error);
+        return false;
+    }
+
+    batch = std::move(queue.front());
+    queue.pop_front();
+    changed.notify_all();
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,321 @@
+// Native binary format for DataSets. Columns are stored in blocks of rows so the file can be streamed back a block at a time.
+// Files conventionally use the .dscb extension.
+//
+// Layout (native byte order):
+//   "DSCB" | u8 version | u8 sizeof(long double) | u16 reserved | u32 columns | u64 rows
+//   per column:     u8 flags (1 = categorical, 2 = masked) | u32 label length | label
+//   u64 terms, per term: long double code | u32 length | term
+//   per block:      u64 rows, then per column: u8 encoding | u64 payload bytes | payload
+// Each column chunk of each block picks its own encoding (see Compression.h).
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "BatchReader.h"
+#include "Compression.h"
+#include "../Container/DataSet.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Writes the DataSet, its labels, flags and dictionary. The columns of each block are compressed in parallel unless 'compress' is false
+inline void save_binary(const DataSet &ds, const std::string &path, std::size_t block_rows = BINARY_BLOCK_ROWS, bool compress = true);
+inline DataSet load_binary(const std::string &path);                                                            // Reads a whole file back into one DataSet
+
+// Hands out 'batch_rows' rows at a time, holding at most one block of the file in memory besides the batch. Columns of a block decode in parallel.
+// Every batch shares the file's dictionary, which is never modified after the header is read.
+class BinaryReader : public BatchReader {
+    private:
+        std::ifstream in;
+        std::vector<std::string> labels;
+        std::vector<std::uint8_t> flags;
+        std::shared_ptr<Bimap<long double, std::string>> dictionary;
+        std::uint64_t total;
+
+        std::vector<std::vector<long double>> block; // The decoded block the next batch starts in
+        std::size_t block_pos;
+        std::size_t batch_rows;
+
+        bool read_block(); // Decodes the next block of the file into 'block'. Returns false at the end of the file
+
+    public:
+        BinaryReader(const std::string &path, std::size_t batch_rows);
+
+        bool next(DataSet &batch) override;
+        std::size_t read_into(const std::vector<long double*> &dst); // Decodes every block not yet read straight into 'dst', one pointer per column, several blocks at a time in parallel. Returns the rows written
+
+        std::uint64_t total_rows() const { return total; }
+        const std::vector<std::string>& get_labels() const { return labels; }
+        bool is_categorical(std::size_t index) const { return flags.at(index) & 1; }
+        bool is_masked(std::size_t index) const { return flags.at(index) & 2; }
+        std::shared_ptr<Bimap<long double, std::string>> get_dictionary() const { return dictionary; }
+};
+
+/* Definitions */
+
+namespace binary_detail {
+    const std::uint8_t VERSION = 1;
+    const std::uint8_t FLAG_CATEGORICAL = 1;
+    const std::uint8_t FLAG_MASKED = 2;
+
+    template <typename T>
+    inline void put(std::ostream &out, T v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    template <typename T>
+    inline T get(std::istream &in) {
+        T v;
+        if (!in.read(reinterpret_cast<char*>(&v), sizeof(T))) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> BinaryReader -> Unexpected end of file!" << std::endl;
+            throw -1;
+        }
+        return v;
+    }
+
+    inline std::string get_string(std::istream &in) {
+        std::string s(get<std::uint32_t>(in), '\0');
+        in.read(&s[0], s.size());
+        return s;
+    }
+
+    struct Chunk {
+        std::uint8_t encoding;
+        std::string payload;
+        long double *dst;
+        std::size_t rows;
+    };
+
+    // Reads the encoding and payload of the next column chunk
+    inline void read_chunk(std::istream &in, Chunk &chunk) {
+        chunk.encoding = get<std::uint8_t>(in);
+        chunk.payload.resize(get<std::uint64_t>(in));
+
+        if (!in.read(&chunk.payload[0], chunk.payload.size())) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> BinaryReader -> Unexpected end of file!" << std::endl;
+            throw -1;
+        }
+    }
+
+    inline void decode_chunks(std::vector<Chunk> &chunks) {
+        parallel_for(0, chunks.size(), 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) {
+                decompress_block(chunks[i].encoding, chunks[i].payload.data(), chunks[i].payload.size(), chunks[i].dst, chunks[i].rows);
+            }
+        });
+    }
+}
+
+inline void save_binary(const DataSet &ds, const std::string &path, std::size_t block_rows, bool compress) {
+    using namespace binary_detail;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> save_binary() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+
+    if (block_rows == 0) block_rows = BINARY_BLOCK_ROWS;
+
+    out.write("DSCB", 4);
+    put<std::uint8_t>(out, VERSION);
+    put<std::uint8_t>(out, sizeof(long double));
+    put<std::uint16_t>(out, 0);
+    put<std::uint32_t>(out, ds.num_cols());
+    put<std::uint64_t>(out, ds.num_rows());
+
+    for (unsigned int c = 0; c < ds.num_cols(); c++) {
+        const Column &col = ds.get_col_ref(c);
+        std::string label = col.get_label();
+
+        put<std::uint8_t>(out, (col.is_categorical() ? FLAG_CATEGORICAL : 0) | (col.is_masked() ? FLAG_MASKED : 0));
+        put<std::uint32_t>(out, label.size());
+        out.write(label.data(), label.size());
+    }
+
+    const auto &terms = ds.get_map_ptr()->left();
+    put<std::uint64_t>(out, terms.size());
+    for (const auto &term : terms) {
+        put<long double>(out, term.first);
+        put<std::uint32_t>(out, term.second.size());
+        out.write(term.second.data(), term.second.size());
+    }
+
+    std::vector<std::string> payloads(ds.num_cols());
+    std::vector<std::uint8_t> encodings(ds.num_cols());
+
+    for (std::size_t r = 0; r < ds.num_rows(); r += block_rows) {
+        std::size_t rows = std::min<std::size_t>(block_rows, ds.num_rows() - r);
+        put<std::uint64_t>(out, rows);
+
+        parallel_for(0, ds.num_cols(), 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t c = lo; c < hi; c++) {
+                const long double *values = ds.get_col_ref(c).get_data().data() + r;
+                payloads[c].clear();
+
+                if (compress) {
+                    encodings[c] = compress_block(values, rows, payloads[c]);
+                } else {
+                    encodings[c] = ENCODING_RAW;
+                    payloads[c].assign(reinterpret_cast<const char*>(values), rows * sizeof(long double));
+                }
+            }
+        });
+
+        for (unsigned int c = 0; c < ds.num_cols(); c++) {
+            put<std::uint8_t>(out, encodings[c]);
+            put<std::uint64_t>(out, payloads[c].size());
+            out.write(payloads[c].data(), payloads[c].size());
+        }
+    }
+}
+
+inline DataSet load_binary(const std::string &path) {
+    BinaryReader reader(path, std::numeric_limits<std::size_t>::max());
+    DataSet ds;
+
+    if (!reader.next(ds)) {
+        for (const std::string &label : reader.get_labels()) ds.add_col(Column(std::vector<long double>(), label));
+    }
+
+    return ds;
+}
+
+inline BinaryReader::BinaryReader(const std::string &path, std::size_t batch_rows)
+    : in(path, std::ios::binary), block_pos(0), batch_rows(batch_rows == 0 ? 1 : batch_rows) {
+    using namespace binary_detail;
+
+    char magic[4];
+    if (!in || !in.read(magic, 4) || std::memcmp(magic, "DSCB", 4) != 0) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> BinaryReader() -> " << path << " is not a DSCpp binary file!" << std::endl;
+        throw -1;
+    }
+
+    std::uint8_t version = get<std::uint8_t>(in);
+    std::uint8_t width = get<std::uint8_t>(in);
+    get<std::uint16_t>(in);
+
+    if (version != VERSION || width != sizeof(long double)) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> BinaryReader() -> Unsupported version or long double size!" << std::endl;
+        throw -1;
+    }
+
+    std::uint32_t cols = get<std::uint32_t>(in);
+    total = get<std::uint64_t>(in);
+
+    for (std::uint32_t c = 0; c < cols; c++) {
+        flags.push_back(get<std::uint8_t>(in));
+        labels.push_back(get_string(in));
+    }
+
+    dictionary = std::make_shared<Bimap<long double, std::string>>();
+    std::uint64_t terms = get<std::uint64_t>(in);
+    for (std::uint64_t t = 0; t < terms; t++) {
+        long double code = get<long double>(in);
+        dictionary->set(code, get_string(in));
+    }
+}
+
+inline bool BinaryReader::read_block() {
+    using namespace binary_detail;
+
+    std::uint64_t rows;
+    if (!in.read(reinterpret_cast<char*>(&rows), sizeof(rows))) return false;
+
+    std::vector<Chunk> chunks(labels.size());
+    block.resize(labels.size());
+
+    for (std::size_t c = 0; c < labels.size(); c++) {
+        read_chunk(in, chunks[c]);
+        block[c].resize(rows);
+        chunks[c].dst = block[c].data();
+        chunks[c].rows = rows;
+    }
+
+    decode_chunks(chunks);
+
+    block_pos = 0;
+    return true;
+}
+
+inline std::size_t BinaryReader::read_into(const std::vector<long double*> &dst) {
+    using namespace binary_detail;
+
+    const std::size_t group = 2 * thread_count();
+    std::size_t pos = 0;
+    std::uint64_t rows;
+    std::vector<Chunk> chunks;
+    bool more = true;
+
+    // Reads are sequential; the chunks of up to 'group' blocks are then decoded together
+    while (more) {
+        chunks.clear();
+
+        for (std::size_t b = 0; b < group; b++) {
+            if (!in.read(reinterpret_cast<char*>(&rows), sizeof(rows))) { more = false; break; }
+
+            if (pos + rows > total) {
+                if (VERBOSE_ERRORS) std::cout << "[Error] -> BinaryReader -> Blocks hold more rows than the header!" << std::endl;
+                throw -1;
+            }
+
+            for (std::size_t c = 0; c < labels.size(); c++) {
+                chunks.emplace_back();
+                read_chunk(in, chunks.back());
+                chunks.back().dst = dst.at(c) + pos;
+                chunks.back().rows = rows;
+            }
+
+            pos += rows;
+        }
+
+        decode_chunks(chunks);
+    }
+
+    return pos;
+}
+
+inline bool BinaryReader::next(DataSet &batch) {
+    if (labels.empty()) return false;
+
+    std::vector<std::vector<long double>> cols(labels.size());
+    std::size_t rows = 0;
+
+    for (auto &col : cols) col.reserve(std::min<std::uint64_t>(batch_rows, total));
+
+    while (rows < batch_rows) {
+        if ((block.empty() || block_pos >= block.front().size()) && !read_block()) break;
+
+        std::size_t take = std::min(batch_rows - rows, block.front().size() - block_pos);
+        for (std::size_t c = 0; c < labels.size(); c++) {
+            cols[c].insert(cols[c].end(), block[c].begin() + block_pos, block[c].begin() + block_pos + take);
+        }
+
+        block_pos += take;
+        rows += take;
+    }
+
+    if (rows == 0) return false;
+
+    DataSet out;
+    out.set_map_ptr(dictionary);
+
+    for (std::size_t c = 0; c < labels.size(); c++) {
+        Column col(std::move(cols[c]), labels[c]);
+        col.set_masked(flags[c] & binary_detail::FLAG_MASKED);
+        if (flags[c] & binary_detail::FLAG_CATEGORICAL) col.set_map(dictionary);
+        out.add_col(std::move(col));
+    }
+
+    batch = std::move(out);
+    return true;
+}
+
+#endif
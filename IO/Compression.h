@@ -0,0 +1,480 @@
+// Lightweight encodings for blocks of long doubles, used by the binary format
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "../util/config.h"
+
+/* Declarations */
+
+const std::uint8_t ENCODING_RAW = 0;   // Native long doubles, back to back
+const std::uint8_t ENCODING_DELTA = 1; // Integers: first value, then bit-packed deltas above the smallest delta
+const std::uint8_t ENCODING_XOR = 2;   // Values that are exact doubles: Gorilla-style XOR against the previous value
+const std::uint8_t ENCODING_RLE = 3;   // Few distinct values: a dictionary, then runs of dictionary indices
+const std::uint8_t ENCODING_LZ = 4;    // Anything else: the raw bytes through an LZ77 byte codec
+
+// Appends the smallest of the encodings that apply to 'values' to 'out' and returns which one was used
+inline std::uint8_t compress_block(const long double *values, std::size_t n, std::string &out);
+
+// Decodes 'bytes' bytes written by compress_block into 'out', which has room for 'n' values. Throws on corrupt input
+inline void decompress_block(std::uint8_t encoding, const char *in, std::size_t bytes, long double *out, std::size_t n);
+
+// General purpose byte codec: literal runs and back-references into the last 64KiB, in the style of LZ4
+inline void lz_compress(const char *in, std::size_t n, std::string &out);
+inline void lz_decompress(const char *in, std::size_t bytes, char *out, std::size_t n);
+
+/* Definitions */
+
+namespace compression_detail {
+    const std::size_t RLE_MAX_DICT = 4096;
+    const std::size_t LZ_HASH_BITS = 12;
+
+    // Bytes of a long double that hold its value. x87 extended precision pads 10 bytes out to 12 or 16
+    const std::size_t VALUE_BYTES = std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(long double);
+
+    inline void fail() {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> decompress_block() -> Corrupt block!" << std::endl;
+        throw -1;
+    }
+
+    template <typename T>
+    inline void put(std::string &out, T v) { out.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    template <typename T>
+    inline T get(const char *&in, const char *end) {
+        if (end - in < (std::ptrdiff_t)sizeof(T)) fail();
+        T v;
+        std::memcpy(&v, in, sizeof(T));
+        in += sizeof(T);
+        return v;
+    }
+
+    inline void put_varint(std::string &out, std::uint64_t v) {
+        while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+        out.push_back((char)v);
+    }
+
+    inline std::uint64_t get_varint(const char *&in, const char *end) {
+        std::uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (in >= end) fail();
+            std::uint8_t b = *in++;
+            v |= (std::uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        fail();
+        return 0;
+    }
+
+    // Packs values least significant bit first
+    struct BitWriter {
+        std::string &out;
+        std::uint64_t acc = 0;
+        unsigned fill = 0;
+
+        BitWriter(std::string &out) : out(out) { }
+
+        void put(std::uint64_t v, unsigned bits) {
+            if (bits == 0) return;
+            if (bits < 64) v &= (1ULL << bits) - 1;
+
+            acc |= v << fill;
+            if (fill + bits >= 64) {
+                compression_detail::put<std::uint64_t>(out, acc);
+                acc = fill == 0 ? 0 : v >> (64 - fill);
+                fill = fill + bits - 64;
+            } else {
+                fill += bits;
+            }
+        }
+
+        void flush() {
+            for (unsigned b = 0; b < fill; b += 8) out.push_back((char)(acc >> b));
+            acc = 0;
+            fill = 0;
+        }
+    };
+
+    struct BitReader {
+        const unsigned char *p;
+        std::size_t len;
+        std::size_t pos = 0; // In bits
+
+        BitReader(const char *p, std::size_t len) : p(reinterpret_cast<const unsigned char*>(p)), len(len) { }
+
+        std::uint64_t get(unsigned bits) {
+            if (pos + bits > len * 8) fail();
+
+            std::uint64_t v = 0;
+            for (unsigned got = 0; got < bits;) {
+                unsigned off = pos & 7;
+                unsigned take = std::min(8 - off, bits - got);
+                v |= (std::uint64_t)((p[pos >> 3] >> off) & ((1u << take) - 1)) << got;
+                got += take;
+                pos += take;
+            }
+            return v;
+        }
+    };
+
+    inline unsigned width(std::uint64_t v) {
+        unsigned w = 0;
+        while (v) { w++; v >>= 1; }
+        return w;
+    }
+
+    inline unsigned leading_zeros(std::uint64_t v) { return 64 - width(v); }
+
+    inline unsigned trailing_zeros(std::uint64_t v) {
+        unsigned t = 0;
+        while (!(v & 1)) { t++; v >>= 1; }
+        return t;
+    }
+
+    inline std::uint64_t double_bits(long double v) {
+        double d = static_cast<double>(v);
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, 8);
+        return bits;
+    }
+
+    inline void encode_delta(const long double *values, std::size_t n, std::string &out) {
+        std::int64_t first = (std::int64_t)values[0], min_delta = 0;
+
+        for (std::size_t i = 1; i < n; i++) {
+            std::int64_t d = (std::int64_t)values[i] - (std::int64_t)values[i - 1];
+            if (i == 1 || d < min_delta) min_delta = d;
+        }
+
+        std::uint64_t max_offset = 0;
+        // Offsets are taken in unsigned arithmetic, where they cannot overflow
+        std::vector<std::uint64_t> offsets(n - 1);
+        for (std::size_t i = 1; i < n; i++) {
+            offsets[i - 1] = (std::uint64_t)((std::int64_t)values[i] - (std::int64_t)values[i - 1]) - (std::uint64_t)min_delta;
+            if (offsets[i - 1] > max_offset) max_offset = offsets[i - 1];
+        }
+
+        unsigned bits = width(max_offset);
+        put<std::int64_t>(out, first);
+        put<std::int64_t>(out, min_delta);
+        out.push_back((char)bits);
+
+        BitWriter w(out);
+        for (std::uint64_t off : offsets) w.put(off, bits);
+        w.flush();
+    }
+
+    inline void decode_delta(const char *in, const char *end, long double *out, std::size_t n) {
+        std::int64_t v = get<std::int64_t>(in, end);
+        std::int64_t min_delta = get<std::int64_t>(in, end);
+        unsigned bits = get<std::uint8_t>(in, end);
+        if (bits > 64) fail();
+
+        BitReader r(in, end - in);
+        out[0] = v;
+        for (std::size_t i = 1; i < n; i++) {
+            v = (std::int64_t)((std::uint64_t)v + (std::uint64_t)min_delta + r.get(bits));
+            out[i] = v;
+        }
+    }
+
+    inline void encode_xor(const long double *values, std::size_t n, std::string &out) {
+        BitWriter w(out);
+        std::uint64_t prev = double_bits(values[0]);
+        unsigned prev_lead = 65, prev_trail = 0; // No window yet
+
+        w.put(prev, 64);
+
+        for (std::size_t i = 1; i < n; i++) {
+            std::uint64_t cur = double_bits(values[i]);
+            std::uint64_t x = cur ^ prev;
+            prev = cur;
+
+            if (x == 0) {
+                w.put(0, 1);
+                continue;
+            }
+
+            unsigned lead = std::min(leading_zeros(x), 31u), trail = trailing_zeros(x);
+            w.put(1, 1);
+
+            if (prev_lead <= 64 && lead >= prev_lead && trail >= prev_trail) {
+                // The meaningful bits fit inside the previous window
+                w.put(0, 1);
+                w.put(x >> prev_trail, 64 - prev_lead - prev_trail);
+            } else {
+                unsigned sig = 64 - lead - trail;
+                w.put(1, 1);
+                w.put(lead, 5);
+                w.put(sig - 1, 6);
+                w.put(x >> trail, sig);
+                prev_lead = lead;
+                prev_trail = trail;
+            }
+        }
+
+        w.flush();
+    }
+
+    inline void decode_xor(const char *in, const char *end, long double *out, std::size_t n) {
+        BitReader r(in, end - in);
+        std::uint64_t prev = r.get(64);
+        unsigned lead = 0, trail = 0;
+        double d;
+
+        std::memcpy(&d, &prev, 8);
+        out[0] = d;
+
+        for (std::size_t i = 1; i < n; i++) {
+            if (r.get(1)) {
+                if (r.get(1)) {
+                    lead = r.get(5);
+                    unsigned sig = r.get(6) + 1;
+                    if (lead + sig > 64) fail();
+                    trail = 64 - lead - sig;
+                }
+                prev ^= r.get(64 - lead - trail) << trail;
+            }
+
+            std::memcpy(&d, &prev, 8);
+            out[i] = d;
+        }
+    }
+
+    // Returns false, leaving 'out' untouched, when there are too many distinct values for a dictionary
+    inline bool encode_rle(const long double *values, std::size_t n, std::string &out) {
+        std::unordered_map<long double, std::uint32_t> index;
+        std::vector<long double> dict;
+        std::vector<std::uint32_t> codes(n);
+        std::uint32_t nan_code = UINT32_MAX;
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (std::isnan(values[i])) {
+                if (nan_code == UINT32_MAX) { nan_code = dict.size(); dict.push_back(values[i]); }
+                codes[i] = nan_code;
+                continue;
+            }
+
+            auto it = index.find(values[i]);
+            if (it == index.end()) {
+                if (dict.size() >= RLE_MAX_DICT) return false;
+                it = index.emplace(values[i], dict.size()).first;
+                dict.push_back(values[i]);
+            }
+            codes[i] = it->second;
+        }
+
+        put_varint(out, dict.size());
+        for (long double v : dict) out.append(reinterpret_cast<const char*>(&v), VALUE_BYTES);
+
+        for (std::size_t i = 0; i < n;) {
+            std::size_t run = 1;
+            while (i + run < n && codes[i + run] == codes[i]) run++;
+
+            put_varint(out, codes[i]);
+            put_varint(out, run);
+            i += run;
+        }
+
+        return true;
+    }
+
+    inline void decode_rle(const char *in, const char *end, long double *out, std::size_t n) {
+        std::vector<long double> dict(get_varint(in, end));
+
+        for (long double &v : dict) {
+            if (end - in < (std::ptrdiff_t)VALUE_BYTES) fail();
+            v = 0;
+            std::memcpy(&v, in, VALUE_BYTES);
+            in += VALUE_BYTES;
+        }
+
+        for (std::size_t i = 0; i < n;) {
+            std::uint64_t code = get_varint(in, end), run = get_varint(in, end);
+            if (code >= dict.size() || run == 0 || run > n - i) fail();
+
+            for (std::uint64_t k = 0; k < run; k++) out[i++] = dict[code];
+        }
+    }
+
+    inline void put_length(std::string &out, std::size_t len) {
+        for (; len >= 255; len -= 255) out.push_back((char)255);
+        out.push_back((char)len);
+    }
+
+    inline std::size_t get_length(const char *&in, const char *end) {
+        std::size_t len = 0;
+        std::uint8_t b;
+        do {
+            if (in >= end) fail();
+            b = *in++;
+            len += b;
+        } while (b == 255);
+        return len;
+    }
+
+    // One sequence: 'literals' bytes copied as-is, then (unless 'match' is 0) a copy of 'match' bytes from 'offset' bytes back
+    inline void emit(std::string &out, const char *literals, std::size_t lit_len, std::size_t offset, std::size_t match) {
+        std::size_t m = match == 0 ? 0 : match - 4;
+        out.push_back((char)(((lit_len < 15 ? lit_len : 15) << 4) | (m < 15 ? m : 15)));
+
+        if (lit_len >= 15) put_length(out, lit_len - 15);
+        out.append(literals, lit_len);
+
+        if (match == 0) return;
+
+        put<std::uint16_t>(out, offset);
+        if (m >= 15) put_length(out, m - 15);
+    }
+}
+
+inline void lz_compress(const char *in, std::size_t n, std::string &out) {
+    using namespace compression_detail;
+
+    std::vector<std::size_t> table(1 << LZ_HASH_BITS, SIZE_MAX);
+    std::size_t anchor = 0, i = 0;
+
+    while (i + 4 <= n) {
+        std::uint32_t seq;
+        std::memcpy(&seq, in + i, 4);
+
+        std::uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        std::size_t cand = table[h];
+        table[h] = i;
+
+        if (cand != SIZE_MAX && i - cand <= 0xFFFF && std::memcmp(in + cand, in + i, 4) == 0) {
+            std::size_t len = 4;
+            while (i + len < n && in[cand + len] == in[i + len]) len++;
+
+            emit(out, in + anchor, i - anchor, i - cand, len);
+            i += len;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+
+    emit(out, in + anchor, n - anchor, 0, 0);
+}
+
+inline void lz_decompress(const char *in, std::size_t bytes, char *out, std::size_t n) {
+    using namespace compression_detail;
+
+    const char *end = in + bytes;
+    std::size_t op = 0;
+
+    while (op < n) {
+        if (in >= end) fail();
+        std::uint8_t token = *in++;
+
+        std::size_t lit = token >> 4;
+        if (lit == 15) lit += get_length(in, end);
+        if (lit > (std::size_t)(end - in) || lit > n - op) fail();
+
+        std::memcpy(out + op, in, lit);
+        in += lit;
+        op += lit;
+
+        if (op == n) break;
+
+        std::size_t offset = get<std::uint16_t>(in, end);
+        std::size_t match = (token & 15) + 4;
+        if ((token & 15) == 15) match += get_length(in, end);
+        if (offset == 0 || offset > op || match > n - op) fail();
+
+        // Byte by byte, since the source may overlap the bytes being written
+        for (std::size_t k = 0; k < match; k++, op++) out[op] = out[op - offset];
+    }
+}
+
+inline std::uint8_t compress_block(const long double *values, std::size_t n, std::string &out) {
+    using namespace compression_detail;
+
+    const std::size_t raw = n * sizeof(long double);
+    if (n == 0) return ENCODING_RAW;
+
+    // Deltas of integers below 2^62 cannot overflow. Negative zeros would come back positive from the integer and dictionary encodings
+    bool integral = true, exact_double = true, negative_zero = false;
+    for (std::size_t i = 0; i < n; i++) {
+        long double v = values[i];
+        if (integral && !(std::fabs(v) < 4611686018427387904.0L && v == std::trunc(v))) integral = false;
+        if (exact_double && !std::isnan(v) && static_cast<long double>(static_cast<double>(v)) != v) exact_double = false;
+        if (v == 0 && std::signbit(v)) negative_zero = true;
+    }
+
+    std::string best, candidate;
+    std::uint8_t best_encoding = ENCODING_RAW;
+
+    auto consider = [&](std::uint8_t encoding) {
+        if (best_encoding == ENCODING_RAW || candidate.size() < best.size()) {
+            best.swap(candidate);
+            best_encoding = encoding;
+        }
+        candidate.clear();
+    };
+
+    if (integral && !negative_zero) {
+        encode_delta(values, n, candidate);
+        consider(ENCODING_DELTA);
+    }
+    if (exact_double) {
+        encode_xor(values, n, candidate);
+        consider(ENCODING_XOR);
+    }
+    if (!negative_zero && encode_rle(values, n, candidate)) consider(ENCODING_RLE);
+
+    // The byte codec is the slowest, so it only runs when nothing specialised did well
+    if (best_encoding == ENCODING_RAW || best.size() > raw / 4) {
+        std::vector<char> bytes(n * VALUE_BYTES);
+        for (std::size_t i = 0; i < n; i++) std::memcpy(bytes.data() + i * VALUE_BYTES, values + i, VALUE_BYTES);
+
+        lz_compress(bytes.data(), bytes.size(), candidate);
+        consider(ENCODING_LZ);
+    }
+
+    if (best.size() >= raw) {
+        out.append(reinterpret_cast<const char*>(values), raw);
+        return ENCODING_RAW;
+    }
+
+    out += best;
+    return best_encoding;
+}
+
+inline void decompress_block(std::uint8_t encoding, const char *in, std::size_t bytes, long double *out, std::size_t n) {
+    using namespace compression_detail;
+
+    if (n == 0) return;
+
+    switch (encoding) {
+        case ENCODING_RAW:
+            if (bytes != n * sizeof(long double)) fail();
+            std::memcpy(out, in, bytes);
+            return;
+        case ENCODING_DELTA: decode_delta(in, in + bytes, out, n); return;
+        case ENCODING_XOR:   decode_xor(in, in + bytes, out, n);   return;
+        case ENCODING_RLE:   decode_rle(in, in + bytes, out, n);   return;
+        case ENCODING_LZ: {
+            std::vector<char> raw(n * VALUE_BYTES);
+            lz_decompress(in, bytes, raw.data(), raw.size());
+
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = 0;
+                std::memcpy(out + i, raw.data() + i * VALUE_BYTES, VALUE_BYTES);
+            }
+            return;
+        }
+    }
+
+    fail();
+}
+
+#endif
@@ -0,0 +1,210 @@
+// Streaming reader for delimited text files
+#ifndef CSV_H
+#define CSV_H
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "BatchReader.h"
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Reads 'batch_rows' lines at a time, so memory is bounded by the batch size rather than the file size. Empty fields become NaN.
+// The first batch fixes the schema: a column with a field that does not parse as a number is categorical, and every field of it,
+// numbers included, is encoded as a term through the batch's translation map. A later field that is not a number in a numeric
+// column throws, so every batch of a stream has the same schema. Quoted fields may contain the delimiter and doubled quotes,
+// but not line breaks.
+class CsvReader : public BatchReader {
+    private:
+        std::ifstream in;
+        std::vector<std::string> labels;
+        std::vector<bool> categorical; // Columns that held a string in the first batch
+        std::string pending;           // First data line, when it had to be read to count the columns
+        bool has_pending;
+        bool schema_fixed;             // Whether the first batch has been read
+        std::size_t batch_rows;
+        char delim;
+
+    public:
+        CsvReader(const std::string &path, std::size_t batch_rows, bool header = true, char delim = ',');
+
+        bool next(DataSet &batch) override;
+        const std::vector<std::string>& get_labels() const { return labels; }
+};
+
+inline DataSet load_csv(const std::string &path, bool header = true, char delim = ','); // Reads the whole file into one DataSet
+
+/* Definitions */
+
+namespace csv_detail {
+    // Splits one line into its fields
+    inline void split(const std::string &line, char delim, std::vector<std::string> &fields) {
+        fields.clear();
+        std::string field;
+        bool quoted = false;
+
+        for (std::size_t i = 0; i < line.size(); i++) {
+            char ch = line[i];
+
+            if (quoted) {
+                if (ch == '"' && i + 1 < line.size() && line[i + 1] == '"') { field.push_back('"'); i++; }
+                else if (ch == '"') quoted = false;
+                else field.push_back(ch);
+            } else if (ch == '"') {
+                quoted = true;
+            } else if (ch == delim) {
+                fields.push_back(field);
+                field.clear();
+            } else {
+                field.push_back(ch);
+            }
+        }
+
+        fields.push_back(field);
+    }
+
+    // Reads one field as a number into 'v', NaN when it is blank. Returns false if the field is not a number
+    inline bool to_number(const std::string &f, long double &v) {
+        std::size_t start = f.find_first_not_of(' ');
+        v = NAN;
+
+        if (start == std::string::npos) return true;
+
+        char *end = nullptr;
+        long double x = std::strtold(f.c_str() + start, &end);
+
+        if (end == f.c_str() + start || f.find_first_not_of(' ', end - f.c_str()) != std::string::npos) return false;
+
+        v = x;
+        return true;
+    }
+
+    // Reads one field of a categorical column. Any field that is not blank is a term, even one that looks like a number
+    inline long double to_term(const std::string &f, DataSet &terms) {
+        return f.find_first_not_of(' ') == std::string::npos ? NAN : terms.encode(f);
+    }
+
+    // Returns the value of one field. Fields that are not numbers are encoded through 'terms', and 'is_term' is set
+    inline long double parse(const std::string &f, DataSet &terms, bool &is_term) {
+        long double v;
+        is_term = !to_number(f, v);
+        return is_term ? terms.encode(f) : v;
+    }
+
+    // Calls 'fn(line)' for every non-blank line in [begin, end), without the line break
+    template <typename Function>
+    inline void for_each_line(const char *begin, const char *end, Function fn) {
+        while (begin < end) {
+            const char *nl = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            const char *stop = nl ? nl : end;
+            const char *last = (stop > begin && stop[-1] == '\r') ? stop - 1 : stop;
+
+            if (last > begin) fn(begin, last);
+            begin = nl ? nl + 1 : end;
+        }
+    }
+}
+
+inline CsvReader::CsvReader(const std::string &path, std::size_t batch_rows, bool header, char delim)
+    : in(path), has_pending(false), schema_fixed(false), batch_rows(batch_rows == 0 ? 1 : batch_rows), delim(delim) {
+    if (!in) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> CsvReader() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+
+    std::string line;
+    if (!std::getline(in, line)) return;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    csv_detail::split(line, delim, labels);
+
+    if (!header) {
+        pending = line;
+        has_pending = true;
+        for (std::size_t i = 0; i < labels.size(); i++) labels[i] = DEFAULT_LABEL + std::to_string(i);
+    }
+
+    categorical.assign(labels.size(), false);
+}
+
+inline bool CsvReader::next(DataSet &batch) {
+    std::vector<std::string> lines;
+    std::string line;
+
+    while (lines.size() < batch_rows) {
+        if (has_pending) {
+            line = pending;
+            has_pending = false;
+        } else if (!std::getline(in, line)) {
+            break;
+        }
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) lines.push_back(line);
+    }
+
+    if (lines.empty()) return false;
+
+    std::vector<std::string> fields;
+    auto split = [&](const std::string &l) {
+        csv_detail::split(l, delim, fields);
+        if (fields.size() != labels.size()) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> CsvReader::next() -> Expected " << labels.size() << " fields, found " << fields.size() << "!" << std::endl;
+            throw -1;
+        }
+    };
+
+    // The first batch fixes the schema: a column that holds a string anywhere in it is categorical in every batch
+    if (!schema_fixed) {
+        for (const std::string &l : lines) {
+            split(l);
+            for (std::size_t c = 0; c < fields.size(); c++) {
+                long double v;
+                if (!categorical[c] && !csv_detail::to_number(fields[c], v)) categorical[c] = true;
+            }
+        }
+        schema_fixed = true;
+    }
+
+    std::vector<std::vector<long double>> cols(labels.size(), std::vector<long double>(lines.size()));
+    DataSet out;
+
+    for (std::size_t r = 0; r < lines.size(); r++) {
+        split(lines[r]);
+
+        for (std::size_t c = 0; c < fields.size(); c++) {
+            if (categorical[c]) cols[c][r] = csv_detail::to_term(fields[c], out);
+            else if (!csv_detail::to_number(fields[c], cols[c][r])) {
+                if (VERBOSE_ERRORS) std::cout << "[Error] -> CsvReader::next() -> Column '" << labels[c] << "' was numeric in the first batch, but holds '" << fields[c] << "'!" << std::endl;
+                throw -1;
+            }
+        }
+    }
+
+    for (std::size_t c = 0; c < cols.size(); c++) {
+        Column col(std::move(cols[c]), labels[c]);
+        if (categorical[c]) col.set_map(out.get_map_ptr());
+        out.add_col(std::move(col));
+    }
+
+    batch = std::move(out);
+    return true;
+}
+
+inline DataSet load_csv(const std::string &path, bool header, char delim) {
+    CsvReader reader(path, std::numeric_limits<std::size_t>::max(), header, delim);
+    DataSet ds;
+
+    reader.next(ds);
+    return ds;
+}
+
+#endif
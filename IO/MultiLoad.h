@@ -0,0 +1,240 @@
+// Loading a set of partition files into one DataSet
+#ifndef MULTI_LOAD_H
+#define MULTI_LOAD_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Csv.h"
+#include "Npy.h"
+#include "Binary.h"
+#include "../Container/DataSet.h"
+#include "../util/MappedFile.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+inline std::vector<std::string> glob_files(const std::string &pattern); // Sorted paths matching '*' and '?' wildcards in the file name part of 'pattern'
+
+// Reads .csv, .npy and .dscb partitions in parallel into one DataSet, in the order given. Every partition must have the same columns.
+// Row counts are read from the headers (or counted, for CSV) first, so each file is decoded straight into its slice of the result.
+// The partitions' dictionaries are merged into the result's translation map, and only partitions whose codes collide are re-coded.
+inline DataSet load_files(const std::vector<std::string> &paths, bool header = true, char delim = ',');
+inline DataSet load_glob(const std::string &pattern, bool header = true, char delim = ',');
+
+/* Definitions */
+
+namespace multi_load_detail {
+    enum Format { CSV, NPY, BINARY };
+
+    struct Partition {
+        std::string path;
+        Format format;
+        std::size_t rows = 0;
+        std::size_t offset = 0;                 // First row of this partition in the result
+        std::vector<std::string> labels;
+        std::vector<bool> categorical;
+        std::vector<bool> masked;
+        DataSet terms;                          // Holds the map the partition's categorical values were coded with
+        std::unique_ptr<MappedFile> file;       // CSV and npy partitions stay mapped between probing and decoding
+        std::unique_ptr<BinaryReader> reader;   // Binary partitions keep their reader, positioned after the header
+        const char *body = nullptr;             // First CSV data line
+    };
+
+    inline bool wildcard(const char *p, const char *s) {
+        if (*p == '\0') return *s == '\0';
+        if (*p == '*') return wildcard(p + 1, s) || (*s != '\0' && wildcard(p, s + 1));
+        if (*s != '\0' && (*p == '?' || *p == *s)) return wildcard(p + 1, s + 1);
+        return false;
+    }
+
+    inline bool ends_with(const std::string &s, const std::string &suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Reads the partition's shape without decoding its values
+    inline void probe(Partition &p, bool header, char delim) {
+        if (ends_with(p.path, ".npy")) {
+            p.format = NPY;
+            p.file.reset(new MappedFile(p.path));
+
+            npy_detail::Header h = npy_detail::parse_header(p.file->data(), p.file->size());
+            p.rows = h.shape.empty() ? 1 : h.shape[0];
+            for (std::size_t c = 0; c < (h.shape.size() == 2 ? h.shape[1] : 1); c++) p.labels.push_back(DEFAULT_LABEL + std::to_string(c));
+        } else if (ends_with(p.path, ".dscb")) {
+            p.format = BINARY;
+            p.reader.reset(new BinaryReader(p.path, 1));
+            p.rows = p.reader->total_rows();
+            p.labels = p.reader->get_labels();
+            p.terms.set_map_ptr(p.reader->get_dictionary());
+
+            for (std::size_t c = 0; c < p.labels.size(); c++) {
+                p.categorical.push_back(p.reader->is_categorical(c));
+                p.masked.push_back(p.reader->is_masked(c));
+            }
+        } else if (ends_with(p.path, ".csv") || ends_with(p.path, ".tsv") || ends_with(p.path, ".txt")) {
+            p.format = CSV;
+            p.file.reset(new MappedFile(p.path));
+
+            const char *begin = p.file->data(), *end = begin + p.file->size();
+            bool first = true;
+
+            csv_detail::for_each_line(begin, end, [&](const char *lo, const char *hi) {
+                if (first) {
+                    csv_detail::split(std::string(lo, hi), delim, p.labels);
+                    if (!header) {
+                        for (std::size_t c = 0; c < p.labels.size(); c++) p.labels[c] = DEFAULT_LABEL + std::to_string(c);
+                        p.body = lo;
+                        p.rows++;
+                    }
+                    first = false;
+                    return;
+                }
+                if (p.body == nullptr) p.body = lo;
+                p.rows++;
+            });
+
+            if (p.body == nullptr) p.body = end;
+        } else {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> load_files() -> Unknown file type " << p.path << "!" << std::endl;
+            throw -1;
+        }
+
+        p.categorical.resize(p.labels.size(), false);
+        p.masked.resize(p.labels.size(), false);
+    }
+
+    // Decodes the partition into 'dst', one pointer per column already offset to the partition's first row
+    inline void decode(Partition &p, const std::vector<long double*> &dst, char delim) {
+        if (p.format == NPY) {
+            npy_detail::decode_into(p.file->data(), p.file->size(), dst);
+        } else if (p.format == BINARY) {
+            p.reader->read_into(dst);
+        } else {
+            std::vector<std::string> fields;
+            std::size_t row = 0;
+
+            csv_detail::for_each_line(p.body, p.file->data() + p.file->size(), [&](const char *lo, const char *hi) {
+                csv_detail::split(std::string(lo, hi), delim, fields);
+
+                if (fields.size() != dst.size()) {
+                    if (VERBOSE_ERRORS) std::cout << "[Error] -> load_files() -> Ragged row in " << p.path << "!" << std::endl;
+                    throw -1;
+                }
+
+                for (std::size_t c = 0; c < fields.size(); c++) {
+                    bool is_term;
+                    dst[c][row] = csv_detail::parse(fields[c], p.terms, is_term);
+                    if (is_term) p.categorical[c] = true;
+                }
+                row++;
+            });
+        }
+
+        p.file.reset();
+        p.reader.reset();
+    }
+}
+
+inline std::vector<std::string> glob_files(const std::string &pattern) {
+    namespace fs = std::filesystem;
+
+    fs::path pat(pattern);
+    fs::path dir = pat.has_parent_path() ? pat.parent_path() : fs::path(".");
+    std::string name = pat.filename().string();
+    std::vector<std::string> out;
+
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file() && multi_load_detail::wildcard(name.c_str(), entry.path().filename().string().c_str())) {
+            out.push_back(pat.has_parent_path() ? entry.path().string() : entry.path().filename().string());
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+inline DataSet load_files(const std::vector<std::string> &paths, bool header, char delim) {
+    using namespace multi_load_detail;
+
+    std::vector<Partition> parts(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++) parts[i].path = paths[i];
+
+    parallel_for(0, parts.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) probe(parts[i], header, delim);
+    });
+
+    DataSet out;
+    if (parts.empty()) return out;
+
+    std::size_t total = 0;
+    for (Partition &p : parts) {
+        if (p.labels != parts.front().labels) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> load_files() -> " << p.path << " does not have the same columns as " << parts.front().path << "!" << std::endl;
+            throw -1;
+        }
+        p.offset = total;
+        total += p.rows;
+    }
+
+    std::vector<std::vector<long double>> cols(parts.front().labels.size(), std::vector<long double>(total));
+
+    parallel_for(0, parts.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            std::vector<long double*> dst;
+            for (auto &col : cols) dst.push_back(col.data() + parts[i].offset);
+            decode(parts[i], dst, delim);
+        }
+    });
+
+    // Codes are derived from the term, so merging normally leaves every code as it is. Collisions resolved differently
+    // in two partitions are the only reason to touch the data again.
+    std::vector<std::unordered_map<long double, long double>> recode(parts.size());
+    for (std::size_t i = 0; i < parts.size(); i++) {
+        for (const auto &term : parts[i].terms.get_map_ptr()->left()) {
+            long double code = out.encode(term.second);
+            if (code != term.first) recode[i][term.first] = code;
+        }
+    }
+
+    parallel_for(0, parts.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            if (recode[i].empty()) continue;
+
+            for (std::size_t c = 0; c < cols.size(); c++) {
+                if (!parts[i].categorical[c]) continue;
+
+                for (std::size_t r = parts[i].offset; r < parts[i].offset + parts[i].rows; r++) {
+                    auto it = recode[i].find(cols[c][r]);
+                    if (it != recode[i].end()) cols[c][r] = it->second;
+                }
+            }
+        }
+    });
+
+    for (std::size_t c = 0; c < cols.size(); c++) {
+        Column col(std::move(cols[c]), parts.front().labels[c]);
+        bool categorical = false;
+
+        for (const Partition &p : parts) categorical = categorical || p.categorical[c];
+
+        col.set_masked(parts.front().masked[c]);
+        if (categorical) col.set_map(out.get_map_ptr());
+        out.add_col(std::move(col));
+    }
+
+    return out;
+}
+
+inline DataSet load_glob(const std::string &pattern, bool header, char delim) {
+    return load_files(glob_files(pattern), header, delim);
+}
+
+#endif
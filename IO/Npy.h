@@ -0,0 +1,297 @@
+// Reading and writing of NumPy .npy arrays and uncompressed .npz archives
+#ifndef NPY_H
+#define NPY_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+#include "Zip.h"
+#include "../Container/DataSet.h"
+#include "../util/MappedFile.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// 1-D arrays load as a single column, 2-D arrays as one column per array column. Fortran-order arrays are converted column by column
+// straight out of the mapped file; C-order arrays go through a tiled transpose that is split across threads.
+// Supported dtypes are bool, signed and unsigned integers, float32, float64 and the platform's long double.
+inline DataSet load_npy(const std::string &path);
+inline DataSet load_npz(const std::string &path); // Each member becomes one column per array column, labelled with its name (and index, for 2-D members)
+
+// Categorical columns are written as their codes. 'long_double' keeps the full precision of the data instead of writing float64,
+// which numpy reads back as np.longdouble on the same platform.
+inline void save_npy(const DataSet &ds, const std::string &path, bool long_double = false); // Writes a single 2-D Fortran-order array
+inline void save_npz(const DataSet &ds, const std::string &path, bool long_double = false); // Writes one 1-D member per column, named after its label
+
+/* Definitions */
+
+namespace npy_detail {
+    struct Header {
+        char kind;                      // 'f', 'i', 'u' or 'b'
+        std::size_t itemsize;
+        bool swap;                      // True if the data's byte order differs from the host's
+        bool fortran;
+        std::vector<std::size_t> shape;
+        std::size_t data_offset;        // Offset of the first element from the start of the buffer
+    };
+
+    inline bool host_little_endian() {
+        const std::uint16_t probe = 1;
+        return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    }
+
+    inline void fail(const std::string &msg) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> load_npy() -> " << msg << std::endl;
+        throw -1;
+    }
+
+    // Returns the text following "'key':" in the header dictionary
+    inline std::string field(const std::string &dict, const std::string &key) {
+        std::size_t pos = dict.find("'" + key + "'");
+        if (pos == std::string::npos) fail("Header is missing '" + key + "'!");
+
+        pos = dict.find(':', pos);
+        std::size_t start = dict.find_first_not_of(' ', pos + 1);
+        return dict.substr(start);
+    }
+
+    inline Header parse_header(const char *buf, std::size_t len) {
+        if (len < 10 || std::memcmp(buf, "\x93NUMPY", 6) != 0) fail("Not an npy file!");
+
+        unsigned int major = (unsigned char)buf[6];
+        std::size_t header_len, prefix;
+
+        if (major == 1) {
+            header_len = (unsigned char)buf[8] | ((unsigned char)buf[9] << 8);
+            prefix = 10;
+        } else {
+            if (len < 12) fail("Truncated header!");
+            header_len = zip_detail::read32(buf + 8);
+            prefix = 12;
+        }
+
+        if (prefix + header_len > len) fail("Truncated header!");
+
+        std::string dict(buf + prefix, header_len);
+        Header h;
+
+        std::string descr = field(dict, "descr");
+        if (descr.size() < 4 || descr[0] != '\'') fail("Structured dtypes are not supported!");
+        descr = descr.substr(1, descr.find('\'', 1) - 1);
+
+        char order = descr[0];
+        h.kind = descr[1];
+        h.itemsize = std::stoul(descr.substr(2));
+        h.swap = (order == '<' && !host_little_endian()) || (order == '>' && host_little_endian());
+
+        if (h.kind == '?') h.kind = 'b';
+        if (h.kind != 'f' && h.kind != 'i' && h.kind != 'u' && h.kind != 'b') fail("Unsupported dtype '" + descr + "'!");
+
+        h.fortran = field(dict, "fortran_order").compare(0, 4, "True") == 0;
+
+        std::string shape = field(dict, "shape");
+        shape = shape.substr(1, shape.find(')') - 1);
+        std::stringstream ss(shape);
+        std::string dim;
+        while (std::getline(ss, dim, ',')) {
+            if (dim.find_first_of("0123456789") != std::string::npos) h.shape.push_back(std::stoull(dim));
+        }
+
+        if (h.shape.size() > 2) fail("Arrays with more than two dimensions are not supported!");
+
+        std::size_t count = 1;
+        for (std::size_t d : h.shape) count *= d;
+
+        h.data_offset = prefix + header_len;
+        if (h.data_offset + count * h.itemsize > len) fail("File is shorter than its shape!");
+
+        return h;
+    }
+
+    template <typename T>
+    inline long double load(const char *p, bool swap) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, p, sizeof(T));
+        if (swap) std::reverse(bytes, bytes + sizeof(T));
+
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return static_cast<long double>(value);
+    }
+
+    // Fills 'cols', one pointer per array column with room for every row, from an array of T
+    template <typename T>
+    inline void decode_typed(const char *base, const Header &h, const std::vector<long double*> &cols) {
+        const std::size_t rows = h.shape.empty() ? 1 : h.shape[0];
+        const std::size_t width = cols.size();
+        const std::size_t sz = sizeof(T);
+
+        if (h.fortran || width == 1) {
+            parallel_for(0, width, 1, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t c = lo; c < hi; c++) {
+                    const char *src = base + c * rows * sz;
+                    long double *dst = cols[c];
+
+                    if (std::is_same<T, long double>::value && !h.swap) {
+                        std::memcpy(dst, src, rows * sz);
+                    } else {
+                        for (std::size_t r = 0; r < rows; r++) dst[r] = load<T>(src + r * sz, h.swap);
+                    }
+                }
+            });
+            return;
+        }
+
+        // C order: each thread owns a range of column tiles and walks the rows tile by tile, so both the reads and the writes stay in cache
+        const std::size_t tiles = (width + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+        parallel_for(0, tiles, 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t t = lo; t < hi; t++) {
+                std::size_t c0 = t * TRANSPOSE_BLOCK, c1 = std::min(width, c0 + TRANSPOSE_BLOCK);
+
+                for (std::size_t r0 = 0; r0 < rows; r0 += TRANSPOSE_BLOCK) {
+                    std::size_t r1 = std::min(rows, r0 + TRANSPOSE_BLOCK);
+
+                    for (std::size_t r = r0; r < r1; r++) {
+                        const char *src = base + (r * width) * sz;
+                        for (std::size_t c = c0; c < c1; c++) cols[c][r] = load<T>(src + c * sz, h.swap);
+                    }
+                }
+            }
+        });
+    }
+
+    // Decodes the array in 'buf' straight into 'cols', which must match the header's shape
+    inline void decode_into(const char *buf, std::size_t len, const std::vector<long double*> &cols) {
+        Header h = parse_header(buf, len);
+        const char *base = buf + h.data_offset;
+
+        if (cols.size() != (h.shape.size() == 2 ? h.shape[1] : 1)) fail("Destination does not match the array's shape!");
+
+        if (h.kind == 'f' && h.itemsize == 4) decode_typed<float>(base, h, cols);
+        else if (h.kind == 'f' && h.itemsize == 8) decode_typed<double>(base, h, cols);
+        else if (h.kind == 'f' && h.itemsize == sizeof(long double)) decode_typed<long double>(base, h, cols);
+        else if (h.kind == 'i' && h.itemsize == 1) decode_typed<std::int8_t>(base, h, cols);
+        else if (h.kind == 'i' && h.itemsize == 2) decode_typed<std::int16_t>(base, h, cols);
+        else if (h.kind == 'i' && h.itemsize == 4) decode_typed<std::int32_t>(base, h, cols);
+        else if (h.kind == 'i' && h.itemsize == 8) decode_typed<std::int64_t>(base, h, cols);
+        else if ((h.kind == 'u' || h.kind == 'b') && h.itemsize == 1) decode_typed<std::uint8_t>(base, h, cols);
+        else if (h.kind == 'u' && h.itemsize == 2) decode_typed<std::uint16_t>(base, h, cols);
+        else if (h.kind == 'u' && h.itemsize == 4) decode_typed<std::uint32_t>(base, h, cols);
+        else if (h.kind == 'u' && h.itemsize == 8) decode_typed<std::uint64_t>(base, h, cols);
+        else fail("Unsupported item size " + std::to_string(h.itemsize) + "!");
+    }
+
+    inline std::vector<std::vector<long double>> decode(const char *buf, std::size_t len) {
+        Header h = parse_header(buf, len);
+
+        std::size_t rows = h.shape.empty() ? 1 : h.shape[0];
+        std::size_t width = h.shape.size() == 2 ? h.shape[1] : 1;
+        std::vector<std::vector<long double>> cols(width, std::vector<long double>(rows));
+        std::vector<long double*> dst;
+
+        for (auto &col : cols) dst.push_back(col.data());
+        decode_into(buf, len, dst);
+
+        return cols;
+    }
+
+    // Writes the columns as one array. A single column is written 1-D, anything else as a 2-D Fortran-order array
+    inline void encode(std::ostream &out, const std::vector<const std::vector<long double>*> &cols, bool long_double) {
+        std::size_t rows = cols.empty() ? 0 : cols.front()->size();
+        std::string descr = std::string(host_little_endian() ? "<" : ">") + "f" + std::to_string(long_double ? sizeof(long double) : sizeof(double));
+        std::string shape = cols.size() == 1 ? "(" + std::to_string(rows) + ",)" : "(" + std::to_string(rows) + ", " + std::to_string(cols.size()) + ")";
+        std::string dict = "{'descr': '" + descr + "', 'fortran_order': True, 'shape': " + shape + ", }";
+
+        // The data has to start on a 64 byte boundary, and the header ends with a newline
+        std::size_t total = 10 + dict.size() + 1;
+        dict.append((64 - total % 64) % 64, ' ');
+        dict.push_back('\n');
+
+        out.write("\x93NUMPY\x01\x00", 8);
+        out.put(dict.size() & 0xFF);
+        out.put(dict.size() >> 8);
+        out.write(dict.data(), dict.size());
+
+        for (const auto *col : cols) {
+            if (long_double) {
+                out.write(reinterpret_cast<const char*>(col->data()), col->size() * sizeof(long double));
+                continue;
+            }
+
+            double chunk[4096];
+            for (std::size_t r = 0; r < col->size(); r += 4096) {
+                std::size_t n = std::min<std::size_t>(4096, col->size() - r);
+                for (std::size_t i = 0; i < n; i++) chunk[i] = static_cast<double>((*col)[r + i]);
+                out.write(reinterpret_cast<const char*>(chunk), n * sizeof(double));
+            }
+        }
+    }
+}
+
+inline DataSet load_npy(const std::string &path) {
+    MappedFile file(path);
+    auto cols = npy_detail::decode(file.data(), file.size());
+
+    DataSet ds;
+    for (std::size_t c = 0; c < cols.size(); c++) {
+        ds.add_col(Column(std::move(cols[c]), DEFAULT_LABEL + std::to_string(c)));
+    }
+
+    return ds;
+}
+
+inline DataSet load_npz(const std::string &path) {
+    MappedFile file(path);
+    DataSet ds;
+
+    for (const ZipEntry &entry : zip_entries(file.data(), file.size())) {
+        std::string name = entry.name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0) name.resize(name.size() - 4);
+
+        auto cols = npy_detail::decode(file.data() + entry.offset, entry.size);
+
+        for (std::size_t c = 0; c < cols.size(); c++) {
+            ds.add_col(Column(std::move(cols[c]), cols.size() == 1 ? name : name + "_" + std::to_string(c)));
+        }
+    }
+
+    return ds;
+}
+
+inline void save_npy(const DataSet &ds, const std::string &path, bool long_double) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> save_npy() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+
+    std::vector<const std::vector<long double>*> cols;
+    for (unsigned int c = 0; c < ds.num_cols(); c++) cols.push_back(&ds.get_col_ref(c).get_data());
+
+    npy_detail::encode(out, cols, long_double);
+}
+
+inline void save_npz(const DataSet &ds, const std::string &path, bool long_double) {
+    ZipWriter zip(path);
+
+    for (unsigned int c = 0; c < ds.num_cols(); c++) {
+        std::ostringstream member;
+        npy_detail::encode(member, { &ds.get_col_ref(c).get_data() }, long_double);
+        zip.add(ds.get_col_ref(c).get_label() + ".npy", member.str());
+    }
+
+    zip.close();
+}
+
+#endif
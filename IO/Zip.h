@@ -0,0 +1,221 @@
+// Minimal reader and writer for uncompressed (stored) zip archives, as produced by numpy.savez
+#ifndef ZIP_H
+#define ZIP_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+#include "../util/config.h"
+
+/* Declarations */
+
+// Location of one member inside an in-memory archive
+struct ZipEntry {
+    std::string name;
+    std::size_t offset; // Offset of the member's data from the start of the archive
+    std::size_t size;   // Size of the member's data in bytes
+};
+
+inline std::uint32_t crc32(const char *data, std::size_t n, std::uint32_t crc = 0); // Standard CRC-32 (IEEE 802.3) of 'n' bytes
+inline std::vector<ZipEntry> zip_entries(const char *buf, std::size_t len);         // Lists the members of an archive. Throws on compressed members
+
+class ZipWriter {
+    private:
+        std::ofstream out;
+        std::string central;   // Central directory records, written out on close()
+        std::uint16_t count;
+        bool closed;
+
+    public:
+        ZipWriter(const std::string &path); // Opens 'path' for writing, truncating it
+        ~ZipWriter();
+
+        void add(const std::string &name, const std::string &bytes); // Appends a stored member
+        void close();                                                 // Writes the central directory. Called by the destructor if needed
+};
+
+/* Definitions */
+
+namespace zip_detail {
+    inline std::uint16_t read16(const char *p) { return (std::uint8_t)p[0] | ((std::uint8_t)p[1] << 8); }
+    inline std::uint32_t read32(const char *p) { return read16(p) | ((std::uint32_t)read16(p + 2) << 16); }
+    inline std::uint64_t read64(const char *p) { return read32(p) | ((std::uint64_t)read32(p + 4) << 32); }
+
+    inline void write16(std::string &s, std::uint16_t v) { s.push_back(v & 0xFF); s.push_back(v >> 8); }
+    inline void write32(std::string &s, std::uint32_t v) { write16(s, v & 0xFFFF); write16(s, v >> 16); }
+}
+
+inline std::uint32_t crc32(const char *data, std::size_t n, std::uint32_t crc) {
+    // A function-local static is built once, even when several threads get here first
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t;
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; i++) crc = table[(crc ^ (std::uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline std::vector<ZipEntry> zip_entries(const char *buf, std::size_t len) {
+    using namespace zip_detail;
+
+    // The end of central directory record sits in the last 22 bytes, plus an optional comment of up to 64KiB
+    std::size_t eocd = len;
+    if (len >= 22) {
+        std::size_t lowest = len > 22 + 0xFFFF ? len - 22 - 0xFFFF : 0;
+        for (std::size_t i = len - 21; i-- > lowest;) {
+            if (read32(buf + i) == 0x06054b50) { eocd = i; break; }
+        }
+    }
+
+    if (eocd == len) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> zip_entries() -> Not a zip archive!" << std::endl;
+        throw -1;
+    }
+
+    std::size_t entries = read16(buf + eocd + 10);
+    std::size_t pos = read32(buf + eocd + 16);
+    std::vector<ZipEntry> out;
+
+    // Every field is bounds checked before it is read, so a truncated or corrupt archive throws instead of reading past 'buf'
+    auto corrupt = []() {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> zip_entries() -> Corrupt central directory!" << std::endl;
+        throw -1;
+    };
+
+    for (std::size_t e = 0; e < entries; e++) {
+        if (pos + 46 > len || read32(buf + pos) != 0x02014b50) corrupt();
+
+        std::uint16_t method = read16(buf + pos + 10);
+        std::uint64_t size = read32(buf + pos + 20);
+        std::uint16_t name_len = read16(buf + pos + 28);
+        std::uint16_t extra_len = read16(buf + pos + 30);
+        std::uint16_t comment_len = read16(buf + pos + 32);
+        std::uint64_t local = read32(buf + pos + 42);
+
+        if (pos + 46 + name_len + extra_len > len) corrupt();
+
+        // Zip64 members keep their real sizes and offset in an extra field
+        const char *extra = buf + pos + 46 + name_len;
+        for (std::size_t x = 0; x + 4 <= extra_len;) {
+            std::uint16_t id = read16(extra + x), sz = read16(extra + x + 2);
+            if (x + 4 + sz > extra_len) corrupt();
+
+            if (id == 0x0001) {
+                const char *f = extra + x + 4, *end = f + sz;
+                if (read32(buf + pos + 24) == 0xFFFFFFFF) f += 8;                                // Uncompressed size
+                if (size == 0xFFFFFFFF) { if (f + 8 > end) corrupt(); size = read64(f); f += 8; } // Compressed size
+                if (local == 0xFFFFFFFF) { if (f + 8 > end) corrupt(); local = read64(f); }
+            }
+            x += 4 + sz;
+        }
+
+        if (local > len || len - local < 30) corrupt();
+
+        if (method != 0) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> zip_entries() -> Compressed members are not supported!" << std::endl;
+            throw -1;
+        }
+
+        ZipEntry entry;
+        entry.name = std::string(buf + pos + 46, name_len);
+        entry.offset = local + 30 + read16(buf + local + 26) + read16(buf + local + 28);
+        entry.size = size;
+
+        if (entry.offset + entry.size > len) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> zip_entries() -> Member runs past the end of the archive!" << std::endl;
+            throw -1;
+        }
+
+        out.push_back(entry);
+        pos += 46 + name_len + extra_len + comment_len;
+    }
+
+    return out;
+}
+
+inline ZipWriter::ZipWriter(const std::string &path) : out(path, std::ios::binary | std::ios::trunc), count(0), closed(false) {
+    if (!out) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> ZipWriter() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+}
+
+inline ZipWriter::~ZipWriter() {
+    if (!closed) close();
+}
+
+inline void ZipWriter::add(const std::string &name, const std::string &bytes) {
+    using namespace zip_detail;
+
+    std::uint64_t offset = out.tellp();
+    if (offset + bytes.size() >= 0xFFFFFFFF) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> ZipWriter::add() -> Archives over 4GiB are not supported!" << std::endl;
+        throw -1;
+    }
+
+    std::uint32_t crc = crc32(bytes.data(), bytes.size());
+    std::string header;
+
+    write32(header, 0x04034b50);
+    write16(header, 20);        // Version needed
+    write16(header, 0);         // Flags
+    write16(header, 0);         // Stored
+    write16(header, 0);         // Time
+    write16(header, 0x21);      // Date: 1980-01-01
+    write32(header, crc);
+    write32(header, bytes.size());
+    write32(header, bytes.size());
+    write16(header, name.size());
+    write16(header, 0);
+    header += name;
+
+    out.write(header.data(), header.size());
+    out.write(bytes.data(), bytes.size());
+
+    write32(central, 0x02014b50);
+    write16(central, 20);       // Version made by
+    central.append(header, 4, 26);
+    write16(central, 0);        // Comment length
+    write16(central, 0);        // Disk number
+    write16(central, 0);        // Internal attributes
+    write32(central, 0);        // External attributes
+    write32(central, offset);
+    central += name;
+
+    count++;
+}
+
+inline void ZipWriter::close() {
+    using namespace zip_detail;
+
+    std::uint32_t offset = out.tellp();
+    std::string eocd;
+
+    write32(eocd, 0x06054b50);
+    write16(eocd, 0);
+    write16(eocd, 0);
+    write16(eocd, count);
+    write16(eocd, count);
+    write32(eocd, central.size());
+    write32(eocd, offset);
+    write16(eocd, 0);
+
+    out.write(central.data(), central.size());
+    out.write(eocd.data(), eocd.size());
+    out.close();
+    closed = true;
+}
+
+#endif
@@ -0,0 +1,145 @@
+// Runs optimized query plans. Filters and projections stacked on one input form a pipeline that runs morsel by morsel:
+// the input is cut into blocks of MORSEL_ROWS rows, and a worker takes a morsel through every predicate and then copies its
+// surviving rows into a buffer of the morsel's own before it moves on, so the morsel is read while it is still in cache. Once
+// every morsel is done, the buffers are stitched into the output in parallel. Workers take the next morsel as they finish the
+// last (see parallel_for_each()), so a thread held up by a slow morsel simply takes fewer of them.
+// Grouping, joins and sorts end a pipeline and run on their own parallel kernels.
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Plan.h"
+#include "../Algorithm/Predicate.h"
+#include "../Container/DataSet.h"
+#include "../util/Parallel.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Copies out the columns labelled 'labels' for the rows of 'in' that pass every predicate, morsel by morsel
+DataSet run_pipeline(const DataSet &in, const std::vector<Predicate> &conjuncts, const std::vector<std::string> &labels);
+
+DataSet execute_plan(const PlanNode &node); // Runs a plan as given, without optimizing it
+
+/* Definitions */
+
+namespace executor_detail {
+    inline DataSet first_rows(const DataSet &ds, std::size_t n) {
+        std::vector<unsigned int> rows(std::min<std::size_t>(n, ds.num_rows()));
+        for (std::size_t i = 0; i < rows.size(); i++) rows[i] = i;
+        return ds.take(rows);
+    }
+}
+
+inline DataSet run_pipeline(const DataSet &in, const std::vector<Predicate> &conjuncts, const std::vector<std::string> &labels) {
+    if (conjuncts.empty()) return in.select(labels);
+
+    const std::size_t n = in.num_rows();
+    const std::size_t morsels = (n + MORSEL_ROWS - 1) / MORSEL_ROWS;
+
+    std::vector<const long double*> src;
+    for (const std::string &label : labels) src.push_back(in[label].get_data().data());
+
+    // Surviving rows of each morsel, one column after another. Later predicates only run on morsels that still have rows
+    std::vector<std::vector<long double>> buffers(morsels);
+    std::vector<std::size_t> counts(morsels);
+
+    parallel_for_each(0, morsels, [&](std::size_t m) {
+        std::size_t lo = m * MORSEL_ROWS, hi = std::min(n, lo + MORSEL_ROWS);
+        Bitmask mask = conjuncts[0].evaluate(in, lo, hi);
+
+        for (std::size_t i = 1; i < conjuncts.size() && mask.count() > 0; i++) mask = mask & conjuncts[i].evaluate(in, lo, hi);
+
+        std::vector<unsigned int> rows = mask.to_selection();
+        for (unsigned int &row : rows) row += lo;
+
+        counts[m] = rows.size();
+        buffers[m].resize(rows.size() * src.size());
+
+        std::vector<long double*> slice(src.size());
+        for (std::size_t c = 0; c < src.size(); c++) slice[c] = buffers[m].data() + c * rows.size();
+        gather(src, rows.data(), rows.size(), slice);
+    });
+
+    std::vector<std::size_t> offsets(morsels + 1, 0);
+    for (std::size_t m = 0; m < morsels; m++) offsets[m + 1] = offsets[m] + counts[m];
+
+    DataSet out;
+    out.set_map_ptr(in.get_map_ptr());
+
+    for (const std::string &label : labels) {
+        const Column &col = in[label];
+
+        Column c(std::vector<long double>(offsets.back()), label);
+        c.set_masked(col.is_masked());
+        if (col.is_categorical()) c.set_map(col.get_map_ptr());
+        out.add_col(std::move(c));
+    }
+
+    std::vector<long double*> dst(labels.size());
+    for (std::size_t c = 0; c < dst.size(); c++) dst[c] = out.at(c).data();
+
+    // Each morsel's buffer is copied into its own slice of the output, and freed
+    parallel_for_each(0, morsels, [&](std::size_t m) {
+        for (std::size_t c = 0; c < dst.size(); c++) {
+            const long double *from = buffers[m].data() + c * counts[m];
+            std::copy(from, from + counts[m], dst[c] + offsets[m]);
+        }
+        std::vector<long double>().swap(buffers[m]);
+    });
+
+    return out;
+}
+
+inline DataSet execute_plan(const PlanNode &node) {
+    switch (node.kind) {
+        case PlanKind::SCAN:
+        case PlanKind::FILTER:
+        case PlanKind::PROJECT: {
+            // Gathers the pipeline: the topmost projection names the output, and the deepest predicates run first
+            std::vector<std::vector<Predicate>> stages;
+            const std::vector<std::string> *labels = nullptr;
+            const PlanNode *base = &node;
+
+            for (; base->kind == PlanKind::FILTER || base->kind == PlanKind::PROJECT; base = base->inputs[0].get()) {
+                if (base->kind == PlanKind::FILTER) stages.push_back(base->conjuncts);
+                else if (!labels) labels = &base->labels;
+            }
+
+            std::vector<Predicate> conjuncts;
+            if (base->kind == PlanKind::SCAN) conjuncts = base->conjuncts;
+            for (auto it = stages.rbegin(); it != stages.rend(); ++it) conjuncts.insert(conjuncts.end(), it->begin(), it->end());
+
+            // A scan reads the source in place, so filter columns are never copied
+            if (base->kind == PlanKind::SCAN) return run_pipeline(*base->source, conjuncts, labels ? *labels : base->labels);
+
+            DataSet in = execute_plan(*base);
+            if (labels) return run_pipeline(in, conjuncts, *labels);
+            return conjuncts.empty() ? in : run_pipeline(in, conjuncts, plan_detail::labels_of(plan_schema(*base)));
+        }
+        case PlanKind::AGGREGATE: {
+            DataSet in = execute_plan(*node.inputs[0]);
+            return in.group_by(node.labels).agg(node.aggs);
+        }
+        case PlanKind::JOIN: return execute_plan(*node.inputs[0]).join(execute_plan(*node.inputs[1]), node.labels, node.how);
+        case PlanKind::SORT: return execute_plan(*node.inputs[0]).sort_by(node.labels, node.ascending);
+        case PlanKind::LIMIT: return executor_detail::first_rows(execute_plan(*node.inputs[0]), node.limit);
+        case PlanKind::TOP_K: {
+            DataSet in = execute_plan(*node.inputs[0]);
+            bool ascending = node.ascending.empty() || node.ascending[0];
+
+            // top_k() leaves nulls out, where sorting places them last, so a short answer falls back to the sort
+            DataSet out = in.top_k(node.labels[0], node.limit, !ascending);
+            if (out.num_rows() == std::min<std::size_t>(node.limit, in.num_rows())) return out;
+
+            return executor_detail::first_rows(in.sort_by(node.labels, node.ascending), node.limit);
+        }
+    }
+
+    return DataSet();
+}
+
+#endif
@@ -0,0 +1,157 @@
+// Lazy arithmetic over columns. Operators on Columns build an expression whose type records the whole computation, and nothing
+// is computed until the expression becomes a Column. The rows are then evaluated in one fused loop, with no intermediate columns.
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+// Base of every expression node. 'E' provides size() and value(row)
+template <typename E>
+struct Expression {
+    typedef void is_column_expression; // Lets Column accept any expression without depending on this header
+
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// Leaf reading a Column. Only holds a pointer, so the Column must outlive the expression and keep its size
+struct ColumnTerm : Expression<ColumnTerm> {
+    const long double *v;
+    std::size_t n;
+
+    std::size_t size() const { return n; }
+    long double value(std::size_t i) const { return v[i]; }
+};
+
+// Leaf repeating one value. Its size is left open and taken from the other operand
+struct ScalarTerm : Expression<ScalarTerm> {
+    static const std::size_t ANY = (std::size_t)-1;
+    long double x;
+
+    std::size_t size() const { return ANY; }
+    long double value(std::size_t) const { return x; }
+};
+
+template <typename Op, typename A>
+struct UnaryExpr : Expression<UnaryExpr<Op, A>> {
+    A a;
+
+    UnaryExpr(const A &a) : a(a) { }
+    std::size_t size() const { return a.size(); }
+    long double value(std::size_t i) const { return Op::apply(a.value(i)); }
+};
+
+template <typename Op, typename A, typename B>
+struct BinaryExpr : Expression<BinaryExpr<Op, A, B>> {
+    A a;
+    B b;
+
+    BinaryExpr(const A &a, const B &b);
+    std::size_t size() const { return a.size() == ScalarTerm::ANY ? b.size() : a.size(); }
+    long double value(std::size_t i) const { return Op::apply(a.value(i), b.value(i)); }
+};
+
+// Operators: binary + - * / and unary -. Functions: pow, fmin and fmax of two operands (fmin and fmax return the other value
+// when one is NaN, like std::fmin), and abs, sqrt, exp and log of one. They accept Columns, expressions and numbers, as long as
+// one operand is not a number. NaN propagates through everything else, so missing values stay missing. The names are those of
+// the <cmath> functions, whose overloads only take numbers, so they still resolve here under 'using namespace std'; std::min
+// and std::max take any type and would win, which is why there is no min or max.
+//   Column c = ds["price"] * ds["qty"] - 0.5 * abs(ds["fee"]);
+
+/* Definitions */
+
+namespace expression_detail {
+    template <typename T>
+    struct is_node : std::is_base_of<Expression<T>, T> { };
+
+    template <typename T>
+    struct is_operand : std::integral_constant<bool, std::is_same<T, Column>::value || is_node<T>::value || std::is_arithmetic<T>::value> { };
+
+    // Operators only take part in overload resolution when both operands qualify and at least one is not a number
+    template <typename A, typename B>
+    using enable_binary = typename std::enable_if<is_operand<A>::value && is_operand<B>::value && !(std::is_arithmetic<A>::value && std::is_arithmetic<B>::value)>::type;
+
+    template <typename A>
+    using enable_unary = typename std::enable_if<std::is_same<A, Column>::value || is_node<A>::value>::type;
+
+    inline ColumnTerm term(const Column &c) { ColumnTerm t; t.v = c.get_data().data(); t.n = c.size(); return t; }
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    inline ScalarTerm term(T x) { ScalarTerm t; t.x = x; return t; }
+    template <typename E>
+    inline const E& term(const Expression<E> &e) { return e.self(); }
+
+    template <typename T>
+    using term_t = typename std::decay<decltype(term(std::declval<const T&>()))>::type;
+
+    template <typename Op, typename A, typename B>
+    inline BinaryExpr<Op, term_t<A>, term_t<B>> binary(const A &a, const B &b) { return BinaryExpr<Op, term_t<A>, term_t<B>>(term(a), term(b)); }
+
+    template <typename Op, typename A>
+    inline UnaryExpr<Op, term_t<A>> unary(const A &a) { return UnaryExpr<Op, term_t<A>>(term(a)); }
+
+    struct Add { static long double apply(long double a, long double b) { return a + b; } };
+    struct Sub { static long double apply(long double a, long double b) { return a - b; } };
+    struct Mul { static long double apply(long double a, long double b) { return a * b; } };
+    struct Div { static long double apply(long double a, long double b) { return a / b; } };
+    struct Pow { static long double apply(long double a, long double b) { return std::pow(a, b); } };
+    struct Min { static long double apply(long double a, long double b) { return std::fmin(a, b); } };
+    struct Max { static long double apply(long double a, long double b) { return std::fmax(a, b); } };
+    struct Neg { static long double apply(long double a) { return -a; } };
+    struct Abs { static long double apply(long double a) { return std::fabs(a); } };
+    struct Sqrt { static long double apply(long double a) { return std::sqrt(a); } };
+    struct Exp { static long double apply(long double a) { return std::exp(a); } };
+    struct Log { static long double apply(long double a) { return std::log(a); } };
+}
+
+template <typename Op, typename A, typename B>
+BinaryExpr<Op, A, B>::BinaryExpr(const A &a, const B &b) : a(a), b(b) {
+    if (a.size() != ScalarTerm::ANY && b.size() != ScalarTerm::ANY && a.size() != b.size()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> Expression -> Column lengths do not match!" << std::endl;
+        throw -1;
+    }
+}
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto operator+(const A &a, const B &b) { return expression_detail::binary<expression_detail::Add>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto operator-(const A &a, const B &b) { return expression_detail::binary<expression_detail::Sub>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto operator*(const A &a, const B &b) { return expression_detail::binary<expression_detail::Mul>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto operator/(const A &a, const B &b) { return expression_detail::binary<expression_detail::Div>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto pow(const A &a, const B &b) { return expression_detail::binary<expression_detail::Pow>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto fmin(const A &a, const B &b) { return expression_detail::binary<expression_detail::Min>(a, b); }
+
+template <typename A, typename B, typename = expression_detail::enable_binary<A, B>>
+auto fmax(const A &a, const B &b) { return expression_detail::binary<expression_detail::Max>(a, b); }
+
+template <typename A, typename = expression_detail::enable_unary<A>>
+auto operator-(const A &a) { return expression_detail::unary<expression_detail::Neg>(a); }
+
+template <typename A, typename = expression_detail::enable_unary<A>>
+auto abs(const A &a) { return expression_detail::unary<expression_detail::Abs>(a); }
+
+template <typename A, typename = expression_detail::enable_unary<A>>
+auto sqrt(const A &a) { return expression_detail::unary<expression_detail::Sqrt>(a); }
+
+template <typename A, typename = expression_detail::enable_unary<A>>
+auto exp(const A &a) { return expression_detail::unary<expression_detail::Exp>(a); }
+
+template <typename A, typename = expression_detail::enable_unary<A>>
+auto log(const A &a) { return expression_detail::unary<expression_detail::Log>(a); }
+
+#endif
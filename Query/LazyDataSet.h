@@ -0,0 +1,185 @@
+// Deferred queries over a DataSet. Each operation adds a node to a logical plan (see Query/Plan.h) and returns at once;
+// collect() optimizes the whole plan and only then runs it (see Query/Executor.h).
+//   DataSet top = ds.lazy().filter(field("qty") > 0).group_by({"city"}).agg({agg("qty", Agg::SUM)}).sort_by({"qty_sum"}, {false}).head(5).collect();
+#ifndef LAZYDATASET_H
+#define LAZYDATASET_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "Plan.h"
+#include "Executor.h"
+#include "../Algorithm/Predicate.h"
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+class LazyGroupBy;
+
+// An immutable handle on a plan. Operations copy the handle and share the nodes below, so a LazyDataSet can be branched freely.
+// Labels are checked as the plan is built. The DataSets it scans must outlive it and keep their shape until collect() returns.
+class LazyDataSet {
+    private:
+        PlanPtr plan;
+
+        explicit LazyDataSet(PlanPtr plan) : plan(plan) { }
+        LazyDataSet then(PlanNode node) const;                                                   // This plan with 'node' on top of it
+        void require(const std::vector<std::string> &labels, const char *caller) const;         // Throws unless the plan outputs every label
+
+        friend class LazyGroupBy;
+
+    public:
+        explicit LazyDataSet(const DataSet &ds); // Scans every column of 'ds'
+
+        LazyDataSet filter(const Predicate &pred) const;                                                         // Keeps the rows matching 'pred'
+        LazyDataSet select(const std::vector<std::string> &labels) const;                                        // Keeps the columns labelled 'labels', in that order
+        LazyGroupBy group_by(const std::vector<std::string> &keys) const;                                        // Groups on the columns labelled 'keys'. Finish with agg()
+        LazyDataSet join(const LazyDataSet &right, const std::vector<std::string> &keys, JoinType how = JoinType::INNER) const;
+        LazyDataSet sort_by(const std::vector<std::string> &keys, const std::vector<bool> &ascending = {}) const;
+        LazyDataSet head(std::size_t n) const;                                                                    // Keeps the first 'n' rows
+
+        const PlanPtr& get_plan() const { return plan; }  // The plan as written
+        std::vector<std::string> get_labels() const;      // Labels of the columns the plan outputs
+        std::string explain(bool optimized = true) const; // The plan, one operator per line, as it will run or as written
+        DataSet collect() const;                          // Optimizes and runs the plan
+};
+
+class LazyGroupBy {
+    private:
+        LazyDataSet input;
+        std::vector<std::string> keys;
+
+    public:
+        LazyGroupBy(const LazyDataSet &input, const std::vector<std::string> &keys) : input(input), keys(keys) { }
+
+        LazyDataSet agg(const std::vector<Aggregation> &aggs) const; // One row per group: the key columns, then one column per aggregation
+};
+
+/* Definitions */
+
+inline LazyDataSet DataSet::lazy() const {
+    return LazyDataSet(*this);
+}
+
+inline LazyDataSet::LazyDataSet(const DataSet &ds) {
+    PlanNode node;
+    node.kind = PlanKind::SCAN;
+    node.source = &ds;
+    for (unsigned int c = 0; c < ds.num_cols(); c++) node.labels.push_back(ds.get_col_ref(c).get_label());
+
+    plan = std::make_shared<const PlanNode>(node);
+}
+
+inline LazyDataSet LazyDataSet::then(PlanNode node) const {
+    node.inputs.insert(node.inputs.begin(), plan);
+    return LazyDataSet(std::make_shared<const PlanNode>(node));
+}
+
+inline void LazyDataSet::require(const std::vector<std::string> &labels, const char *caller) const {
+    std::vector<std::string> have = get_labels();
+
+    for (const std::string &label : labels) {
+        if (std::find(have.begin(), have.end(), label) == have.end()) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> LazyDataSet::" << caller << "() -> No column labelled '" << label << "'!" << std::endl;
+            throw -1;
+        }
+    }
+}
+
+inline std::vector<std::string> LazyDataSet::get_labels() const {
+    return plan_detail::labels_of(plan_schema(*plan));
+}
+
+inline LazyDataSet LazyDataSet::filter(const Predicate &pred) const {
+    require(pred.get_labels(), "filter");
+
+    PlanNode node;
+    node.kind = PlanKind::FILTER;
+    node.conjuncts = {pred};
+    return then(node);
+}
+
+inline LazyDataSet LazyDataSet::select(const std::vector<std::string> &labels) const {
+    require(labels, "select");
+
+    if (labels.empty()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> LazyDataSet::select() -> No columns given!" << std::endl;
+        throw -1;
+    }
+
+    PlanNode node;
+    node.kind = PlanKind::PROJECT;
+    node.labels = labels;
+    return then(node);
+}
+
+inline LazyGroupBy LazyDataSet::group_by(const std::vector<std::string> &keys) const {
+    require(keys, "group_by");
+    return LazyGroupBy(*this, keys);
+}
+
+inline LazyDataSet LazyGroupBy::agg(const std::vector<Aggregation> &aggs) const {
+    PlanNode node;
+    node.kind = PlanKind::AGGREGATE;
+    node.labels = keys;
+
+    for (const Aggregation &a : aggs) {
+        if (a.fn != Agg::SIZE) input.require({a.label}, "agg");
+        node.aggs.push_back(::agg(a.label, a.fn, a.out_label)); // Fills in the default output label
+    }
+
+    return input.then(node);
+}
+
+inline LazyDataSet LazyDataSet::join(const LazyDataSet &right, const std::vector<std::string> &keys, JoinType how) const {
+    require(keys, "join");
+    right.require(keys, "join");
+
+    if (keys.empty()) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> LazyDataSet::join() -> No key columns given!" << std::endl;
+        throw -1;
+    }
+
+    PlanNode node;
+    node.kind = PlanKind::JOIN;
+    node.labels = keys;
+    node.how = how;
+    node.inputs = {right.plan};
+    return then(node);
+}
+
+inline LazyDataSet LazyDataSet::sort_by(const std::vector<std::string> &keys, const std::vector<bool> &ascending) const {
+    require(keys, "sort_by");
+
+    if (keys.empty() || (!ascending.empty() && ascending.size() != keys.size())) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> LazyDataSet::sort_by() -> One direction is needed per key!" << std::endl;
+        throw -1;
+    }
+
+    PlanNode node;
+    node.kind = PlanKind::SORT;
+    node.labels = keys;
+    node.ascending = ascending;
+    return then(node);
+}
+
+inline LazyDataSet LazyDataSet::head(std::size_t n) const {
+    PlanNode node;
+    node.kind = PlanKind::LIMIT;
+    node.limit = n;
+    return then(node);
+}
+
+inline std::string LazyDataSet::explain(bool optimized) const {
+    return explain_plan(optimized ? *optimize(plan) : *plan);
+}
+
+inline DataSet LazyDataSet::collect() const {
+    return execute_plan(*optimize(plan));
+}
+
+#endif
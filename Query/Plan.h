@@ -0,0 +1,382 @@
+// Logical query plans. A plan is a tree of immutable nodes, built by LazyDataSet and rewritten by optimize() before it runs:
+// filters move as close to the scans as their columns allow, adjacent operators are fused, and columns nothing reads are dropped.
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+#include "../Algorithm/Predicate.h"
+#include "../Container/DataSet.h"
+#include "../util/config.h"
+
+/* Declarations */
+
+enum class PlanKind { SCAN, FILTER, PROJECT, AGGREGATE, JOIN, SORT, LIMIT, TOP_K };
+
+struct PlanNode;
+typedef std::shared_ptr<const PlanNode> PlanPtr;
+
+struct PlanNode {
+    PlanKind kind;
+    std::vector<PlanPtr> inputs;      // One input, or two for JOIN (left, then right). None for SCAN
+    const DataSet *source = nullptr;  // SCAN: the DataSet read
+    std::vector<std::string> labels;  // SCAN: columns copied out. PROJECT: columns kept. AGGREGATE and JOIN: keys. SORT and TOP_K: sort keys
+    std::vector<bool> ascending;      // SORT and TOP_K: one direction per key
+    std::vector<Aggregation> aggs;    // AGGREGATE
+    std::vector<Predicate> conjuncts; // FILTER, and SCAN once filters are pushed into it. A row is kept if all of them hold
+    JoinType how = JoinType::INNER;   // JOIN
+    std::size_t limit = 0;            // LIMIT and TOP_K: rows kept
+};
+
+// A column a node outputs. Masked columns are only read when an operator names them
+struct PlanField {
+    std::string label;
+    bool masked;
+};
+
+std::vector<PlanField> plan_schema(const PlanNode &node); // The columns 'node' outputs, in order
+PlanPtr optimize(const PlanPtr &plan);                    // Pushes filters down, fuses adjacent operators and prunes unread columns
+std::string explain_plan(const PlanNode &node);           // One line per node, with its inputs indented below it
+
+/* Definitions */
+
+namespace plan_detail {
+    inline bool contains(const std::vector<std::string> &v, const std::string &s) {
+        return std::find(v.begin(), v.end(), s) != v.end();
+    }
+
+    inline void add_unique(std::vector<std::string> &v, const std::vector<std::string> &add) {
+        for (const std::string &s : add) {
+            if (!contains(v, s)) v.push_back(s);
+        }
+    }
+
+    inline bool all_in(const std::vector<std::string> &labels, const std::vector<std::string> &set) {
+        for (const std::string &s : labels) {
+            if (!contains(set, s)) return false;
+        }
+        return true;
+    }
+
+    inline std::vector<std::string> labels_of(const std::vector<PlanField> &fields) {
+        std::vector<std::string> out;
+        for (const PlanField &f : fields) out.push_back(f.label);
+        return out;
+    }
+
+    // A column of a join's output and where it comes from. Mirrors the naming of join_detail::assemble()
+    struct JoinField {
+        PlanField field;
+        bool from_right;
+        std::string source_label; // Label on its own side
+    };
+
+    inline std::vector<JoinField> join_fields(const PlanNode &node) {
+        std::vector<JoinField> out;
+        std::vector<std::string> taken;
+
+        for (const PlanField &f : plan_schema(*node.inputs[0])) {
+            out.push_back(JoinField{f, false, f.label});
+            taken.push_back(f.label);
+        }
+        if (node.how == JoinType::SEMI || node.how == JoinType::ANTI) return out;
+
+        for (const PlanField &f : plan_schema(*node.inputs[1])) {
+            if (contains(node.labels, f.label)) continue; // The left key stands for both
+
+            std::string label = contains(taken, f.label) ? f.label + "_right" : f.label;
+            out.push_back(JoinField{PlanField{label, f.masked}, true, f.label});
+            taken.push_back(label);
+        }
+
+        return out;
+    }
+
+    inline PlanPtr with_inputs(const PlanNode &node, const std::vector<PlanPtr> &inputs) {
+        PlanNode out = node;
+        out.inputs = inputs;
+        return std::make_shared<const PlanNode>(out);
+    }
+
+    inline PlanPtr filter_node(const std::vector<Predicate> &conjuncts, const PlanPtr &input) {
+        if (conjuncts.empty()) return input;
+
+        PlanNode out;
+        out.kind = PlanKind::FILTER;
+        out.conjuncts = conjuncts;
+        out.inputs = {input};
+        return std::make_shared<const PlanNode>(out);
+    }
+
+    // Places each predicate as deep under 'input' as the columns it reads allow. What cannot move stays on top as one filter
+    inline PlanPtr place(const std::vector<Predicate> &preds, const PlanPtr &input) {
+        if (preds.empty()) return input;
+        const PlanNode &in = *input;
+
+        switch (in.kind) {
+            case PlanKind::SCAN: {
+                PlanNode out = in;
+                out.conjuncts.insert(out.conjuncts.end(), preds.begin(), preds.end());
+                return std::make_shared<const PlanNode>(out);
+            }
+            case PlanKind::FILTER: {
+                std::vector<Predicate> all = in.conjuncts;
+                all.insert(all.end(), preds.begin(), preds.end());
+                return place(all, in.inputs[0]);
+            }
+            case PlanKind::PROJECT:
+            case PlanKind::SORT:
+                // Neither changes which rows exist, and filtering keeps the order
+                return with_inputs(in, {place(preds, in.inputs[0])});
+            case PlanKind::AGGREGATE: {
+                // A predicate on the keys alone keeps or drops whole groups, so it can run on the rows instead
+                std::vector<Predicate> below, above;
+                for (const Predicate &p : preds) (all_in(p.get_labels(), in.labels) ? below : above).push_back(p);
+                return filter_node(above, with_inputs(in, {place(below, in.inputs[0])}));
+            }
+            case PlanKind::JOIN: {
+                std::vector<JoinField> fields = join_fields(in);
+                std::vector<std::string> left_labels, right_labels; // Right columns that kept their name
+
+                for (const JoinField &f : fields) {
+                    if (!f.from_right) left_labels.push_back(f.field.label);
+                    else if (f.field.label == f.source_label) right_labels.push_back(f.field.label);
+                }
+
+                std::vector<Predicate> left, right, above;
+                for (const Predicate &p : preds) {
+                    std::vector<std::string> labels = p.get_labels();
+
+                    if (all_in(labels, left_labels)) {
+                        left.push_back(p);
+                        // Inner joins only pair equal keys, so a key predicate holds on both sides
+                        if (in.how == JoinType::INNER && all_in(labels, in.labels)) right.push_back(p);
+                    }
+                    else if (in.how == JoinType::INNER && all_in(labels, right_labels)) right.push_back(p);
+                    else above.push_back(p);
+                }
+
+                return filter_node(above, with_inputs(in, {place(left, in.inputs[0]), place(right, in.inputs[1])}));
+            }
+            default:
+                return filter_node(preds, input); // LIMIT and TOP_K pick rows, so filtering first would change which
+        }
+    }
+
+    // Bottom-up: filters are split into their conjuncts and pushed down, and adjacent operators are merged
+    inline PlanPtr rewrite(const PlanPtr &plan) {
+        if (plan->kind == PlanKind::SCAN) return plan;
+
+        PlanNode node = *plan;
+        for (PlanPtr &input : node.inputs) input = rewrite(input);
+        const PlanNode &in = *node.inputs[0];
+
+        switch (node.kind) {
+            case PlanKind::FILTER: {
+                std::vector<Predicate> preds;
+                for (const Predicate &p : node.conjuncts) {
+                    std::vector<Predicate> split = p.conjuncts();
+                    preds.insert(preds.end(), split.begin(), split.end());
+                }
+                return place(preds, node.inputs[0]);
+            }
+            case PlanKind::PROJECT:
+                if (in.kind == PlanKind::PROJECT) node.inputs = in.inputs; // The outer labels are a subset of the inner ones
+                break;
+            case PlanKind::LIMIT:
+                if (in.kind == PlanKind::LIMIT || in.kind == PlanKind::TOP_K) {
+                    PlanNode out = in;
+                    out.limit = std::min(in.limit, node.limit);
+                    return std::make_shared<const PlanNode>(out);
+                }
+                if (in.kind == PlanKind::SORT && in.labels.size() == 1) {
+                    PlanNode out = in;
+                    out.kind = PlanKind::TOP_K;
+                    out.limit = node.limit;
+                    return std::make_shared<const PlanNode>(out);
+                }
+                break;
+            default: break;
+        }
+
+        return std::make_shared<const PlanNode>(node);
+    }
+
+    // Top-down: every node keeps only the columns its parent reads, plus the ones it reads itself
+    inline PlanPtr prune(const PlanPtr &plan, const std::vector<std::string> &required) {
+        PlanNode node = *plan;
+        std::vector<std::string> need = required;
+
+        switch (node.kind) {
+            case PlanKind::SCAN: {
+                // Filter columns are read straight from the source, so they are not copied unless needed above
+                std::vector<std::string> kept;
+                for (unsigned int c = 0; c < node.source->num_cols(); c++) {
+                    const std::string &label = node.source->get_col_ref(c).get_label();
+                    if (contains(required, label) && !contains(kept, label)) kept.push_back(label);
+                }
+                if (kept.empty() && node.source->num_cols() > 0) kept.push_back(node.source->get_col_ref(0).get_label()); // Keeps the row count
+                node.labels = kept;
+                return std::make_shared<const PlanNode>(node);
+            }
+            case PlanKind::FILTER:
+                for (const Predicate &p : node.conjuncts) add_unique(need, p.get_labels());
+                break;
+            case PlanKind::PROJECT: {
+                std::vector<std::string> kept;
+                for (const std::string &label : node.labels) {
+                    if (contains(required, label)) kept.push_back(label);
+                }
+                if (kept.empty()) kept.push_back(node.labels.at(0));
+                node.labels = need = kept;
+                break;
+            }
+            case PlanKind::AGGREGATE: {
+                std::vector<Aggregation> kept;
+                need = node.labels;
+
+                for (const Aggregation &a : node.aggs) {
+                    if (!contains(required, a.out_label)) continue;
+                    kept.push_back(a);
+                    if (a.fn != Agg::SIZE) add_unique(need, {a.label});
+                }
+                node.aggs = kept;
+                break;
+            }
+            case PlanKind::JOIN: {
+                std::vector<std::string> left = node.labels, right = node.labels;
+
+                for (const JoinField &f : join_fields(node)) {
+                    if (!contains(required, f.field.label)) continue;
+                    add_unique(f.from_right ? right : left, {f.source_label});
+                    if (f.from_right && f.field.label != f.source_label) add_unique(left, {f.source_label}); // Keeps the clash, and so the name
+                }
+
+                node.inputs = {prune(node.inputs[0], left), prune(node.inputs[1], right)};
+                return std::make_shared<const PlanNode>(node);
+            }
+            case PlanKind::SORT:
+            case PlanKind::TOP_K:
+                add_unique(need, node.labels);
+                break;
+            default: break;
+        }
+
+        node.inputs = {prune(node.inputs[0], need)};
+        return std::make_shared<const PlanNode>(node);
+    }
+
+    inline void explain(const PlanNode &node, unsigned int depth, std::ostream &os) {
+        auto list = [&](const std::vector<std::string> &labels) {
+            os << "[";
+            for (std::size_t i = 0; i < labels.size(); i++) os << (i ? ", " : "") << labels[i];
+            os << "]";
+        };
+        auto keys = [&]() {
+            os << "[";
+            for (std::size_t i = 0; i < node.labels.size(); i++) {
+                os << (i ? ", " : "") << node.labels[i] << (node.ascending.empty() || node.ascending[i] ? " asc" : " desc");
+            }
+            os << "]";
+        };
+        auto predicate = [&]() {
+            for (std::size_t i = 0; i < node.conjuncts.size(); i++) os << (i ? " && " : "") << node.conjuncts[i].to_string();
+        };
+
+        os << std::string(2 * depth, ' ');
+
+        switch (node.kind) {
+            case PlanKind::SCAN:
+                os << "Scan ";
+                list(node.labels);
+                os << " of " << node.source->num_cols() << " columns";
+                if (!node.conjuncts.empty()) { os << " where "; predicate(); }
+                break;
+            case PlanKind::FILTER: os << "Filter "; predicate(); break;
+            case PlanKind::PROJECT: os << "Project "; list(node.labels); break;
+            case PlanKind::AGGREGATE: {
+                std::vector<std::string> outs;
+                for (const Aggregation &a : node.aggs) outs.push_back(a.out_label);
+                os << "Aggregate by ";
+                list(node.labels);
+                os << " into ";
+                list(outs);
+                break;
+            }
+            case PlanKind::JOIN: {
+                static const char *names[] = { "Inner", "Left", "Semi", "Anti" };
+                os << names[(int)node.how] << " join on ";
+                list(node.labels);
+                break;
+            }
+            case PlanKind::SORT: os << "Sort "; keys(); break;
+            case PlanKind::LIMIT: os << "Limit " << node.limit; break;
+            case PlanKind::TOP_K: os << "Top " << node.limit << " by "; keys(); break;
+        }
+        os << "\n";
+
+        for (const PlanPtr &input : node.inputs) explain(*input, depth + 1, os);
+    }
+}
+
+inline std::vector<PlanField> plan_schema(const PlanNode &node) {
+    std::vector<PlanField> out;
+
+    switch (node.kind) {
+        case PlanKind::SCAN:
+            for (const std::string &label : node.labels) {
+                out.push_back(PlanField{label, node.source->get_col_ref(node.source->get_col_index(label)).is_masked()});
+            }
+            return out;
+        case PlanKind::PROJECT:
+            for (const std::string &label : node.labels) out.push_back(PlanField{label, false}); // Naming a column unmasks it
+            return out;
+        case PlanKind::AGGREGATE: {
+            std::vector<PlanField> in = plan_schema(*node.inputs[0]);
+            for (const std::string &key : node.labels) {
+                for (const PlanField &f : in) {
+                    if (f.label == key) { out.push_back(f); break; }
+                }
+            }
+            for (const Aggregation &a : node.aggs) out.push_back(PlanField{a.out_label, false});
+            return out;
+        }
+        case PlanKind::JOIN:
+            for (const plan_detail::JoinField &f : plan_detail::join_fields(node)) out.push_back(f.field);
+            return out;
+        default:
+            return plan_schema(*node.inputs[0]);
+    }
+}
+
+inline PlanPtr optimize(const PlanPtr &plan) {
+    std::vector<PlanField> schema = plan_schema(*plan);
+    std::vector<std::string> output;
+    for (const PlanField &f : schema) {
+        if (!f.masked) output.push_back(f.label);
+    }
+    if (output.empty() && !schema.empty()) output.push_back(schema[0].label);
+
+    PlanPtr out = plan_detail::prune(plan_detail::rewrite(plan), output);
+
+    // Columns kept only for filters and sort keys are dropped at the end
+    if (plan_detail::labels_of(plan_schema(*out)) == output) return out;
+
+    PlanNode project;
+    project.kind = PlanKind::PROJECT;
+    project.labels = output;
+    project.inputs = {out};
+    return std::make_shared<const PlanNode>(project);
+}
+
+inline std::string explain_plan(const PlanNode &node) {
+    std::ostringstream os;
+    plan_detail::explain(node, 0, os);
+    return os.str();
+}
+
+#endif
@@ -1,8 +1,21 @@
 #include <string>
 #include <vector>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 #include "Container/DataSet.h"
 #include "Container/Bimap.h"
+#include "Container/DataSetView.h"
+#include "Algorithm/Predicate.h"
+#include "Algorithm/Scaler.h"
+#include "Query/LazyDataSet.h"
+#include "IO/Npy.h"
+#include "IO/Arrow.h"
+#include "IO/Csv.h"
+#include "IO/Binary.h"
+#include "IO/MultiLoad.h"
+#include "IO/Compression.h"
 
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #include "testing/catch.hpp"
@@ -218,4 +231,1603 @@ TEST_CASE("COLUMN CAN BE TURNED INTO STRING, PARTIAL TRANSLATION", "[Column]") {
         REQUIRE(vec.at(5) == "two");
         REQUIRE(vec.at(6) == "one");
     }
-}
\ No newline at end of file
+}
+TEST_CASE("DataSet can be instantiated", "[DataSet]") {
+    std::vector<std::vector<long double>> v = {{1, 2, 3}, {4, 5, 6}};
+
+    SECTION("COLUMNS BY DEFAULT") {
+        DataSet ds(v);
+
+        REQUIRE(ds.num_cols() == 2);
+        REQUIRE(ds.num_rows() == 3);
+        REQUIRE(ds.get_col_ref(1).get_label() == DEFAULT_LABEL + "1");
+        REQUIRE(ds.at(1, 2) == 6);
+    }
+
+    SECTION("ROWS WITH AXIS 0") {
+        DataSet ds(v, {"a", "b", "c"}, 0);
+
+        REQUIRE(ds.num_cols() == 3);
+        REQUIRE(ds.num_rows() == 2);
+        REQUIRE(ds.get_col_index("c") == 2);
+        REQUIRE(ds.get_row(1) == std::vector<long double>{4, 5, 6});
+    }
+
+    SECTION("COPY CONSTRUCTOR IS DEEP") {
+        DataSet ds(v);
+        DataSet copy(ds);
+
+        copy.at(0, 0) = 100;
+
+        REQUIRE(ds.at(0, 0) == 1);
+        REQUIRE(copy.get_map_ptr() == ds.get_map_ptr());
+    }
+
+    SECTION("MISMATCHED LABELS THROW") {
+        REQUIRE_THROWS(DataSet(v, {"only_one"}));
+    }
+}
+
+TEST_CASE("DataSet rows and columns can be set", "[DataSet]") {
+    DataSet ds({{1, 2, 3}, {4, 5, 6}});
+
+    SECTION("SET ROW") {
+        ds.set_row(0, {7, 8});
+
+        REQUIRE(ds.get_col(0) == std::vector<long double>{7, 2, 3});
+        REQUIRE(ds.get_col(1) == std::vector<long double>{8, 5, 6});
+    }
+
+    SECTION("SET COLUMN") {
+        ds.set_col(1, std::vector<long double>{0, 0, 0});
+
+        REQUIRE(ds.get_data().at(1) == std::vector<long double>{0, 0, 0});
+        REQUIRE_THROWS(ds.set_col(1, std::vector<long double>{0}));
+    }
+
+    SECTION("ADD COLUMN") {
+        ds.add_col(Column({9, 9, 9}, "nines"));
+
+        REQUIRE(ds.num_cols() == 3);
+        REQUIRE(ds.get_raw_col(2).get_label() == "nines");
+        REQUIRE_THROWS(ds.add_col(std::vector<long double>{1}));
+    }
+
+    SECTION("CONST LOOKUPS CAN BE SHARED ACROSS THREADS") {
+        ds.add_col(Column({9, 9, 9}, "nines"));
+        const DataSet &shared = ds;
+
+        std::vector<long double> sums(64);
+        parallel_for_each(0, sums.size(), [&](std::size_t i) { sums[i] = shared["nines"].sum(); });
+
+        REQUIRE(std::all_of(sums.begin(), sums.end(), [](long double s) { return s == 27; }));
+        REQUIRE_THROWS(shared["missing"]);
+    }
+}
+
+TEST_CASE("DataSet shares one translation map across its columns", "[DataSet]") {
+    DataSet ds;
+
+    long double red = ds.encode("red");
+    REQUIRE(ds.encode("red") == red);
+    REQUIRE(ds.encode("blue") != red);
+
+    SECTION("FOREIGN MAPS ARE ADOPTED") {
+        Column c({1, 2, 1}, "colour");
+        Bimap<long double, std::string> bm;
+        bm.set(1, "red");
+        bm.set(2, "green");
+        c.set_map(bm);
+
+        ds.add_col(c);
+
+        REQUIRE(ds.get_col_ref(0).get_map_ptr() == ds.get_map_ptr());
+        REQUIRE(ds.at(0, 0) == red);
+        REQUIRE(ds.get_data_as_string().at(0) == std::vector<std::string>{"red", "green", "red"});
+    }
+}
+
+TEST_CASE("DataSet can be saved to and loaded from npy", "[Npy]") {
+    DataSet ds({{1.5, 2.25, -3}, {4, 5, 6}}, {"a", "b"});
+
+    SECTION("FLOAT64 ROUND TRIP") {
+        save_npy(ds, "test_roundtrip.npy");
+        DataSet in = load_npy("test_roundtrip.npy");
+        std::remove("test_roundtrip.npy");
+
+        REQUIRE(in.num_cols() == 2);
+        REQUIRE(in.get_data() == ds.get_data());
+    }
+
+    SECTION("LONG DOUBLE KEEPS FULL PRECISION") {
+        DataSet precise(std::vector<std::vector<long double>>{{1.0L / 3.0L}});
+
+        save_npy(precise, "test_precise.npy", true);
+        DataSet in = load_npy("test_precise.npy");
+        std::remove("test_precise.npy");
+
+        REQUIRE(in.at(0, 0) == 1.0L / 3.0L);
+    }
+
+    SECTION("NPZ ROUND TRIP KEEPS LABELS") {
+        save_npz(ds, "test_roundtrip.npz");
+        DataSet in = load_npz("test_roundtrip.npz");
+        std::remove("test_roundtrip.npz");
+
+        REQUIRE(in.get_col_index("b") == 1);
+        REQUIRE(in.get_data() == ds.get_data());
+    }
+
+    SECTION("CORRUPT ARCHIVES THROW INSTEAD OF READING PAST THE END") {
+        save_npz(ds, "test_corrupt.npz");
+        std::ifstream file("test_corrupt.npz", std::ios::binary);
+        const string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::remove("test_corrupt.npz");
+
+        const size_t cd = zip_detail::read32(bytes.data() + bytes.size() - 22 + 16); // First central directory record
+        auto patched = [&](size_t at, std::uint32_t v, int width) {
+            string s = bytes;
+            for (int i = 0; i < width; i++) s[at + i] = (char)(v >> (8 * i));
+            return s;
+        };
+
+        REQUIRE(zip_entries(bytes.data(), bytes.size()).size() == 2);
+
+        string long_name = patched(cd + 28, 0xFFFF, 2);
+        REQUIRE_THROWS(zip_entries(long_name.data(), long_name.size()));
+
+        string far_local = patched(cd + 42, bytes.size() - 10, 4);
+        REQUIRE_THROWS(zip_entries(far_local.data(), far_local.size()));
+    }
+}
+
+TEST_CASE("C-order npy arrays are transposed into columns", "[Npy]") {
+    // A hand-written 3x2 int32 array in C order: [[1, 2], [3, 4], [5, 6]]
+    std::string dict = "{'descr': '<i4', 'fortran_order': False, 'shape': (3, 2), }";
+    dict.append((64 - (10 + dict.size() + 1) % 64) % 64, ' ');
+    dict.push_back('\n');
+
+    std::ofstream out("test_corder.npy", std::ios::binary);
+    out.write("\x93NUMPY\x01\x00", 8);
+    out.put(dict.size());
+    out.put(0);
+    out << dict;
+    for (int v = 1; v <= 6; v++) out.write(reinterpret_cast<const char*>(&v), 4);
+    out.close();
+
+    DataSet in = load_npy("test_corder.npy");
+    std::remove("test_corder.npy");
+
+    REQUIRE(in.num_cols() == 2);
+    REQUIRE(in.get_col(0) == std::vector<long double>{1, 3, 5});
+    REQUIRE(in.get_col(1) == std::vector<long double>{2, 4, 6});
+}
+
+TEST_CASE("DataSet can be exported to and imported from Arrow", "[Arrow]") {
+    DataSet ds({{1.5, NAN, 3}}, {"num"});
+    ds.add_col(Column({ds.encode("x"), ds.encode("y"), ds.encode("x")}, "cat"));
+    ds.get_col_ref(1).set_map(ds.get_map_ptr());
+
+    ArrowSchema schema;
+    ArrowArray array;
+    export_dataset(ds, &schema, &array);
+
+    SECTION("SCHEMA DESCRIBES THE COLUMNS") {
+        REQUIRE(std::string(schema.format) == "+s");
+        REQUIRE(schema.n_children == 2);
+        REQUIRE(std::string(schema.children[0]->format) == "g");
+        REQUIRE(std::string(schema.children[1]->name) == "cat");
+        REQUIRE(std::string(schema.children[1]->dictionary->format) == "u");
+        REQUIRE(array.children[0]->null_count == 1);
+        REQUIRE(array.children[1]->dictionary->length == 2);
+
+        array.release(&array);
+        schema.release(&schema);
+        REQUIRE(array.release == nullptr);
+    }
+
+    SECTION("ROUND TRIP") {
+        DataSet in = import_dataset(&schema, &array);
+
+        REQUIRE(array.release == nullptr);
+        REQUIRE(in.num_cols() == 2);
+        REQUIRE(in.at(0, 0) == 1.5);
+        REQUIRE(std::isnan(in.at(0, 1)));
+        REQUIRE(in.get_col_ref(1).is_categorical());
+        REQUIRE(in.get_col_ref(1).as_string() == std::vector<std::string>{"x", "y", "x"});
+    }
+
+    SECTION("A FAILED IMPORT STILL RELEASES THE STRUCTS") {
+        schema.children[0]->format = "zz";
+
+        REQUIRE_THROWS(import_dataset(&schema, &array));
+        REQUIRE(array.release == nullptr);
+        REQUIRE(schema.release == nullptr);
+    }
+}
+
+TEST_CASE("CSV files can be streamed in batches", "[Stream]") {
+    std::ofstream out("test_stream.csv");
+    out << "id,name,score\n";
+    for (int i = 0; i < 10; i++) out << i << "," << (i % 2 ? "odd" : "even") << "," << (i == 3 ? "" : std::to_string(i * 0.5)) << "\n";
+    out.close();
+
+    SECTION("BATCHES ARE BOUNDED") {
+        CsvReader reader("test_stream.csv", 4);
+        DataSet batch;
+        std::vector<unsigned int> sizes;
+
+        while (reader.next(batch)) sizes.push_back(batch.num_rows());
+
+        REQUIRE(sizes == std::vector<unsigned int>{4, 4, 2});
+        REQUIRE(batch.get_col_ref(1).is_categorical());
+        REQUIRE(batch.get_col_ref(1).as_string(0) == "even");
+    }
+
+    SECTION("PREFETCHING YIELDS THE SAME ROWS") {
+        PrefetchReader reader(std::unique_ptr<BatchReader>(new CsvReader("test_stream.csv", 3)));
+        DataSet batch;
+        std::vector<long double> ids;
+
+        while (reader.next(batch)) {
+            for (long double v : batch.get_col(0)) ids.push_back(v);
+        }
+
+        REQUIRE(ids.size() == 10);
+        REQUIRE(ids.back() == 9);
+    }
+
+    SECTION("LOAD WHOLE FILE") {
+        DataSet ds = load_csv("test_stream.csv");
+
+        REQUIRE(ds.num_rows() == 10);
+        REQUIRE(std::isnan(ds.at(2, 3)));
+    }
+
+    SECTION("THE FIRST BATCH FIXES THE SCHEMA") {
+        std::ofstream mixed("test_mixed.csv");
+        mixed << "code,n\n12,1\nabc,2\n,3\n7,4\n8,x\n";
+        mixed.close();
+
+        CsvReader reader("test_mixed.csv", 3);
+        DataSet first, second;
+        reader.next(first);
+
+        REQUIRE(first.get_col_ref(0).is_categorical());
+        REQUIRE(first.get_col_ref(0).as_string(0) == "12"); // Numbers in a categorical column are terms too
+        REQUIRE(first.get_col_ref(0).as_string(1) == "abc");
+        REQUIRE(std::isnan(first.at(0, 2)));
+        REQUIRE_FALSE(first.get_col_ref(1).is_categorical());
+
+        REQUIRE_THROWS(reader.next(second)); // "x" in a column that the first batch made numeric
+
+        REQUIRE(load_csv("test_mixed.csv").get_col_ref(1).is_categorical());
+        std::remove("test_mixed.csv");
+    }
+
+    std::remove("test_stream.csv");
+}
+
+TEST_CASE("Binary files can be streamed in batches", "[Stream]") {
+    DataSet ds({{1, 2, 3, 4, 5, 6, 7}}, {"x"});
+    ds.add_col(Column({ds.encode("a"), ds.encode("b"), ds.encode("a"), ds.encode("a"), ds.encode("b"), ds.encode("a"), ds.encode("b")}, "tag"));
+    ds.get_col_ref(1).set_map(ds.get_map_ptr());
+    ds.get_col_ref(0).set_masked(true);
+
+    save_binary(ds, "test_stream.dscb", 3);
+
+    SECTION("BATCHES SPAN BLOCKS") {
+        PrefetchReader reader(std::unique_ptr<BatchReader>(new BinaryReader("test_stream.dscb", 5)));
+        DataSet batch;
+
+        REQUIRE(reader.next(batch));
+        REQUIRE(batch.get_col(0) == std::vector<long double>{1, 2, 3, 4, 5});
+        REQUIRE(reader.next(batch));
+        REQUIRE(batch.get_col(0) == std::vector<long double>{6, 7});
+        REQUIRE(batch.get_col_ref(1).as_string(1) == "b");
+        REQUIRE(!reader.next(batch));
+    }
+
+    SECTION("LOAD WHOLE FILE") {
+        DataSet in = load_binary("test_stream.dscb");
+
+        REQUIRE(in.get_data() == ds.get_data());
+        REQUIRE(in.get_col_ref(0).is_masked());
+        REQUIRE(in.get_data_as_string().at(1) == ds.get_data_as_string().at(1));
+    }
+
+    std::remove("test_stream.dscb");
+}
+
+TEST_CASE("Partition files can be loaded into one DataSet", "[MultiLoad]") {
+    for (int f = 0; f < 3; f++) {
+        std::ofstream out("test_part_" + std::to_string(f) + ".csv");
+        out << "hour,city\n";
+        for (int r = 0; r < 4; r++) out << f * 4 + r << "," << (r % 2 ? "paris" : "oslo") << "\n";
+    }
+
+    SECTION("GLOB KEEPS FILE ORDER") {
+        std::vector<std::string> paths = glob_files("test_part_*.csv");
+        REQUIRE(paths.size() == 3);
+        REQUIRE(paths.front() == "test_part_0.csv");
+
+        DataSet ds = load_glob("test_part_*.csv");
+
+        REQUIRE(ds.num_rows() == 12);
+        REQUIRE(ds.get_col_index("city") == 1);
+        REQUIRE(ds.at(0, 11) == 11);
+        REQUIRE(ds.get_col_ref(1).get_map_ptr() == ds.get_map_ptr());
+        REQUIRE(ds.get_col_ref(1).as_string(9) == "paris");
+        REQUIRE(ds.get_map_ptr()->size() == 2);
+    }
+
+    SECTION("FORMATS CAN BE MIXED") {
+        DataSet extra({{100, 101}}, {"hour"});
+        extra.add_col(Column({extra.encode("rome"), extra.encode("oslo")}, "city"));
+        extra.get_col_ref(1).set_map(extra.get_map_ptr());
+        save_binary(extra, "test_part_3.dscb");
+
+        DataSet ds = load_files({"test_part_0.csv", "test_part_3.dscb"});
+        std::remove("test_part_3.dscb");
+
+        REQUIRE(ds.num_rows() == 6);
+        REQUIRE(ds.get_col_ref(1).as_string() == std::vector<std::string>{"oslo", "paris", "oslo", "paris", "rome", "oslo"});
+    }
+
+    SECTION("MISMATCHED COLUMNS THROW") {
+        std::ofstream out("test_part_x.csv");
+        out << "hour\n1\n";
+        out.close();
+
+        REQUIRE_THROWS(load_files({"test_part_0.csv", "test_part_x.csv"}));
+        std::remove("test_part_x.csv");
+    }
+
+    for (int f = 0; f < 3; f++) std::remove(("test_part_" + std::to_string(f) + ".csv").c_str());
+}
+
+TEST_CASE("Blocks are compressed with the encoding that suits them", "[Compression]") {
+    const std::size_t n = 15000;
+    std::vector<long double> ints(n), floats(n), codes(n), precise(n), decoded(n);
+
+    for (std::size_t i = 0; i < n; i++) {
+        ints[i] = 1000000 + 3 * i + (i % 7);
+        floats[i] = (i / 3) * 0.1;
+        codes[i] = (i / 100) % 3 == 0 ? 12345678901.0L : 98765.0L;
+        precise[i] = (i % 5) / 3.0L;
+    }
+    precise[10] = NAN;
+    precise[11] = -0.0L;
+
+    auto round_trip = [&](const std::vector<long double> &values, std::uint8_t expected) {
+        std::string out;
+        std::uint8_t encoding = compress_block(values.data(), n, out);
+        decompress_block(encoding, out.data(), out.size(), decoded.data(), n);
+
+        REQUIRE(encoding == expected);
+        REQUIRE(out.size() < n * sizeof(long double));
+        bool same = true;
+        for (std::size_t i = 0; i < n; i++) {
+            same = same && ((std::isnan(decoded[i]) && std::isnan(values[i])) || decoded[i] == values[i]);
+            same = same && std::signbit(decoded[i]) == std::signbit(values[i]);
+        }
+        REQUIRE(same);
+    };
+
+    SECTION("INTEGERS USE DELTAS") { round_trip(ints, ENCODING_DELTA); }
+    SECTION("LOW CARDINALITY USES RUNS") { round_trip(codes, ENCODING_RLE); }
+    SECTION("DOUBLES USE XOR") { round_trip(floats, ENCODING_XOR); }
+    SECTION("EXTENDED PRECISION FALLS BACK TO LZ") { round_trip(precise, ENCODING_LZ); }
+
+    SECTION("LZ ROUND TRIP") {
+        std::string text;
+        for (int i = 0; i < 200; i++) text += "the quick brown fox " + std::to_string(i % 10);
+
+        std::string packed;
+        lz_compress(text.data(), text.size(), packed);
+        std::string unpacked(text.size(), '\0');
+        lz_decompress(packed.data(), packed.size(), &unpacked[0], unpacked.size());
+
+        REQUIRE(packed.size() < text.size() / 4);
+        REQUIRE(unpacked == text);
+        REQUIRE_THROWS(lz_decompress(packed.data(), packed.size() / 2, &unpacked[0], unpacked.size()));
+    }
+}
+
+TEST_CASE("Binary files are compressed block by block", "[Compression]") {
+    std::vector<long double> id(5000), price(5000);
+    for (std::size_t i = 0; i < id.size(); i++) {
+        id[i] = i;
+        price[i] = 100 + (i % 17) * 0.5;
+    }
+
+    DataSet ds({id, price}, {"id", "price"});
+    save_binary(ds, "test_packed.dscb", 1024);
+    save_binary(ds, "test_raw.dscb", 1024, false);
+
+    std::ifstream packed("test_packed.dscb", std::ios::binary | std::ios::ate), raw("test_raw.dscb", std::ios::binary | std::ios::ate);
+    REQUIRE(packed.tellg() * 4 < raw.tellg());
+
+    REQUIRE(load_binary("test_packed.dscb").get_data() == ds.get_data());
+    REQUIRE(load_files({"test_packed.dscb"}).get_data() == ds.get_data());
+
+    std::remove("test_packed.dscb");
+    std::remove("test_raw.dscb");
+}
+
+TEST_CASE("Columns can be summarised", "[Aggregate]") {
+    Column c({4, NAN, -2, 7, 7, NAN, 1}, "values");
+
+    SECTION("NULLS ARE SKIPPED") {
+        REQUIRE(c.count() == 5);
+        REQUIRE(c.sum() == 17);
+        REQUIRE(c.mean() == Approx(3.4));
+        REQUIRE(c.variance() == Approx(15.3));
+        REQUIRE(c.variance(0) == Approx(12.24));
+    }
+
+    SECTION("EXTREMES REPORT THE FIRST POSITION") {
+        REQUIRE(c.min() == -2);
+        REQUIRE(c.max() == 7);
+        REQUIRE(c.argmin() == 2);
+        REQUIRE(c.argmax() == 3);
+    }
+
+    SECTION("EMPTY COLUMNS") {
+        Column empty({NAN, NAN});
+
+        REQUIRE(empty.count() == 0);
+        REQUIRE(empty.sum() == 0);
+        REQUIRE(std::isnan(empty.mean()));
+        REQUIRE(std::isnan(empty.max()));
+        REQUIRE(empty.argmin() == -1);
+    }
+
+    SECTION("COMPENSATED SUMMATION") {
+        Column cancel({1e20L, 1, -1e20L});
+
+        REQUIRE(cancel.sum() == 0);
+        REQUIRE(cancel.sum(true) == 1);
+    }
+
+    SECTION("LARGE COLUMNS ARE REDUCED IN BLOCKS") {
+        std::vector<long double> v(300000);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = i % 1000;
+        v[250000] = -5;
+        Column big(v);
+
+        REQUIRE(big.sum() == 149849995);
+        REQUIRE(big.sum(true) == 149849995);
+        REQUIRE(big.argmin() == 250000);
+        REQUIRE(big.variance() == Approx(83333.25).epsilon(0.001));
+    }
+}
+
+TEST_CASE("DataSet can describe its columns", "[Describe]") {
+    DataSet ds({{1, 2, 3, 4, NAN}, {5, 5, 5, 5, 5}, {0, 0, 0, 0, 0}}, {"a", "b", "hidden"});
+    ds.get_col_ref(2).set_masked(true);
+
+    std::vector<ColumnSummary> summary = ds.describe();
+
+    SECTION("MASKED COLUMNS ARE SKIPPED") {
+        REQUIRE(summary.size() == 2);
+        REQUIRE(summary[1].label == "b");
+    }
+
+    SECTION("STATISTICS") {
+        const ColumnSummary &a = summary[0];
+
+        REQUIRE(a.count == 4);
+        REQUIRE(a.nulls == 1);
+        REQUIRE(a.mean == Approx(2.5));
+        REQUIRE(a.std == Approx(1.2909944));
+        REQUIRE(a.min == 1);
+        REQUIRE(a.q25 == Approx(1.75));
+        REQUIRE(a.median == Approx(2.5));
+        REQUIRE(a.q75 == Approx(3.25));
+        REQUIRE(a.max == 4);
+        REQUIRE(a.distinct == 4);
+        REQUIRE(summary[1].distinct == 1);
+    }
+
+    SECTION("LONG COLUMNS ARE MERGED ACROSS BLOCKS") {
+        std::vector<long double> v(200001);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = (i * 7919) % v.size();
+
+        DataSet big({v});
+        ColumnSummary s = big.describe().at(0);
+
+        REQUIRE(s.count == v.size());
+        REQUIRE(s.min == 0);
+        REQUIRE(s.max == 200000);
+        REQUIRE(s.median == 100000);
+        REQUIRE(s.mean == Approx(100000));
+        REQUIRE(s.distinct == Approx(200001).epsilon(0.1));
+    }
+
+    SECTION("CATEGORICAL COLUMNS ARE ONLY COUNTED") {
+        DataSet cats;
+        cats.add_col(Column({cats.encode("x"), cats.encode("y"), cats.encode("x"), NAN}, "cat"));
+        cats.get_col_ref(0).set_map(cats.get_map_ptr());
+
+        ColumnSummary s = cats.describe().at(0);
+
+        REQUIRE(s.count == 3);
+        REQUIRE(s.nulls == 1);
+        REQUIRE(s.distinct == 2);
+        REQUIRE(std::isnan(s.mean));
+        REQUIRE(std::isnan(s.std));
+        REQUIRE(std::isnan(s.min));
+        REQUIRE(std::isnan(s.median));
+        REQUIRE(std::isnan(s.max));
+    }
+}
+
+TEST_CASE("DataSet can be filtered with predicates", "[Filter]") {
+    DataSet ds({{1, 5, NAN, 8, 3, 9}, {10, 20, 30, 40, 50, 60}}, {"x", "y"});
+    ds.add_col(Column({ds.encode("a"), ds.encode("b"), ds.encode("a"), ds.encode("c"), ds.encode("a"), ds.encode("b")}, "cat"));
+    ds.get_col_ref(2).set_map(ds.get_map_ptr());
+
+    SECTION("COMPARISONS SKIP NULLS") {
+        REQUIRE((field("x") > 4).evaluate(ds).to_selection() == std::vector<unsigned int>{1, 3, 5});
+        REQUIRE((field("x") != 5).evaluate(ds).to_selection() == std::vector<unsigned int>{0, 3, 4, 5});
+        REQUIRE(field("x").between(3, 8).evaluate(ds).to_selection() == std::vector<unsigned int>{1, 3, 4});
+        REQUIRE(field("x").is_null().evaluate(ds).to_selection() == std::vector<unsigned int>{2});
+    }
+
+    SECTION("PREDICATES COMBINE") {
+        Predicate p = (field("x") > 4 && field("y") < 50) || !field("cat").not_null();
+        REQUIRE(p.evaluate(ds).to_selection() == std::vector<unsigned int>{1, 3});
+        REQUIRE(p.get_labels() == std::vector<std::string>{"x", "y", "cat"});
+        REQUIRE(p.to_string() == "(((x > 4) && (y < 50)) || !!(cat is null))");
+    }
+
+    SECTION("NEGATION LEAVES NULLS OUT") {
+        REQUIRE((!(field("x") == 5)).evaluate(ds).to_selection() == (field("x") != 5).evaluate(ds).to_selection());
+        REQUIRE((!(field("x") > 4)).evaluate(ds).to_selection() == std::vector<unsigned int>{0, 4});
+        REQUIRE(field("x").not_null().evaluate(ds).to_selection() == std::vector<unsigned int>{0, 1, 3, 4, 5});
+
+        // A null leaves a row undecided unless the other side settles it: false for &&, true for ||
+        REQUIRE((!(field("x") > 4 && field("y") < 35)).evaluate(ds).to_selection() == std::vector<unsigned int>{0, 3, 4, 5});
+        REQUIRE((!(field("x") > 4 && field("y") > 25)).evaluate(ds).to_selection() == std::vector<unsigned int>{0, 1, 4});
+        REQUIRE((!(field("x") > 4 || field("y") > 35)).evaluate(ds).to_selection() == std::vector<unsigned int>{0});
+        REQUIRE((!(field("x") > 4 || field("y") < 35)).evaluate(ds).to_selection() == std::vector<unsigned int>{4});
+        REQUIRE((!!(field("x") == 5)).evaluate(ds).to_selection() == std::vector<unsigned int>{1});
+    }
+
+    SECTION("FILTER GATHERS EVERY COLUMN") {
+        DataSet out = ds.filter(field("cat") == "a" && field("y") >= 20);
+
+        REQUIRE(out.num_rows() == 2);
+        REQUIRE(out.get_col_ref(1).get_data() == std::vector<long double>{30, 50});
+        REQUIRE(out.get_col_ref(2).as_string(1) == "a");
+        REQUIRE(ds.filter(field("cat") == "missing").num_rows() == 0);
+        REQUIRE(ds.take({5, 0}).get_col(1) == std::vector<long double>{60, 10});
+    }
+
+    SECTION("VIEWS DEFER THE COPY") {
+        DataSetView view(ds, field("y") > 35);
+
+        REQUIRE(view.num_rows() == 3);
+        REQUIRE(view.at(0, 1) == 3);
+        REQUIRE(view.source_row(2) == 5);
+        REQUIRE(view.materialize().get_col(0) == std::vector<long double>{8, 3, 9});
+    }
+
+    SECTION("MASKS SPAN MANY WORDS") {
+        std::vector<long double> v(200003);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = i % 7;
+
+        DataSet big({v}, {"v"});
+        Bitmask mask = (field("v") == 3).evaluate(big);
+
+        REQUIRE(mask.count() == 28572);
+        REQUIRE((~mask).count() == v.size() - 28572);
+        REQUIRE((mask | ~mask).count() == v.size());
+
+        std::vector<unsigned int> sel = mask.to_selection();
+        bool same = sel.size() == 28572;
+        for (std::size_t i = 0; same && i < sel.size(); i++) same = sel[i] == 7 * i + 3;
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("DataSet rows can be grouped and aggregated", "[GroupBy]") {
+    DataSet ds({{1, 2, 1, NAN, 2, 1}, {10, 20, 30, 40, NAN, 60}}, {"k", "v"});
+    ds.add_col(Column({ds.encode("b"), ds.encode("a"), ds.encode("b"), ds.encode("a"), ds.encode("a"), ds.encode("c")}, "cat"));
+    ds.get_col_ref(2).set_map(ds.get_map_ptr());
+
+    SECTION("NUMERIC KEYS") {
+        GroupBy g = ds.group_by({"k"});
+        DataSet out = g.agg({agg("v", Agg::SUM), agg("v", Agg::COUNT), agg("", Agg::SIZE), agg("v", Agg::MEAN, "avg")});
+
+        REQUIRE(!g.is_dense());
+        REQUIRE(g.num_groups() == 3);
+        REQUIRE(g.get_group_ids() == std::vector<std::uint32_t>{0, 1, 0, 2, 1, 0});
+        REQUIRE(out.get_col_ref(1).get_label() == "v_sum");
+        REQUIRE(out.get_col(1) == std::vector<long double>{100, 20, 40});
+        REQUIRE(out.get_col(2) == std::vector<long double>{3, 1, 1});
+        REQUIRE(out.get_col(3) == std::vector<long double>{3, 2, 1});
+        REQUIRE(out.get_col_ref(4).at(0) == Approx(100.0 / 3));
+        REQUIRE(std::isnan(out.at(0, 2)));
+    }
+
+    SECTION("CATEGORICAL KEYS USE THEIR CODES") {
+        GroupBy g = ds.group_by({"cat"});
+        DataSet out = g.agg({agg("v", Agg::MIN), agg("v", Agg::MAX), agg("v", Agg::FIRST), agg("v", Agg::LAST)});
+
+        REQUIRE(g.is_dense());
+        REQUIRE(out.get_col_ref(0).as_string() == std::vector<std::string>{"b", "a", "c"});
+        REQUIRE(out.get_col(1) == std::vector<long double>{10, 20, 60});
+        REQUIRE(out.get_col(2) == std::vector<long double>{30, 40, 60});
+        REQUIRE(out.get_col(3) == std::vector<long double>{10, 20, 60});
+
+        GroupBy mixed = ds.group_by({"cat", "k"});
+        REQUIRE(!mixed.is_dense());
+        REQUIRE(mixed.num_groups() == 4);
+    }
+
+    SECTION("MISSING COLUMNS THROW") {
+        REQUIRE_THROWS(ds.group_by({"nope"}));
+    }
+
+    SECTION("LARGE INPUTS ARE PARTITIONED") {
+        std::vector<long double> k(300000), v(300000);
+        for (std::size_t i = 0; i < k.size(); i++) { k[i] = (i * 7919) % 1000; v[i] = 1; }
+
+        DataSet big({k, v}, {"k", "v"});
+        GroupBy g = big.group_by({"k"});
+        DataSet out = g.agg({agg("v", Agg::SUM), agg("v", Agg::VAR)});
+
+        REQUIRE(out.num_rows() == 1000);
+        REQUIRE(out.at(0, 0) == 0);
+        REQUIRE(out.at(0, 1) == 919);
+        REQUIRE(g.get_first_rows()[1] == 1);
+
+        bool same = true;
+        for (std::size_t i = 0; same && i < 1000; i++) same = out.at(1, i) == 300 && out.at(2, i) == 0;
+        REQUIRE(same);
+
+        std::vector<long double> codes = {big.encode("x"), big.encode("y"), big.encode("z")};
+        for (std::size_t i = 0; i < k.size(); i++) k[i] = codes[i % 3];
+        big.add_col(Column(k, "cat"));
+        big.get_col_ref(2).set_map(big.get_map_ptr());
+
+        GroupBy dense = big.group_by({"cat"});
+        REQUIRE(dense.is_dense());
+        REQUIRE(dense.agg({agg("v", Agg::SUM)}).get_col(1) == std::vector<long double>{100000, 100000, 100000});
+    }
+}
+
+TEST_CASE("DataSets can be joined on key columns", "[Join]") {
+    DataSet events({{1, 2, 3, 2, NAN}, {10, 20, 30, 40, 50}}, {"id", "value"});
+    DataSet dims({{2, 1, 2, 4}, {200, 100, 201, 400}, {7, 7, 7, 7}}, {"id", "weight", "value"});
+
+    SECTION("INNER") {
+        DataSet out = events.join(dims, {"id"});
+
+        REQUIRE(out.num_cols() == 4);
+        REQUIRE(out.get_col_ref(3).get_label() == "value_right");
+        REQUIRE(out.get_col(0) == std::vector<long double>{1, 2, 2, 2, 2});
+        REQUIRE(out.get_col(1) == std::vector<long double>{10, 20, 20, 40, 40});
+        REQUIRE(out.get_col(2) == std::vector<long double>{100, 200, 201, 200, 201});
+    }
+
+    SECTION("LEFT KEEPS UNMATCHED ROWS") {
+        DataSet out = events.join(dims, {"id"}, JoinType::LEFT);
+
+        REQUIRE(out.num_rows() == 7);
+        REQUIRE(out.at(1, 3) == 30);
+        REQUIRE(std::isnan(out.at(2, 3)));
+        REQUIRE(std::isnan(out.at(2, 6)));
+    }
+
+    SECTION("SEMI AND ANTI") {
+        REQUIRE(events.join(dims, {"id"}, JoinType::SEMI).get_col(1) == std::vector<long double>{10, 20, 40});
+        REQUIRE(events.join(dims, {"id"}, JoinType::ANTI).get_col(1) == std::vector<long double>{30, 50});
+    }
+
+    SECTION("CATEGORICAL KEYS") {
+        DataSet left({{1, 2, 3}}, {"n"});
+        left.add_col(Column({left.encode("x"), left.encode("y"), left.encode("z")}, "cat"));
+        left.get_col_ref(1).set_map(left.get_map_ptr());
+
+        DataSet own({{5, 6}}, {"m"});
+        own.add_col(Column({own.encode("z"), own.encode("x")}, "cat"));
+        own.get_col_ref(1).set_map(own.get_map_ptr());
+        own.get_map_ptr()->remove_value("x");
+        own.get_map_ptr()->set(123, "x"); // Codes no longer agree with the left map
+        own.at(1, 1) = 123;
+
+        DataSet shared({{8}}, {"m"});
+        shared.set_map_ptr(left.get_map_ptr());
+        shared.add_col(Column({shared.encode("y")}, "cat"));
+        shared.get_col_ref(1).set_map(shared.get_map_ptr());
+
+        REQUIRE(left.join(own, {"cat"}).get_col(2) == std::vector<long double>{6, 5});
+        REQUIRE(left.join(shared, {"cat"}).get_col(2) == std::vector<long double>{8});
+    }
+
+    SECTION("RIGHT TERMS DO NOT LEAK INTO THE LEFT MAP") {
+        DataSet left({{1, 2, 3}}, {"id"});
+        left.encode("red");
+
+        DataSet right({{3, 1, 1}}, {"id"});
+        right.add_col(Column({right.encode("blue"), right.encode("green"), NAN}, "color"));
+        right.get_col_ref(1).set_map(right.get_map_ptr());
+
+        DataSet out = left.join(right, {"id"});
+
+        REQUIRE(left.get_map_ptr()->size() == 1);
+        REQUIRE(out.get_map_ptr() != left.get_map_ptr());
+        REQUIRE(out.get_col_ref(1).as_string(0) == "green");
+        REQUIRE(std::isnan(out.at(1, 1)));
+        REQUIRE(out.get_col_ref(1).as_string(2) == "blue");
+    }
+
+    SECTION("LARGE INPUTS ARE PARTITIONED") {
+        std::vector<long double> ids(300000), keys(1000), weights(1000);
+        for (std::size_t i = 0; i < ids.size(); i++) ids[i] = (i * 7919) % 2000;
+        for (std::size_t i = 0; i < keys.size(); i++) { keys[i] = 2 * i; weights[i] = i; }
+
+        DataSet facts({ids}, {"id"});
+        DataSet table({keys, weights}, {"id", "w"});
+        DataSet out = facts.join(table, {"id"});
+
+        REQUIRE(out.num_rows() == 150000);
+
+        bool same = true;
+        for (std::size_t i = 0; same && i < out.num_rows(); i++) same = out.at(1, i) * 2 == out.at(0, i);
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("Sorted DataSets can be merged and aligned", "[Join]") {
+    DataSet trades({{1, 3, 3, 7, 12, NAN}, {10, 30, 31, 70, 120, 0}}, {"t", "qty"});
+    DataSet quotes({{0, 3, 3, 6, 11}, {100, 300, 301, 600, 1100}}, {"t", "bid"});
+
+    SECTION("SORTEDNESS FOLLOWS WRITES") {
+        REQUIRE(trades.get_col_ref(0).is_sorted());
+        REQUIRE(!trades.get_col_ref(1).is_sorted());
+
+        DataSet copy(trades);
+        copy.at(0, 1) = 20;
+        REQUIRE(!copy.get_col_ref(0).is_sorted());
+        REQUIRE(trades.get_col_ref(0).is_sorted());
+
+        // A reference taken before the check still writes afterwards
+        DataSet l({{1, 2, 3}}, {"k"}), r({{1, 2, 3}}, {"k"});
+        std::vector<long double> &k = r.at(0);
+        REQUIRE(r.get_col_ref(0).is_sorted());
+        k = {3, 2, 1};
+        REQUIRE(l.join(r, {"k"}).num_rows() == 3);
+    }
+
+    SECTION("MERGE JOIN MATCHES THE HASH JOIN") {
+        DataSet merged = merge_join(trades, quotes, "t", JoinType::LEFT);
+        DataSet hashed = hash_join(trades, quotes, {"t"}, JoinType::LEFT);
+
+        REQUIRE(merged.num_rows() == hashed.num_rows());
+        REQUIRE(merged.get_col(1) == hashed.get_col(1));
+        REQUIRE(merged.get_col_ref(2).get_data().size() == 8);
+        REQUIRE(merged.at(2, 1) == 300);
+        REQUIRE(merged.at(2, 4) == 301);
+        REQUIRE(merge_join(trades, quotes, "t", JoinType::ANTI).get_col(1) == std::vector<long double>{10, 70, 120, 0});
+        REQUIRE_THROWS(merge_join(trades, quotes, "qty"));
+    }
+
+    SECTION("AS-OF JOIN TAKES THE LAST PRECEDING ROW") {
+        DataSet out = trades.asof_join(quotes, "t");
+        REQUIRE(out.num_rows() == 6);
+        REQUIRE(out.at(2, 0) == 100);
+        REQUIRE(out.at(2, 1) == 301);
+        REQUIRE(out.at(2, 3) == 600);
+        REQUIRE(out.at(2, 4) == 1100);
+        REQUIRE(std::isnan(out.at(2, 5)));
+
+        DataSet near = trades.asof_join(quotes, "t", 0.5);
+        REQUIRE(std::isnan(near.at(2, 0)));
+        REQUIRE(near.at(2, 1) == 301);
+        REQUIRE(std::isnan(near.at(2, 3)));
+    }
+
+    SECTION("BLOCKS SPLIT RUNS OF EQUAL KEYS") {
+        std::vector<long double> a(200000), b(100000), ids(200000);
+        for (std::size_t i = 0; i < a.size(); i++) { a[i] = i / 3; ids[i] = i; }
+        for (std::size_t i = 0; i < b.size(); i++) b[i] = i / 2;
+
+        DataSet left({a, ids}, {"t", "id"}), right({b}, {"t"});
+        DataSet merged = left.join(right, {"t"});
+
+        REQUIRE(merged.num_rows() == 2 * 150000);
+        REQUIRE(merged.get_col(1) == hash_join(left, right, {"t"}).get_col(1));
+    }
+}
+
+TEST_CASE("DataSet rows can be sorted", "[Sort]") {
+    DataSet ds({{3, 1, NAN, 2, 1, -0.0}, {1, 2, 3, 4, 5, 6}}, {"x", "id"});
+    ds.add_col(Column({ds.encode("pear"), ds.encode("apple"), ds.encode("fig"), ds.encode("apple"), ds.encode("fig"), ds.encode("pear")}, "fruit"));
+    ds.get_col_ref(2).set_map(ds.get_map_ptr());
+
+    SECTION("ARGSORT IS STABLE AND PUTS NULLS LAST") {
+        REQUIRE(ds.argsort({"x"}) == std::vector<unsigned int>{5, 1, 4, 3, 0, 2});
+        REQUIRE(ds.argsort({"x"}, {false}) == std::vector<unsigned int>{0, 3, 1, 4, 5, 2});
+    }
+
+    SECTION("MULTIPLE KEYS") {
+        DataSet out = ds.sort_by({"fruit", "id"}, {true, false});
+
+        REQUIRE(out.get_col_ref(2).as_string() == std::vector<std::string>{"apple", "apple", "fig", "fig", "pear", "pear"});
+        REQUIRE(out.get_col(1) == std::vector<long double>{4, 2, 5, 3, 6, 1});
+    }
+
+    SECTION("SORTED KEYS ARE FLAGGED") {
+        DataSet out = ds.sort_by({"x"});
+        REQUIRE(out.get_col_ref(0).is_sorted());
+        REQUIRE(out.get_col(1) == std::vector<long double>{6, 2, 5, 4, 1, 3});
+    }
+
+    SECTION("VALUES BEYOND DOUBLE PRECISION ARE COMPARED") {
+        DataSet fine({{1 + 1e-18L, 1, 1 + 2e-18L}});
+        REQUIRE(fine.argsort({"col0"}) == std::vector<unsigned int>{1, 0, 2});
+    }
+
+    SECTION("LARGE INPUTS") {
+        std::vector<long double> a(300000), b(300000);
+        for (std::size_t i = 0; i < a.size(); i++) { a[i] = (long double)((i * 7919) % 1000) - 500; b[i] = i % 7; }
+
+        DataSet big({a, b}, {"a", "b"});
+        std::vector<unsigned int> perm = big.argsort({"b", "a"}, {false, true});
+
+        bool same = true;
+        for (std::size_t i = 1; same && i < perm.size(); i++) {
+            unsigned int p = perm[i - 1], q = perm[i];
+            same = b[p] > b[q] || (b[p] == b[q] && (a[p] < a[q] || (a[p] == a[q] && p < q)));
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("The best rows can be picked without a full sort", "[Sort]") {
+    DataSet ds({{4, NAN, 9, 4, 1, 9, 7}, {0, 1, 2, 3, 4, 5, 6}}, {"score", "id"});
+
+    SECTION("TIES GO TO THE EARLIER ROW") {
+        REQUIRE(ds.top_k("score", 3).get_col(1) == std::vector<long double>{2, 5, 6});
+        REQUIRE(ds.top_k("score", 2, false).get_col(1) == std::vector<long double>{4, 0});
+        REQUIRE(ds.top_k("score", 100).num_rows() == 6);
+        REQUIRE(ds.top_k("score", 0).num_rows() == 0);
+    }
+
+    SECTION("CATEGORICAL KEYS RANK BY STRING") {
+        DataSet fruit;
+        fruit.add_col(Column({fruit.encode("pear"), fruit.encode("apple"), fruit.encode("fig"), NAN, fruit.encode("kiwi")}, "fruit"));
+        fruit.get_col_ref(0).set_map(fruit.get_map_ptr());
+
+        REQUIRE(fruit.top_k("fruit", 2).get_col_ref(0).as_string() == std::vector<std::string>{"pear", "kiwi"});
+        REQUIRE(fruit.top_k("fruit", 3, false).get_col_ref(0).as_string() == std::vector<std::string>{"apple", "fig", "kiwi"});
+        REQUIRE(fruit.top_k("fruit", 10).num_rows() == 4);
+    }
+
+    SECTION("BLOCKS ARE MERGED") {
+        std::vector<long double> v(500000);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = (i * 7919) % 100000;
+
+        std::vector<unsigned int> rows = top_k_values(v.data(), v.size(), 10);
+        std::vector<unsigned int> sorted = argsort_columns({v.data()}, v.size(), {false});
+        sorted.resize(10);
+
+        REQUIRE(rows == sorted);
+    }
+}
+
+TEST_CASE("Quantiles can be estimated with a t-digest", "[Quantile]") {
+    std::vector<long double> v(1000000);
+    for (std::size_t i = 0; i < v.size(); i++) v[i] = (i * 7919) % v.size();
+    Column c(v);
+
+    SECTION("ESTIMATES ARE CLOSE IN RANK") {
+        TDigest digest = c.quantile_sketch();
+
+        REQUIRE(digest.count() == v.size());
+        REQUIRE(digest.size() <= 2 * TDIGEST_COMPRESSION);
+        REQUIRE(std::fabs(digest.quantile(0.5) - 500000) < 5000);
+        REQUIRE(std::fabs(digest.quantile(0.99) - 990000) < 1000);
+        REQUIRE(std::fabs(digest.quantile(0.999) - 999000) < 1000);
+        REQUIRE(digest.quantile(0) == 0);
+        REQUIRE(digest.quantile(1) == 999999);
+    }
+
+    SECTION("DIGESTS MERGE AND SERIALIZE") {
+        TDigest low, high;
+        for (int i = 0; i < 1000; i++) { low.add(i); high.add(1000 + i); }
+        low.add(NAN);
+        low.merge(high);
+
+        REQUIRE(low.count() == 2000);
+        REQUIRE(std::fabs(low.quantile(0.25) - 500) < 20);
+
+        std::stringstream ss;
+        low.serialize(ss);
+        TDigest copy = TDigest::deserialize(ss);
+
+        REQUIRE(copy.count() == 2000);
+        REQUIRE(copy.quantile(0.9) == low.quantile(0.9));
+        REQUIRE(c.approx_quantile(0.5) == Approx(500000).epsilon(0.01));
+    }
+
+    SECTION("CORRUPT DIGESTS ARE REJECTED") {
+        TDigest digest;
+        for (int i = 0; i < 1000; i++) digest.add(i);
+
+        std::stringstream ss;
+        digest.serialize(ss);
+        const string bytes = ss.str();
+        const size_t count_at = 5 + 4 * sizeof(long double), first_weight = count_at + 8 + sizeof(long double);
+
+        auto load = [](const string &s) { std::stringstream in(s); return TDigest::deserialize(in); };
+        auto with_count = [&](std::uint64_t n) { string s = bytes; std::memcpy(&s[count_at], &n, 8); return s; };
+
+        REQUIRE(load(bytes).count() == 1000);
+        REQUIRE_THROWS(load(with_count(1000000000)));  // More centroids than the compression allows
+        REQUIRE_THROWS(load(with_count(0)));           // Weight without centroids
+        REQUIRE_THROWS(load(with_count(digest.size() - 1)));
+        REQUIRE_THROWS(load(bytes.substr(0, bytes.size() - 1)));
+
+        string heavy = bytes;
+        long double weight = 1e6;
+        std::memcpy(&heavy[first_weight], &weight, sizeof(long double));
+        REQUIRE_THROWS(load(heavy));
+
+        std::stringstream empty;
+        TDigest().serialize(empty);
+        REQUIRE(std::isnan(TDigest::deserialize(empty).quantile(0.5)));
+    }
+
+    SECTION("EMPTY AND TINY INPUTS") {
+        REQUIRE(std::isnan(Column({NAN}).approx_quantile(0.5)));
+        REQUIRE(Column({3, 1, 2}).approx_quantile(0) == 1);
+        REQUIRE(Column({3, 1, 2}).approx_quantile(1) == 3);
+        REQUIRE(Column({3, 1, 2}).approx_quantile(0.5) == 2);
+    }
+}
+
+TEST_CASE("Distinct values can be counted", "[Distinct]") {
+    SECTION("ESTIMATES ARE CLOSE") {
+        std::vector<long double> v(400000);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = (i * 7919) % 150000;
+        v[7] = NAN;
+
+        REQUIRE(Column(v).distinct_count() == Approx(150000).epsilon(0.03));
+        REQUIRE(Column({1, 2, 2, 3, NAN, -0.0, 0}).distinct_count() == 4);
+    }
+
+    SECTION("SKETCHES MERGE") {
+        HyperLogLog a, b;
+        for (int i = 0; i < 5000; i++) { a.add(i); b.add(2500 + i); }
+        a.merge(b);
+
+        REQUIRE(a.estimate() == Approx(7500).epsilon(0.03));
+        REQUIRE_THROWS(a.merge(HyperLogLog(10)));
+    }
+
+    SECTION("CATEGORICAL COLUMNS ARE EXACT") {
+        DataSet ds({{1, 2, 3, 4}}, {"n"});
+        ds.add_col(Column({ds.encode("a"), ds.encode("b"), ds.encode("a"), NAN}, "cat"));
+        ds.get_col_ref(1).set_map(ds.get_map_ptr());
+
+        REQUIRE(ds.get_col_ref(1).distinct_count() == 2);
+        REQUIRE(ds.describe()[1].distinct == 2);
+    }
+}
+
+TEST_CASE("Columns can be combined with fused expressions", "[Expression]") {
+    DataSet ds({{1, 2, 3, NAN}, {10, 20, 30, 40}, {-1, 4, -9, 16}}, {"a", "b", "c"});
+
+    SECTION("ARITHMETIC IS EVALUATED PER ROW") {
+        Column out = ds["a"] * ds["b"] + ds["c"];
+
+        REQUIRE(out.get_data()[0] == 9);
+        REQUIRE(out.get_data()[2] == 81);
+        REQUIRE(std::isnan(out.get_data()[3]));
+
+        Column scaled(2 * -ds["a"] + ds["b"] / 10 - 1, "scaled");
+        REQUIRE(scaled.get_label() == "scaled");
+        REQUIRE(scaled.get_data()[1] == -3);
+    }
+
+    SECTION("FUNCTIONS") {
+        Column out = sqrt(abs(ds["c"])) + pow(ds["a"], 2) + fmax(ds["a"], 2);
+
+        REQUIRE(out.get_data()[0] == 4);
+        REQUIRE(out.get_data()[2] == 15);
+        REQUIRE(std::isnan(out.get_data()[3]));
+        REQUIRE(Column(fmax(ds["a"], 2)).get_data()[3] == 2);
+        REQUIRE(Column(log(exp(ds["b"]))).get_data()[1] == Approx(20));
+    }
+
+    SECTION("FUNCTIONS OF TWO COLUMNS") {
+        // This file is compiled under 'using namespace std', so these must not resolve to the <algorithm> or <cmath> versions
+        Column hi = fmax(ds["a"], ds["c"]);
+        Column lo = fmin(ds["a"] + 0, ds["c"] + 0);
+        Column p = pow(ds["a"], ds["a"]);
+
+        REQUIRE(hi.get_data() == std::vector<long double>{1, 4, 3, 16});
+        REQUIRE(lo.get_data() == std::vector<long double>{-1, 2, -9, 16});
+        REQUIRE(p.get_data()[2] == 27);
+        REQUIRE(std::isnan(p.get_data()[3]));
+    }
+
+    SECTION("COLUMNS CAN BE UPDATED IN PLACE") {
+        ds["b"] = ds["b"] * ds["b"] - ds["b"];
+        REQUIRE(ds.get_col(1) == std::vector<long double>{90, 380, 870, 1560});
+
+        ds.add_col(Column(ds["a"] + 1, "a1"));
+        REQUIRE(ds.get_col(3)[2] == 4);
+    }
+
+    SECTION("LENGTHS MUST MATCH") {
+        Column shorter({1, 2});
+        REQUIRE_THROWS(ds["a"] + shorter);
+        REQUIRE_THROWS(ds["missing"]);
+        REQUIRE_THROWS(ds["b"] = shorter * 2);
+        REQUIRE_THROWS(ds["b"] = shorter);
+        REQUIRE(ds.get_col_ref(1).size() == 4);
+    }
+
+    SECTION("ASSIGNING THROUGH THE DATASET KEEPS ITS LABELS") {
+        ds.get_col_ref(0).set_masked(true);
+        ds["a"] = ds["b"];
+        REQUIRE(ds.get_col_index("a") == 0);
+        REQUIRE(ds.get_col_index("b") == 1);
+        REQUIRE(ds.get_col(0) == ds.get_col(1));
+        REQUIRE(ds["a"].is_masked());
+
+        DataSet moved(std::move(ds));
+        Column &c = moved["c"];
+        DataSet again = std::move(moved);
+        c = Column({0, 0, 0, 0}, "renamed");
+        REQUIRE(again.get_col_index("c") == 2);
+        REQUIRE(again.get_col(2)[3] == 0);
+
+        Column free = again["c"];
+        free = Column({1}, "free");
+        REQUIRE(free.get_label() == "free");
+    }
+}
+
+TEST_CASE("Queries can be planned lazily and optimized", "[Plan]") {
+    DataSet sales({{1, 2, 3, 1, 2, 3, 1}, {5, 0, 7, 2, 9, 4, 6}, {10, 20, 30, 40, 50, 60, 70}, {0, 1, 0, 1, 0, 1, 0}}, {"store", "qty", "price", "flag"});
+    sales.get_col_ref(3).set_masked(true);
+    DataSet stores({{1, 2, 3}, {100, 200, 300}, {9, 9, 9}}, {"store", "area", "price"});
+
+    SECTION("RESULTS MATCH THE EAGER OPERATIONS") {
+        DataSet lazy = sales.lazy().filter(field("qty") > 1).sort_by({"price"}, {false}).collect();
+        DataSet eager = sales.filter(field("qty") > 1).sort_by({"price"}, {false});
+
+        REQUIRE(lazy.num_cols() == 3); // 'flag' is masked and nothing reads it
+        for (unsigned int c = 0; c < 3; c++) REQUIRE(lazy.get_col(c) == eager.get_col(c));
+
+        DataSet grouped = sales.lazy().group_by({"store"}).agg({agg("qty", Agg::SUM), agg("qty", Agg::SIZE)}).collect();
+        REQUIRE(grouped.get_col(1) == std::vector<long double>{13, 9, 11});
+        REQUIRE(grouped.get_col(2) == std::vector<long double>{3, 2, 2});
+    }
+
+    SECTION("FILTERS ARE PUSHED INTO THE SCANS") {
+        LazyDataSet q = sales.lazy().join(stores.lazy(), {"store"}).sort_by({"qty"}).filter(field("area") >= 200 && field("qty") > 3 && field("store") < 3);
+
+        std::string plan = q.explain();
+        REQUIRE(plan.find("Filter") == std::string::npos);
+        REQUIRE(plan.find("where (qty > 3) && (store < 3)") != std::string::npos);
+        REQUIRE(plan.find("where (area >= 200) && (store < 3)") != std::string::npos);
+        REQUIRE(q.explain(false).find("Filter") != std::string::npos);
+
+        DataSet out = q.collect();
+        REQUIRE(out.get_col(0) == std::vector<long double>{2});
+        REQUIRE(out.get_col(1) == std::vector<long double>{9});
+        REQUIRE(out.get_col_ref(4).get_label() == "price_right");
+    }
+
+    SECTION("UNREAD COLUMNS ARE PRUNED") {
+        LazyDataSet q = sales.lazy().filter(field("flag") == 1).join(stores.lazy(), {"store"}).select({"qty", "area"});
+
+        REQUIRE(q.explain() == "Project [qty, area]\n"
+                               "  Inner join on [store]\n"
+                               "    Scan [store, qty] of 4 columns where (flag == 1)\n"
+                               "    Scan [store, area] of 3 columns\n");
+
+        DataSet out = q.collect();
+        REQUIRE(out.num_cols() == 2);
+        REQUIRE(out.get_col(0) == std::vector<long double>{0, 2, 4});
+        REQUIRE(out.get_col(1) == std::vector<long double>{200, 100, 300});
+    }
+
+    SECTION("ADJACENT OPERATORS ARE FUSED") {
+        LazyDataSet q = sales.lazy().sort_by({"qty"}, {false}).head(5).head(2).select({"qty", "price", "store"}).select({"price", "qty"});
+
+        REQUIRE(q.explain() == "Project [price, qty]\n"
+                               "  Top 2 by [qty desc]\n"
+                               "    Scan [qty, price] of 4 columns\n");
+        REQUIRE(q.collect().get_col(0) == std::vector<long double>{50, 30});
+
+        // Filters above a limit stay there, and key filters pass below a grouping
+        std::string plan = sales.lazy().group_by({"store"}).agg({agg("qty", Agg::MAX)}).filter(field("store") != 2 && field("qty_max") > 6).explain();
+        REQUIRE(plan.find("Filter (qty_max > 6)") == 0);
+        REQUIRE(plan.find("where (store != 2)") != std::string::npos);
+        REQUIRE(sales.lazy().head(3).filter(field("qty") > 1).explain().find("Filter") == 0);
+    }
+
+    SECTION("PIPELINES RUN MORSEL BY MORSEL") {
+        std::vector<long double> x(100003), y(100003);
+        for (std::size_t i = 0; i < x.size(); i++) { x[i] = i % 7; y[i] = i; }
+        DataSet big({x, y}, {"x", "y"});
+        big.add_col(Column(std::vector<long double>(x.size(), big.encode("a")), "cat"));
+        big.get_col_ref(2).set_map(big.get_map_ptr());
+
+        DataSet out = run_pipeline(big, {field("x") == 3, field("y") >= 50000}, {"y", "cat"});
+        DataSet eager = big.filter(field("x") == 3 && field("y") >= 50000);
+
+        REQUIRE(out.num_cols() == 2);
+        REQUIRE(out.get_col(0) == eager.get_col(1));
+        REQUIRE(out.get_col_ref(1).is_categorical());
+        REQUIRE(run_pipeline(big, {field("x") > 9}, {"x"}).num_rows() == 0);
+
+        // A filter above a join runs as a pipeline over the joined rows
+        DataSet sizes({{0, 1, 2, 3, 4, 5, 6}, {10, 11, 12, 13, 14, 15, 16}}, {"x", "size"});
+        DataSet joined = big.lazy().join(sizes.lazy(), {"x"}).filter(field("size") > 15 || field("y") < 3).collect();
+        REQUIRE(joined.num_rows() == 14286 + 3);
+    }
+
+    SECTION("LABELS ARE CHECKED AS THE PLAN IS BUILT") {
+        REQUIRE_THROWS(sales.lazy().select({"qty"}).filter(field("price") > 1));
+        REQUIRE_THROWS(sales.lazy().sort_by({"missing"}));
+        REQUIRE_THROWS(sales.lazy().join(stores.lazy(), {"qty"}));
+    }
+}
+
+TEST_CASE("Work is shared out on a work-stealing pool", "[ThreadPool]") {
+    SECTION("ROW RANGES AND ITEMS ARE EACH VISITED ONCE") {
+        std::vector<int> hits(100000, 0);
+        parallel_for(0, hits.size(), 1000, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) hits[i]++;
+        });
+        parallel_for_each(0, hits.size(), [&](std::size_t i) { hits[i]++; });
+
+        REQUIRE(std::count(hits.begin(), hits.end(), 2) == 100000);
+    }
+
+    SECTION("CALLERS CAN INJECT THEIR OWN POOL") {
+        ThreadPool pool(3, true);
+        std::vector<char> inside(16, 0);
+
+        {
+            PoolScope scope(pool);
+            REQUIRE(&ThreadPool::current() == &pool);
+            REQUIRE(thread_count() == 4);
+
+            // Tasks run by the pool's workers keep using it, including nested calls
+            parallel_for_each(0, inside.size(), [&](std::size_t i) {
+                std::vector<int> nested(64, 0);
+                parallel_for_each(0, nested.size(), [&](std::size_t j) { nested[j] = 1; });
+                inside[i] = &ThreadPool::current() == &pool && std::count(nested.begin(), nested.end(), 1) == 64;
+            });
+
+            DataSet ds({{1, 2, 3, 4}}, {"x"});
+            REQUIRE(ds.describe()[0].mean == 2.5);
+        }
+
+        REQUIRE(std::count(inside.begin(), inside.end(), 1) == 16);
+        REQUIRE(&ThreadPool::current() == &ThreadPool::global());
+    }
+
+    SECTION("EXCEPTIONS REACH THE CALLER") {
+        REQUIRE_THROWS(parallel_for_each(0, 1000, [](std::size_t i) { if (i == 700) throw -1; }));
+    }
+}
+
+TEST_CASE("Rolling and exponentially weighted statistics", "[Window]") {
+    Column x({1, 3, 2, NAN, 5, 4}, "x");
+
+    SECTION("ROLLING WINDOWS") {
+        std::vector<long double> sum = x.rolling(3, Roll::SUM, 2).get_data();
+        REQUIRE(std::isnan(sum[0]));
+        REQUIRE(sum[1] == 4);
+        REQUIRE(sum[2] == 6);
+        REQUIRE(sum[3] == 5);
+        REQUIRE(sum[5] == 9);
+
+        REQUIRE(x.rolling(2, Roll::MAX, 1).get_data() == std::vector<long double>{1, 3, 3, 2, 5, 5});
+        REQUIRE(x.rolling(3, Roll::COUNT).get_data() == std::vector<long double>{1, 2, 3, 2, 2, 2});
+        REQUIRE(std::isnan(x.rolling(3, Roll::MIN).get_data()[3])); // A full window is needed by default
+        REQUIRE(x.rolling(3, Roll::STD, 2).get_data()[2] == Approx(1));
+        REQUIRE(x.rolling(3, Roll::MEAN).get_label() == "x_rolling_mean_3");
+        REQUIRE_THROWS(x.rolling(0, Roll::MEAN));
+    }
+
+    SECTION("LONG COLUMNS MATCH A DIRECT COMPUTATION") {
+        std::vector<long double> v(200000);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = i % 97 == 0 ? NAN : (long double)((i * 7919) % 1000);
+
+        DataSet ds({v}, {"v"});
+        DataSet out = ds.rolling({"v"}, {5, 1000}, Roll::MIN, 1);
+        DataSet mean = ds.rolling({"v"}, {1000}, Roll::MEAN, 900);
+
+        REQUIRE(out.num_cols() == 2);
+        REQUIRE(out.get_col_ref(1).get_label() == "v_rolling_min_1000");
+
+        bool same = true;
+        for (std::size_t i : {0ul, 4ul, 65535ul, 65536ul, 131100ul, 199999ul}) {
+            for (std::size_t w : {5ul, 1000ul}) {
+                long double lo = NAN, total = 0;
+                std::size_t count = 0;
+                for (std::size_t j = i + 1 > w ? i + 1 - w : 0; j <= i; j++) {
+                    if (v[j] != v[j]) continue;
+                    if (lo != lo || v[j] < lo) lo = v[j];
+                    total += v[j];
+                    count++;
+                }
+
+                long double got = out.at(w == 5 ? 0 : 1, i);
+                same = same && (got == lo || (got != got && lo != lo));
+                if (w == 1000 && count >= 900) same = same && std::fabs(mean.at(0, i) - total / count) < 1e-9;
+            }
+        }
+        REQUIRE(same);
+    }
+
+    SECTION("EXPONENTIAL WEIGHTS") {
+        Column y({1, 2, 3}, "y");
+
+        std::vector<long double> mean = y.ewm(0.5, Ewm::MEAN).get_data();
+        REQUIRE(mean[1] == Approx(5.0 / 3));
+        REQUIRE(mean[2] == Approx(4.25 / 1.75));
+
+        std::vector<long double> var = y.ewm(0.5, Ewm::VAR).get_data();
+        REQUIRE(std::isnan(var[0]));
+        REQUIRE(var[1] == Approx(0.5));
+        REQUIRE(var[2] == Approx(0.928571).epsilon(1e-5));
+
+        REQUIRE(x.ewm(0.5, Ewm::MEAN).get_data()[3] == x.ewm(0.5, Ewm::MEAN).get_data()[2]); // Missing rows repeat the last mean
+        REQUIRE(y.ewm(0.1, Ewm::STD).get_label() == "y_ewm_std_0.1");
+        REQUIRE_THROWS(y.ewm(0, Ewm::MEAN));
+    }
+}
+
+TEST_CASE("Columns can be scanned and differenced", "[Scan]") {
+    Column x({2, 3, NAN, 1, 5}, "x");
+
+    SECTION("RUNNING VALUES") {
+        std::vector<long double> sum = x.cumsum().get_data();
+        REQUIRE(sum[1] == 5);
+        REQUIRE(std::isnan(sum[2]));
+        REQUIRE(sum[4] == 11);
+
+        REQUIRE(x.cumprod().get_data()[4] == 30);
+        REQUIRE(x.cummin().get_data()[3] == 1);
+        REQUIRE(x.cummax().get_data()[3] == 3);
+        REQUIRE(x.cumsum().get_label() == "x_cumsum");
+    }
+
+    SECTION("LAGGED CHANGES") {
+        std::vector<long double> d = x.diff().get_data();
+        REQUIRE(std::isnan(d[0]));
+        REQUIRE(d[1] == 1);
+        REQUIRE(std::isnan(d[3]));
+        REQUIRE(d[4] == 4);
+
+        REQUIRE(x.diff(3).get_data()[4] == 2);
+        REQUIRE(x.pct_change().get_data()[1] == Approx(0.5));
+        REQUIRE(x.pct_change(2).get_data()[3] == Approx(-2.0 / 3));
+    }
+
+    SECTION("LONG COLUMNS SCAN ACROSS BLOCKS") {
+        std::vector<long double> v(300001);
+        for (std::size_t i = 0; i < v.size(); i++) v[i] = i % 1000 == 7 ? NAN : (long double)(i % 5);
+
+        Column c(v);
+        std::vector<long double> sum = c.cumsum().get_data(), max = c.cummax().get_data();
+
+        long double total = 0;
+        bool same = true;
+        for (std::size_t i = 0; i < v.size(); i++) {
+            if (v[i] == v[i]) total += v[i];
+            same = same && (v[i] == v[i] ? sum[i] == total : std::isnan(sum[i]));
+        }
+        REQUIRE(same);
+        REQUIRE(max.back() == 4);
+    }
+}
+
+TEST_CASE("Covariance and correlation matrices", "[Correlation]") {
+    DataSet ds({{1, 2, 3, 4, 5}, {2, 4, 6, 8, 10}, {5, 3, 4, 1, 2}, {1, 1, 1, 1, 1}}, {"a", "b", "c", "id"});
+    ds.get_col_ref(3).set_masked(true);
+
+    SECTION("FULL COLUMNS") {
+        DataSet cov = ds.cov();
+        DataSet corr = ds.corr();
+
+        REQUIRE(cov.num_cols() == 3); // The masked column is left out
+        REQUIRE(cov.get_col_ref(1).get_label() == "b");
+        REQUIRE(cov.at(0, 0) == Approx(2.5));
+        REQUIRE(cov.at(1, 0) == Approx(5));
+        REQUIRE(cov.at(2, 0) == Approx(-2));
+        REQUIRE(corr.at(1, 0) == Approx(1));
+        REQUIRE(corr.at(0, 2) == Approx(-0.8));
+        REQUIRE(corr.at(2, 2) == Approx(1));
+    }
+
+    SECTION("MISSING VALUES") {
+        DataSet gaps({{1, 2, NAN, 4, 5}, {2, 4, 6, 8, NAN}, {5, 3, 4, 1, 2}}, {"a", "b", "c"});
+
+        DataSet pairwise = gaps.cov(Nulls::PAIRWISE);
+        REQUIRE(pairwise.at(0, 0) == Approx(Column({1, 2, 4, 5}).variance()));
+        REQUIRE(pairwise.at(2, 2) == Approx(2.5));
+        REQUIRE(pairwise.at(1, 0) == Approx(Column({2, 4, 8}).variance() / 2)); // a = b / 2 on the shared rows 0, 1 and 3
+
+        DataSet complete = gaps.cov(Nulls::COMPLETE);
+        REQUIRE(complete.at(2, 2) == Approx(Column({5, 3, 1}).variance()));
+        REQUIRE(gaps.corr(Nulls::PAIRWISE).at(1, 0) == Approx(1));
+    }
+
+    SECTION("WIDE INPUTS SPAN SEVERAL TILES") {
+        std::vector<std::vector<long double>> cols(150, std::vector<long double>(1000));
+        for (std::size_t c = 0; c < cols.size(); c++) {
+            for (std::size_t r = 0; r < 1000; r++) cols[c][r] = (long double)((r * (c + 3) * 7919) % 101) + (c % 3 == 0 && r % 50 == 0 ? NAN : 0);
+        }
+        DataSet wide(cols);
+
+        DataSet corr = wide.corr();
+        bool same = true;
+        for (std::size_t i : {0ul, 63ul, 64ul, 149ul}) {
+            for (std::size_t j : {1ul, 65ul, 128ul, 149ul}) {
+                std::vector<long double> x, y;
+                for (std::size_t r = 0; r < 1000; r++) {
+                    if (cols[i][r] != cols[i][r] || cols[j][r] != cols[j][r]) continue;
+                    x.push_back(cols[i][r]);
+                    y.push_back(cols[j][r]);
+                }
+
+                Column cx(x), cy(y);
+                long double mx = cx.mean(), my = cy.mean(), sxy = 0;
+                for (std::size_t r = 0; r < x.size(); r++) sxy += (x[r] - mx) * (y[r] - my);
+                long double expect = sxy / (x.size() - 1) / std::sqrt(cx.variance() * cy.variance());
+
+                same = same && std::fabs(corr.at(j, i) - expect) < 1e-9 && corr.at(j, i) == corr.at(i, j);
+            }
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("DataSets export to dense matrices", "[Matrix]") {
+    DataSet ds({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}, {0, 0, 0}}, {"a", "b", "c", "id"});
+    ds.get_col_ref(3).set_masked(true);
+
+    SECTION("VIEWS AND COPIES") {
+        MatrixView view = ds.matrix_view();
+        REQUIRE(view.rows() == 3);
+        REQUIRE(view.cols() == 3);
+        REQUIRE(view.col(1) == ds.at(1).data()); // No copy
+        REQUIRE(view(2, 1) == 6);
+
+        REQUIRE(ds.matrix_view({"c"}).data() == ds.at(2).data());
+
+        Matrix<double> m = ds.to_matrix<double>({"c", "a"});
+        REQUIRE(m.cols() == 2);
+        REQUIRE(m.data()[0] == 7);
+        REQUIRE(m.data()[4] == 2);
+        REQUIRE(m(2, 0) == 9);
+        REQUIRE_THROWS(m.at(3, 0));
+        REQUIRE_THROWS(ds.to_matrix({"missing"}));
+    }
+
+    SECTION("PRODUCTS MATCH A NAIVE LOOP") {
+        const std::size_t m = 70, k = 300, n = 67;
+        Matrix<double> a(m, k), b(k, n);
+        for (std::size_t j = 0; j < k; j++) {
+            for (std::size_t i = 0; i < m; i++) a(i, j) = (double)((i * 31 + j * 17) % 23) - 11;
+        }
+        for (std::size_t j = 0; j < n; j++) {
+            for (std::size_t i = 0; i < k; i++) b(i, j) = (double)((i * 7 + j * 13) % 19) - 9;
+        }
+
+        Matrix<double> c = matmul(a, b);
+        Matrix<double> ct = matmul(b, a, true, true); // (a b)^T
+        Matrix<double> at = a.transpose();
+        Matrix<double> c2 = matmul(at, b, true);
+        Matrix<double> g = a.gram();
+
+        bool same = c.rows() == m && c.cols() == n && ct.rows() == n && ct.cols() == m;
+        for (std::size_t i = 0; i < m; i++) {
+            for (std::size_t j = 0; j < n; j++) {
+                double expect = 0;
+                for (std::size_t p = 0; p < k; p++) expect += a(i, p) * b(p, j);
+                same = same && c(i, j) == expect && ct(j, i) == expect && c2(i, j) == expect;
+            }
+        }
+        for (std::size_t i = 0; i < k; i++) {
+            for (std::size_t j = 0; j < k; j++) {
+                double expect = 0;
+                for (std::size_t p = 0; p < m; p++) expect += a(p, i) * a(p, j);
+                same = same && g(i, j) == expect && at(i, i % m) == a(i % m, i);
+            }
+        }
+        REQUIRE(same);
+        REQUIRE_THROWS(matmul(a, a));
+    }
+}
+
+TEST_CASE("Scalers fit and transform in place", "[Scaler]") {
+    DataSet ds({{1, 2, 3, 4, NAN}, {10, 10, 10, 10, 10}, {-2, 0, 2, 4, 6}}, {"a", "flat", "b"});
+    ds.add_col(Column({0, 1, 0, 1, 0}, "id"));
+    ds.get_col_ref(3).set_masked(true);
+
+    SECTION("STANDARD") {
+        Scaler s;
+        s.fit_transform(ds);
+
+        REQUIRE(s.get_labels() == vector<string>({"a", "flat", "b"}));
+        REQUIRE(s.get_centre()[0] == Approx(2.5));
+        REQUIRE(s.get_scale()[0] == Approx(std::sqrt(1.25L)));
+        REQUIRE(s.get_scale()[1] == 1); // No spread
+        REQUIRE(ds.at(0, 0) == Approx(-1.5 / std::sqrt(1.25L)));
+        REQUIRE(ds.at(0, 4) != ds.at(0, 4));
+        REQUIRE(ds.at(1, 2) == 0);
+        REQUIRE(ds["b"].mean() == Approx(0).margin(1e-12));
+        REQUIRE(ds["id"].sum() == 2); // Masked columns are left alone
+
+        s.inverse_transform(ds);
+        REQUIRE(ds.at(2, 4) == Approx(6));
+        REQUIRE(ds.at(0, 1) == Approx(2));
+    }
+
+    SECTION("MIN MAX") {
+        Scaler s(Scaling::MIN_MAX);
+        s.fit_transform(ds, {"b"});
+
+        REQUIRE(ds.at(2, 0) == 0);
+        REQUIRE(ds.at(2, 2) == Approx(0.5));
+        REQUIRE(ds.at(2, 4) == 1);
+        REQUIRE(ds.at(0, 0) == 1); // Not fitted
+        REQUIRE(ds["b"].is_sorted());
+    }
+
+    SECTION("ROBUST OVER MANY BLOCKS") {
+        std::vector<long double> values(200000);
+        for (std::size_t i = 0; i < values.size(); i++) values[i] = (long double)((i * 7919) % 1000);
+        values[5] = 1e12; // An outlier
+        DataSet big({values}, {"x"});
+
+        Scaler s(Scaling::ROBUST);
+        s.fit(big);
+        REQUIRE(s.get_centre()[0] == Approx(500).margin(5));
+        REQUIRE(s.get_scale()[0] == Approx(500).margin(5));
+
+        s.transform(big);
+        REQUIRE(big.at(0, 1) == Approx((919 - s.get_centre()[0]) / s.get_scale()[0]));
+    }
+
+    SECTION("SERIALIZATION") {
+        Scaler s(Scaling::STANDARD);
+        s.fit(ds, {"b", "a"});
+
+        std::stringstream ss;
+        s.serialize(ss);
+        Scaler back = Scaler::deserialize(ss);
+
+        REQUIRE(back.get_kind() == Scaling::STANDARD);
+        REQUIRE(back.get_labels() == s.get_labels());
+        REQUIRE(back.get_centre() == s.get_centre());
+        REQUIRE(back.get_scale() == s.get_scale());
+
+        std::stringstream bad("SCL2");
+        REQUIRE_THROWS(Scaler::deserialize(bad));
+
+        DataSet other({{1, 2}}, {"a"});
+        REQUIRE_THROWS(back.transform(other)); // No column "b"
+    }
+
+    SECTION("CATEGORICAL COLUMNS ARE REFUSED") {
+        DataSet cat;
+        cat.add_col(Column({0, 1}, "c"));
+        cat.get_col_ref(0).set_map(Bimap<long double, string>());
+        REQUIRE_THROWS(Scaler().fit(cat, {"c"}));
+    }
+}
+
+TEST_CASE("Categorical columns one-hot encode to sparse matrices", "[OneHot]") {
+    DataSet ds;
+    long double red = ds.encode("red"), green = ds.encode("green"), blue = ds.encode("blue");
+    ds.encode("yellow"); // In the map, but in neither column
+    Column color({red, blue, NAN, red, green}, "color");
+    Column size({blue, blue, red, blue, 12345}, "size"); // 12345 is not a code
+    color.set_map(ds.get_map_ptr());
+    size.set_map(ds.get_map_ptr());
+    ds.add_col(color);
+    ds.add_col(size);
+    ds.add_col(Column({1, 2, 3, 4, 5}, "n"));
+
+    SECTION("CSR") {
+        SparseMatrix m = ds.one_hot({"color", "size"});
+
+        REQUIRE(m.get_layout() == SparseLayout::CSR);
+        REQUIRE(m.rows() == 5);
+        REQUIRE(m.cols() == 5); // Only the terms each column holds
+        REQUIRE(m.nnz() == 8);
+        REQUIRE(m.get_labels() == vector<string>({"color_blue", "color_green", "color_red", "size_blue", "size_red"}));
+        REQUIRE(m.get_offsets() == vector<size_t>({0, 2, 4, 5, 7, 8}));
+        REQUIRE(m.get_indices() == vector<unsigned int>({2, 3, 0, 3, 4, 2, 3, 1}));
+        REQUIRE(ds.one_hot({"size"}).get_labels() == vector<string>({"size_blue", "size_red"}));
+        REQUIRE(ds.vocabulary({"color", "size"}) == vector<vector<string>>({{"blue", "green", "red"}, {"blue", "red"}}));
+        REQUIRE(m.at(0, 2) == 1);
+        REQUIRE(m.at(0, 0) == 0);
+        REQUIRE_THROWS(m.at(5, 0));
+
+        REQUIRE_THROWS(ds.one_hot({"n"}));
+        REQUIRE_THROWS(ds.one_hot({"missing"}));
+    }
+
+    SECTION("CSC MATCHES CSR") {
+        SparseMatrix csr = ds.one_hot({"color", "size"});
+        SparseMatrix csc = ds.one_hot({"color", "size"}, SparseLayout::CSC);
+
+        REQUIRE(csc.get_layout() == SparseLayout::CSC);
+        REQUIRE(csc.get_offsets() == vector<size_t>({0, 1, 2, 4, 7, 8}));
+        REQUIRE(csc.get_indices() == vector<unsigned int>({1, 4, 0, 3, 0, 1, 3, 2}));
+        REQUIRE(csc.to_dense()(3, 3) == 1);
+
+        bool same = true;
+        for (size_t r = 0; r < 5; r++) {
+            for (size_t c = 0; c < 5; c++) same = same && csr.at(r, c) == csc.at(r, c);
+        }
+        REQUIRE(same);
+        REQUIRE(csc.to_csr().get_indices() == csr.get_indices());
+    }
+
+    SECTION("A VOCABULARY FIXES THE LAYOUT") {
+        vector<vector<string>> vocabulary = ds.vocabulary({"color"});
+        vocabulary[0].push_back("purple"); // Not in the map: an output that stays empty
+
+        DataSet test;
+        test.set_map_ptr(ds.get_map_ptr());
+        Column color({ds.encode("yellow"), green, NAN}, "color");
+        color.set_map(ds.get_map_ptr());
+        test.add_col(color);
+
+        SparseMatrix train_m = ds.one_hot({"color"}, vocabulary), test_m = test.one_hot({"color"}, vocabulary);
+
+        REQUIRE(train_m.get_labels() == test_m.get_labels());
+        REQUIRE(test_m.cols() == 4);
+        REQUIRE(test_m.get_offsets() == vector<size_t>({0, 0, 1, 1}));
+        REQUIRE(test_m.get_indices() == vector<unsigned int>({1}));
+        REQUIRE(train_m.get_indices() == vector<unsigned int>({2, 0, 2, 1}));
+
+        REQUIRE_THROWS(ds.one_hot({"color"}, {{"red", "red"}}));
+        REQUIRE_THROWS(ds.one_hot({"color", "size"}, vocabulary));
+        REQUIRE_THROWS(ds.vocabulary({"n"}));
+    }
+
+    SECTION("MANY ROWS AND TERMS") {
+        DataSet big;
+        std::vector<long double> codes(150000);
+        for (size_t i = 0; i < 5000; i++) big.encode("t" + std::to_string(i));
+        for (size_t r = 0; r < codes.size(); r++) codes[r] = big.encode("t" + std::to_string((r * 37) % 5000));
+
+        Column c(codes, "c");
+        c.set_map(big.get_map_ptr());
+        big.add_col(c);
+
+        SparseMatrix csr = big.one_hot({"c"});
+        SparseMatrix csc = big.one_hot({"c"}, SparseLayout::CSC);
+        REQUIRE(csr.cols() == 5000);
+        REQUIRE(csr.nnz() == codes.size());
+        REQUIRE(csc.get_offsets()[5000] == codes.size());
+
+        bool same = true;
+        for (size_t r = 0; r < codes.size(); r += 997) {
+            const string &label = csr.get_labels()[csr.get_indices()[r]];
+            same = same && label == "c_t" + std::to_string((r * 37) % 5000) && csc.at(r, csr.get_indices()[r]) == 1;
+        }
+        REQUIRE(same);
+    }
+}
@@ -0,0 +1,63 @@
+// Bit counting on 64-bit words. Compiler intrinsics where they exist, with a portable fallback for other compilers
+#ifndef BITS_H
+#define BITS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/* Declarations */
+
+inline unsigned int popcount64(std::uint64_t x); // Number of set bits
+inline unsigned int ctz64(std::uint64_t x);      // Number of zero bits below the lowest set bit. 'x' must not be 0
+inline unsigned int clz64(std::uint64_t x);      // Number of zero bits above the highest set bit. 'x' must not be 0
+
+/* Definitions */
+
+inline unsigned int popcount64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (unsigned int)__popcnt64(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline unsigned int ctz64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return popcount64((x & (0 - x)) - 1);
+#endif
+}
+
+inline unsigned int clz64(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - index;
+#else
+    // Smear the highest set bit into every lower position, then count what is left unset
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    x |= x >> 32;
+    return 64 - popcount64(x);
+#endif
+}
+
+#endif
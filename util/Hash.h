@@ -0,0 +1,41 @@
+// Hashing of long double values, shared by the kernels that group, join or count distinct values
+#ifndef HASH_H
+#define HASH_H
+
+#include <limits>
+#include <cstdint>
+#include <cstring>
+
+/* Declarations */
+
+inline std::uint64_t mix64(std::uint64_t x);      // Finaliser from splitmix64. Spreads every input bit over the whole output
+inline std::uint64_t hash_value(long double v);   // Hash of the value, not of its bytes: 0 and -0 hash alike, as do all NaNs
+
+/* Definitions */
+
+inline std::uint64_t mix64(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline std::uint64_t hash_value(long double v) {
+    if (v == 0) v = 0;
+    if (v != v) return 0x7ff8000000000000ULL;
+
+    // Only the bytes that hold the value: x87 extended precision leaves the padding bytes undefined
+    const std::size_t bytes = std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(long double);
+    unsigned char raw[sizeof(long double)] = { 0 };
+    std::memcpy(raw, &v, bytes);
+
+    std::uint64_t lo = 0, hi = 0;
+    std::memcpy(&lo, raw, 8);
+    if (bytes > 8) std::memcpy(&hi, raw + 8, bytes - 8 < 8 ? bytes - 8 : 8);
+
+    return mix64(lo ^ mix64(hi + 0x9e3779b97f4a7c15ULL));
+}
+
+#endif
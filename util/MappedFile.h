@@ -0,0 +1,96 @@
+// Read-only view of a whole file. Uses mmap where it is available and falls back to reading the file into memory elsewhere.
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DSCPP_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "config.h"
+
+/* Declarations */
+
+class MappedFile {
+    private:
+        const char* ptr;
+        std::size_t length;
+        std::vector<char> buffer; // Only used when mmap is not available
+
+    public:
+        // Constructors
+        MappedFile(const std::string &path); // Maps 'path' into memory. Throws if the file cannot be opened
+        ~MappedFile();
+
+        MappedFile(const MappedFile &mf) = delete;
+        MappedFile& operator=(const MappedFile &mf) = delete;
+
+        // Getters
+        const char* data() const { return ptr; }
+        std::size_t size() const { return length; }
+};
+
+/* Definitions */
+
+inline MappedFile::MappedFile(const std::string &path) {
+    ptr = nullptr;
+    length = 0;
+
+#ifdef DSCPP_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> MappedFile() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+
+    length = st.st_size;
+
+    if (length > 0) {
+        void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (p == MAP_FAILED) {
+            if (VERBOSE_ERRORS) std::cout << "[Error] -> MappedFile() -> Could not map " << path << "!" << std::endl;
+            throw -1;
+        }
+
+        madvise(p, length, MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(p);
+    } else {
+        close(fd);
+    }
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+
+    if (!in) {
+        if (VERBOSE_ERRORS) std::cout << "[Error] -> MappedFile() -> Could not open " << path << "!" << std::endl;
+        throw -1;
+    }
+
+    length = in.tellg();
+    buffer.resize(length);
+    in.seekg(0);
+    in.read(buffer.data(), length);
+    ptr = buffer.data();
+#endif
+}
+
+inline MappedFile::~MappedFile() {
+#ifdef DSCPP_HAS_MMAP
+    if (ptr != nullptr) munmap(const_cast<char*>(ptr), length);
+#endif
+}
+
+#endif
@@ -0,0 +1,89 @@
+// Helpers for splitting work across the library's thread pool. They run on ThreadPool::current(), so a PoolScope redirects them
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+#include "ThreadPool.h"
+#include "config.h"
+
+/* Declarations */
+
+inline unsigned int thread_count(); // Threads that take part in a parallel call: the current pool's workers and the caller
+
+// Calls 'fn(lo, hi)' over disjoint sub-ranges of [begin, end) that are at least 'grain' elements long, e.g. over rows.
+// There are a few more sub-ranges than threads so uneven work evens out. The calling thread takes part, so calls may nest.
+// The first exception thrown by 'fn' is re-thrown here once every sub-range has finished.
+template <typename Function>
+void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, Function fn);
+
+// Calls 'fn(i)' once for every i in [begin, end), e.g. over a set of columns or morsels. Each thread takes the next index as it
+// finishes the last, so items of uneven cost even out. Exceptions are handled like parallel_for()
+template <typename Function>
+void parallel_for_each(std::size_t begin, std::size_t end, Function fn);
+
+/* Definitions */
+
+inline unsigned int thread_count() {
+    return ThreadPool::current().size() + 1;
+}
+
+template <typename Function>
+void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, Function fn) {
+    if (end <= begin) return;
+
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t n = end - begin;
+    std::size_t threads = thread_count();
+    std::size_t chunks = std::min<std::size_t>(threads == 1 ? 1 : 4 * threads, (n + grain - 1) / grain);
+
+    if (chunks <= 1) {
+        fn(begin, end);
+        return;
+    }
+
+    std::size_t step = (n + chunks - 1) / chunks;
+    TaskGroup group(ThreadPool::current());
+
+    for (std::size_t lo = begin + step; lo < end; lo += step) {
+        std::size_t hi = std::min(end, lo + step);
+        group.run([&fn, lo, hi]() { fn(lo, hi); });
+    }
+
+    try {
+        fn(begin, begin + step);
+    } catch (...) {
+        group.wait_quietly();
+        throw;
+    }
+
+    group.wait();
+}
+
+template <typename Function>
+void parallel_for_each(std::size_t begin, std::size_t end, Function fn) {
+    if (end <= begin) return;
+
+    std::atomic<std::size_t> next(begin);
+    auto work = [&]() {
+        for (std::size_t i = next++; i < end; i = next++) fn(i);
+    };
+
+    std::size_t helpers = std::min<std::size_t>(thread_count(), end - begin);
+    TaskGroup group(ThreadPool::current());
+    for (std::size_t t = 1; t < helpers; t++) group.run(work);
+
+    try {
+        work();
+    } catch (...) {
+        group.wait_quietly();
+        throw;
+    }
+
+    group.wait();
+}
+
+#endif
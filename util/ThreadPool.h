@@ -0,0 +1,284 @@
+// A fixed set of worker threads shared by every parallel kernel in the library
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "config.h"
+
+/* Declarations */
+
+// Every worker owns a deque of tasks. A worker pushes the tasks it submits onto its own deque and takes them back from the same
+// end, newest first, while its data is still in cache. An idle worker steals the oldest task of another deque, which tends to
+// be the largest piece of work left. Threads outside the pool submit to a shared queue that every worker also steals from.
+// A thread waiting on a TaskGroup runs queued tasks itself instead of blocking, so tasks may start and wait on further tasks
+// without starving the pool.
+class ThreadPool {
+    private:
+        struct Queue {
+            std::deque<std::function<void()>> tasks;
+            std::mutex lock;
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Queue>> queues; // One per worker, then the shared queue
+        std::atomic<std::size_t> queued;            // Tasks waiting in all the queues
+        std::mutex lock;                            // Guards sleeping workers and 'stopping'
+        std::condition_variable available;
+        bool stopping;
+
+        int worker_index() const;                            // Position of the calling thread among the workers, or -1
+        bool take(std::size_t self, std::function<void()> &task); // Pops from queue 'self', newest first, or steals from the others, oldest first
+        void work(std::size_t index);
+
+    public:
+        ThreadPool(unsigned int threads, bool pin = POOL_AFFINITY); // Starts 'threads' workers, pinning worker i to core i + 1 if 'pin'. 0 is valid
+        ~ThreadPool();                                              // Finishes the queued tasks, then joins the workers
+
+        ThreadPool(const ThreadPool &tp) = delete;
+        ThreadPool& operator=(const ThreadPool &tp) = delete;
+
+        void submit(std::function<void()> task); // Queues a task on the calling worker's deque, or on the shared queue
+        bool run_one();                          // Runs one queued task on the calling thread. Returns false if every queue was empty
+
+        unsigned int size() const { return workers.size(); }
+        static ThreadPool& global();             // The library's default pool: one worker per THREAD_COUNT, less the calling thread
+        static ThreadPool& current();            // The pool kernels run on: the innermost PoolScope of this thread, the pool this thread works for, or global()
+};
+
+// Makes kernels called on this thread use 'pool' until the scope ends. Scopes nest, and the tasks they start inherit the pool.
+//   ThreadPool mine(8);
+//   { PoolScope scope(mine); ds.describe(); }
+class PoolScope {
+    private:
+        ThreadPool *previous;
+
+    public:
+        PoolScope(ThreadPool &pool);
+        ~PoolScope();
+
+        PoolScope(const PoolScope &ps) = delete;
+        PoolScope& operator=(const PoolScope &ps) = delete;
+};
+
+// Tracks a batch of tasks submitted to a pool so they can be waited on together
+class TaskGroup {
+    private:
+        ThreadPool &pool;
+        std::size_t pending; // Guarded by 'lock'
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable finished;
+
+    public:
+        TaskGroup(ThreadPool &pool) : pool(pool), pending(0) { }
+        ~TaskGroup() { wait_quietly(); }
+
+        void run(std::function<void()> task); // Submits a task that belongs to this group
+        void wait();                          // Helps run queued tasks until the group's tasks are done, then re-throws the first exception one of them threw
+        void wait_quietly();                  // Same as wait(), without re-throwing
+};
+
+/* Definitions */
+
+namespace pool_detail {
+    struct ThreadState {
+        ThreadPool *owner = nullptr;  // Pool this thread is a worker of
+        std::size_t index = 0;        // Its position among that pool's workers
+        ThreadPool *scoped = nullptr; // Innermost PoolScope on this thread
+    };
+
+    inline ThreadState& state() {
+        static thread_local ThreadState s;
+        return s;
+    }
+}
+
+inline ThreadPool::ThreadPool(unsigned int threads, bool pin) : queued(0), stopping(false) {
+    for (unsigned int i = 0; i <= threads; i++) queues.emplace_back(new Queue());
+
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+
+#ifdef __linux__
+        unsigned int cores = std::thread::hardware_concurrency();
+        if (pin && cores > 0) {
+            // Core 0 is left to the thread that owns the pool
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET((i + 1) % cores, &set);
+            pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+        }
+#else
+        (void)pin;
+#endif
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto &w : workers) w.join();
+}
+
+inline void ThreadPool::work(std::size_t index) {
+    pool_detail::ThreadState &s = pool_detail::state();
+    s.owner = this;
+    s.index = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (take(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        available.wait(guard, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+inline int ThreadPool::worker_index() const {
+    const pool_detail::ThreadState &s = pool_detail::state();
+    return s.owner == this ? (int)s.index : -1;
+}
+
+inline bool ThreadPool::take(std::size_t self, std::function<void()> &task) {
+    if (queued == 0) return false;
+
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    for (std::size_t k = 1; k < queues.size(); k++) {
+        Queue &victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued--;
+        return true;
+    }
+
+    return false;
+}
+
+inline void ThreadPool::submit(std::function<void()> task) {
+    int index = worker_index();
+    Queue &q = *queues[index < 0 ? workers.size() : index];
+    {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(std::move(task));
+        queued++;
+    }
+
+    // Taking the lock orders the count before any worker's check, so a worker about to sleep sees it or gets woken
+    { std::lock_guard<std::mutex> guard(lock); }
+    available.notify_one();
+}
+
+inline bool ThreadPool::run_one() {
+    int index = worker_index();
+    std::function<void()> task;
+
+    if (!take(index < 0 ? workers.size() : index, task)) return false;
+    task();
+    return true;
+}
+
+inline ThreadPool& ThreadPool::global() {
+    unsigned int threads = THREAD_COUNT;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+
+    static ThreadPool pool(threads > 1 ? threads - 1 : 0);
+    return pool;
+}
+
+inline ThreadPool& ThreadPool::current() {
+    const pool_detail::ThreadState &s = pool_detail::state();
+
+    if (s.scoped) return *s.scoped;
+    if (s.owner) return *s.owner;
+    return global();
+}
+
+inline PoolScope::PoolScope(ThreadPool &pool) {
+    previous = pool_detail::state().scoped;
+    pool_detail::state().scoped = &pool;
+}
+
+inline PoolScope::~PoolScope() {
+    pool_detail::state().scoped = previous;
+}
+
+inline void TaskGroup::run(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending++;
+    }
+
+    pool.submit([this, task]() {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!error) error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--pending == 0) finished.notify_all();
+    });
+}
+
+inline void TaskGroup::wait_quietly() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (pending == 0) return;
+        }
+
+        if (pool.run_one()) continue;
+
+        // Nothing left to help with: the group's last tasks are running elsewhere
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [this]() { return pending == 0; });
+        return;
+    }
+}
+
+inline void TaskGroup::wait() {
+    wait_quietly();
+
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+#endif
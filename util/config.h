@@ -8,5 +8,15 @@
 const std::string DEFAULT_LABEL = "col"; // Used by Class Column
 const bool VERBOSE_ERRORS = true;       // Used by Class Column, DataSet
 const bool ALLOW_UNIQUE_COLUMN_MAPS = false;    // Used by DataSet
+const unsigned int THREAD_COUNT = 0;             // Used by ThreadPool. 0 means one thread per hardware core
+const bool POOL_AFFINITY = false;                // Used by ThreadPool. Pins each worker of a new pool to its own core
+const unsigned int TRANSPOSE_BLOCK = 64;         // Used by the npy reader and transpose(). Rows and columns per tile of a transpose
+const unsigned int BINARY_BLOCK_ROWS = 65536;    // Used by the binary writer. Rows per block on disk
+const unsigned int PREFETCH_DEPTH = 2;           // Used by PrefetchReader. Batches read ahead of the consumer
+const unsigned int AGGREGATE_GRAIN = 65536;      // Used by the aggregation kernels. Smallest row range worth handing to another thread
+const unsigned int MORSEL_ROWS = 16384;          // Used by the query executor. Rows per morsel, so one column of a morsel (256 KB) stays in L2
+const unsigned int HLL_PRECISION = 14;           // Used by HyperLogLog. 2^14 registers per sketch, for a standard error of 0.8%
+const unsigned int DENSE_GROUP_LIMIT = 65536;    // Used by group_by(). Largest number of categorical key combinations grouped without hashing
+const long double TDIGEST_COMPRESSION = 100;     // Used by TDigest. Roughly the number of centroids kept; higher is more accurate
 
 #endif
\ No newline at end of file